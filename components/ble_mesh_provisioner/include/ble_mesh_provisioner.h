@@ -136,6 +136,19 @@ typedef struct {
      * - A node can have multiple AppKeys bound to different models
      */
     uint16_t app_idx;
+
+    /**
+     * @brief Mesh buffer pool sampling period in ms (0 = disabled)
+     *
+     * EDUCATIONAL NOTE:
+     * - The mesh stack queues every outgoing PDU in a fixed pool of
+     *   advertising buffers (CONFIG_BLE_MESH_ADV_BUF_COUNT)
+     * - Buffers are held for only a few milliseconds, so the pool has to be
+     *   sampled often to catch its peak
+     * - Usage is exported as gateway_metrics gauges (mesh.adv_buf, ...)
+     * - Requires CONFIG_BLE_MESH_NET_BUF_POOL_USAGE
+     */
+    uint16_t pool_monitor_period_ms;
 } provisioner_config_t;
 
 /**
@@ -284,6 +297,33 @@ esp_err_t provisioner_send_onoff(uint16_t unicast, bool onoff);
  */
 uint16_t provisioner_get_node_count(void);
 
+/**
+ * @brief Receive timestamp of the mesh message currently being dispatched
+ *
+ * Captured with esp_timer_get_time() at entry of the sensor and vendor model
+ * callbacks, before any parsing or logging. Only meaningful when called from
+ * inside provisioner_sensor_msg_handler() / provisioner_vendor_msg_handler()
+ * (all mesh callbacks run on the same BTC task).
+ *
+ * Used by the bridge to split end-to-end latency into mesh, queueing and
+ * network hops.
+ *
+ * @return Timestamp in microseconds since boot
+ */
+int64_t provisioner_get_rx_time_us(void);
+
+/**
+ * @brief Override the receive timestamp for an injected message
+ *
+ * Test hook for traffic injection and replay: call right before invoking
+ * provisioner_vendor_msg_handler() / provisioner_sensor_msg_handler()
+ * directly, so latency tracing sees the injection time instead of the
+ * timestamp of the last real mesh message.
+ *
+ * @param rx_time_us Timestamp in microseconds since boot
+ */
+void provisioner_set_rx_time_us(int64_t rx_time_us);
+
 #ifdef __cplusplus
 }
 #endif
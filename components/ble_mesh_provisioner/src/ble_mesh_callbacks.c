@@ -159,7 +159,13 @@
 #include "ble_mesh_callbacks.h"
 #include "ble_mesh_storage.h"
 #include "ble_mesh_auto_config.h"
+#include "gateway_metrics.h"
+#include "gateway_prof.h"
+#include "gateway_trace.h"
+#include "mesh_capture.h"
+#include "ble_mesh_provisioner.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_ble_mesh_networking_api.h"
 #include "esp_ble_mesh_local_data_operation_api.h"
 #include "mesh/utils.h"
@@ -234,10 +240,63 @@ extern esp_ble_mesh_client_t config_client;
 extern esp_ble_mesh_client_t onoff_client;
 extern struct esp_ble_mesh_key prov_key;
 
+/*
+ * METRICS
+ * -------
+ * Configuration failures and timeouts, exported through gateway_metrics.
+ * Registered in mesh_callbacks_init_metrics(); NULL handles are no-ops.
+ */
+static gateway_metric_t *s_metric_cfg_fail;
+static gateway_metric_t *s_metric_cfg_timeout;
+
+/*
+ * RECEIVE TIMESTAMP
+ * -----------------
+ * Set at entry of the sensor/vendor callbacks, read by the bridge through
+ * provisioner_get_rx_time_us(). Single writer (BTC task), so no locking;
+ * the traffic injector writes it instead when no real nodes are sending.
+ */
+static int64_t s_rx_time_us;
+
+int64_t provisioner_get_rx_time_us(void)
+{
+    return s_rx_time_us;
+}
+
+void provisioner_set_rx_time_us(int64_t rx_time_us)
+{
+    s_rx_time_us = rx_time_us;
+}
+
+void mesh_callbacks_init_metrics(void)
+{
+    s_metric_cfg_fail = gateway_metrics_counter("mesh.cfg_fail");
+    s_metric_cfg_timeout = gateway_metrics_counter("mesh.cfg_timeout");
+}
+
 // Forward declarations for weak functions that can be overridden
 void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode, uint8_t *data, uint16_t length);
 void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int32_t value);
 
+/*
+ * HANDLER DISPATCH
+ * ----------------
+ * Every message handed to the external handlers goes through these, so it
+ * can be recorded for offline replay (mesh_capture) with its destination.
+ */
+static void dispatch_vendor_msg(uint16_t src, uint16_t dst, uint32_t opcode,
+                                uint8_t *data, uint16_t length)
+{
+    mesh_capture_record(MESH_CAPTURE_VENDOR, src, dst, opcode, data, length, s_rx_time_us);
+    provisioner_vendor_msg_handler(src, opcode, data, length);
+}
+
+static void dispatch_sensor_msg(uint16_t src, uint16_t dst, uint16_t property_id, int32_t value)
+{
+    mesh_capture_record(MESH_CAPTURE_SENSOR, src, dst, property_id, &value, sizeof(value), s_rx_time_us);
+    provisioner_sensor_msg_handler(src, property_id, value);
+}
+
 /*
  * COMPOSITION DATA PARSER
  * =======================
@@ -264,6 +323,7 @@ static int parse_composition_data(struct net_buf_simple *buf,
                                    discovered_model_t *models,
                                    int max_models)
 {
+    GW_PROF_SCOPE(GW_PROF_PARSE_COMPOSITION);
     int model_count = 0;
 
     if (!buf || buf->len < 10) {
@@ -648,11 +708,15 @@ void mesh_config_client_cb(esp_ble_mesh_cfg_client_cb_event_t event,
     opcode = param->params->opcode;
     addr = param->params->ctx.addr;
 
+    GW_TRACE_SCOPE(GW_TRACE_EV_MESH_CONFIG_CB, event, addr);
+    GW_PROF_SCOPE(GW_PROF_MESH_CONFIG_CB);
+
     ESP_LOGI(TAG, "Config client event %d, addr: 0x%04x, opcode: 0x%04" PRIx32,
              event, addr, opcode);
 
     if (param->error_code) {
         ESP_LOGE(TAG, "Send config client message failed, opcode 0x%04" PRIx32, opcode);
+        gateway_metrics_counter_inc(s_metric_cfg_fail);
         return;
     }
 
@@ -854,6 +918,7 @@ void mesh_config_client_cb(esp_ble_mesh_cfg_client_cb_event_t event,
         break;
     case ESP_BLE_MESH_CFG_CLIENT_TIMEOUT_EVT:
         ESP_LOGW(TAG, "Config client timeout, opcode 0x%04" PRIx32, opcode);
+        gateway_metrics_counter_inc(s_metric_cfg_timeout);
         // Retry logic could be added here
         break;
     default:
@@ -925,9 +990,14 @@ void mesh_sensor_client_cb(esp_ble_mesh_sensor_client_cb_event_t event,
     uint32_t opcode;
     uint16_t addr;
 
+    s_rx_time_us = esp_timer_get_time();
+
     opcode = param->params->opcode;
     addr = param->params->ctx.addr;
 
+    GW_TRACE_SCOPE(GW_TRACE_EV_MESH_SENSOR_CB, event, addr);
+    GW_PROF_SCOPE(GW_PROF_MESH_SENSOR_CB);
+
     ESP_LOGI(TAG, "📊 Sensor client event %d, addr: 0x%04x, opcode: 0x%04" PRIx32,
              event, addr, opcode);
 
@@ -1246,7 +1316,7 @@ void mesh_sensor_client_cb(esp_ble_mesh_sensor_client_cb_event_t event,
                         ESP_LOGI(TAG, "  ✅ Sensor 0x%04x = %d", property_id, (int)value);
 
                         // Call external handler (can be overridden by mesh_mqtt_bridge)
-                        provisioner_sensor_msg_handler(addr, property_id, value);
+                        dispatch_sensor_msg(addr, param->params->ctx.recv_dst, property_id, value);
 
                         // REAL-WORLD INTERPRETATION EXAMPLES:
                         // ------------------------------------
@@ -1264,7 +1334,7 @@ void mesh_sensor_client_cb(esp_ble_mesh_sensor_client_cb_event_t event,
                         ESP_LOGI(TAG, "  ✅ Sensor 0x%04x = %d", property_id, (int)value);
 
                         // Call external handler
-                        provisioner_sensor_msg_handler(addr, property_id, (int32_t)value);
+                        dispatch_sensor_msg(addr, param->params->ctx.recv_dst, property_id, (int32_t)value);
 
                         // Used by some standard sensors (e.g., temperature in 0.01°C)
                         // Example: 2543 = 25.43°C
@@ -1275,7 +1345,7 @@ void mesh_sensor_client_cb(esp_ble_mesh_sensor_client_cb_event_t event,
                         ESP_LOGI(TAG, "  ✅ Sensor 0x%04x = %d", property_id, (int)value);
 
                         // Call external handler
-                        provisioner_sensor_msg_handler(addr, property_id, (int32_t)value);
+                        dispatch_sensor_msg(addr, param->params->ctx.recv_dst, property_id, (int32_t)value);
 
                         // Used by simple sensors (e.g., battery percentage 0-100)
 
@@ -1398,6 +1468,12 @@ void mesh_vendor_client_cb(esp_ble_mesh_model_cb_event_t event,
     uint32_t opcode;
     uint16_t addr;
 
+    s_rx_time_us = esp_timer_get_time();
+
+    GW_TRACE_SCOPE(GW_TRACE_EV_MESH_VENDOR_CB, event,
+                   event == ESP_BLE_MESH_MODEL_OPERATION_EVT ? param->model_operation.ctx->addr : 0);
+    GW_PROF_SCOPE(GW_PROF_MESH_VENDOR_CB);
+
     switch (event) {
     case ESP_BLE_MESH_MODEL_SEND_COMP_EVT:
         ESP_LOGI(TAG, "Vendor model send complete");
@@ -1411,7 +1487,7 @@ void mesh_vendor_client_cb(esp_ble_mesh_model_cb_event_t event,
         uint8_t *data = param->model_operation.msg;
 
         // Call external handler first (can be overridden by mesh_mqtt_bridge)
-        provisioner_vendor_msg_handler(addr, opcode, data, length);
+        dispatch_vendor_msg(addr, param->model_operation.ctx->recv_dst, opcode, data, length);
 
         // Log IMU data for debugging
         if (opcode == VENDOR_MODEL_OP_IMU_DATA) {
@@ -1463,7 +1539,7 @@ void mesh_vendor_client_cb(esp_ble_mesh_model_cb_event_t event,
         ESP_LOGI(TAG, "📦 Published vendor message from 0x%04x, opcode=0x%06" PRIx32, addr, opcode);
 
         // Call external handler (forwards to MQTT bridge)
-        provisioner_vendor_msg_handler(addr, opcode, data, length);
+        dispatch_vendor_msg(addr, param->client_recv_publish_msg.ctx->recv_dst, opcode, data, length);
 
         // Log IMU data for debugging
         if (opcode == VENDOR_MODEL_OP_IMU_DATA) {
@@ -13,4 +13,7 @@ void mesh_generic_client_cb(esp_ble_mesh_generic_client_cb_event_t event, esp_bl
 void mesh_sensor_client_cb(esp_ble_mesh_sensor_client_cb_event_t event, esp_ble_mesh_sensor_client_cb_param_t *param);
 void mesh_vendor_client_cb(esp_ble_mesh_model_cb_event_t event, esp_ble_mesh_model_cb_param_t *param);
 
+// Register callback counters with gateway_metrics (call before esp_ble_mesh_init)
+void mesh_callbacks_init_metrics(void);
+
 #endif // BLE_MESH_CALLBACKS_H
@@ -0,0 +1,142 @@
+/*
+ * ============================================================================
+ *              BLE MESH PROVISIONER - BUFFER POOL MONITOR
+ * ============================================================================
+ *
+ * WHY?
+ * ====
+ * sdkconfig.defaults sizes the mesh stack pools by hand (ADV_BUF_COUNT=60,
+ * BLE_ADV_BUF_COUNT=20, ...). When a pool runs dry the stack silently drops
+ * outgoing messages or relays, so we sample how many buffers are in use and
+ * export the value (and its peak) as gateway_metrics gauges:
+ *
+ *   mesh.adv_buf        Mesh advertising buffers (all outgoing mesh PDUs)
+ *   mesh.relay_buf      Relay buffers (CONFIG_BLE_MESH_RELAY_ADV_BUF only)
+ *   mesh.ble_adv_buf    Plain BLE advertising buffers (CONFIG_BLE_MESH_SUPPORT_BLE_ADV)
+ *
+ * Each gauge is [in use, peak in use]; compare the peak with the Kconfig
+ * count to decide whether a pool can shrink or must grow.
+ *
+ * HOW?
+ * ====
+ * The pools are not exposed by the public esp_ble_mesh API. With
+ * CONFIG_BLE_MESH_NET_BUF_POOL_USAGE the stack keeps an avail_count per
+ * pool, and the pools themselves are global symbols of the mesh core
+ * (NET_BUF_POOL_DEFINE does not make them static), so we read them
+ * directly. Buffers are held for milliseconds, so a 30 s snapshot would
+ * miss nearly every peak: an esp_timer samples at a much shorter period
+ * and the gauges remember the peak between publications.
+ *
+ * NOT COVERED:
+ * - Segmented TX/RX contexts (TX/RX_SEG_MSG_COUNT) are static arrays in
+ *   the transport layer with no accessor; watch mesh.cfg_timeout instead.
+ * - Friend queues: the gateway is not a Friend node (CONFIG_BLE_MESH_FRIEND
+ *   is off), so there are none.
+ */
+
+#include "ble_mesh_pool_monitor.h"
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#if CONFIG_BLE_MESH_NET_BUF_POOL_USAGE
+
+// Internal mesh stack header (struct net_buf_pool); moved in ESP-IDF 5.1
+#if __has_include("mesh/buf.h")
+#include "mesh/buf.h"
+#else
+#include "mesh_buf.h"
+#endif
+
+#define TAG "MESH_POOL"
+
+// Defined with NET_BUF_POOL_DEFINE in the mesh core (adv.c)
+extern struct net_buf_pool adv_buf_pool;
+#if CONFIG_BLE_MESH_RELAY_ADV_BUF
+extern struct net_buf_pool relay_adv_buf_pool;
+#endif
+#if CONFIG_BLE_MESH_SUPPORT_BLE_ADV
+extern struct net_buf_pool ble_adv_buf_pool;
+#endif
+
+typedef struct {
+    struct net_buf_pool *pool;
+    const char *metric_name;
+    gateway_metric_t *in_use;
+} monitored_pool_t;
+
+static monitored_pool_t s_pools[] = {
+    { &adv_buf_pool,        "mesh.adv_buf",     NULL },
+#if CONFIG_BLE_MESH_RELAY_ADV_BUF
+    { &relay_adv_buf_pool,  "mesh.relay_buf",   NULL },
+#endif
+#if CONFIG_BLE_MESH_SUPPORT_BLE_ADV
+    { &ble_adv_buf_pool,    "mesh.ble_adv_buf", NULL },
+#endif
+};
+
+#define POOL_COUNT (sizeof(s_pools) / sizeof(s_pools[0]))
+
+static esp_timer_handle_t s_timer = NULL;
+
+/**
+ * Sample every pool once
+ *
+ * avail_count is a 16-bit field updated by the stack under its own lock;
+ * a racy read is at most one buffer off, which is fine for a gauge.
+ */
+static void sample_pools(void *arg)
+{
+    for (size_t i = 0; i < POOL_COUNT; i++) {
+        const struct net_buf_pool *p = s_pools[i].pool;
+        gateway_metrics_gauge_set(s_pools[i].in_use, (int32_t)p->buf_count - p->avail_count);
+    }
+}
+
+esp_err_t mesh_pool_monitor_start(uint32_t period_ms)
+{
+    if (period_ms == 0) {
+        return ESP_OK;
+    }
+    if (s_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (size_t i = 0; i < POOL_COUNT; i++) {
+        s_pools[i].in_use = gateway_metrics_gauge(s_pools[i].metric_name);
+        ESP_LOGI(TAG, "Monitoring %s (%u buffers)", s_pools[i].metric_name,
+                 (unsigned)s_pools[i].pool->buf_count);
+    }
+
+    // Also refresh right before each snapshot so "current" is current
+    gateway_metrics_register_sampler(sample_pools, NULL);
+
+    const esp_timer_create_args_t args = {
+        .callback = sample_pools,
+        .name = "mesh_pool_mon",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = esp_timer_start_periodic(s_timer, (uint64_t)period_ms * 1000);
+    if (err != ESP_OK) {
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+    }
+    return err;
+}
+
+#else // !CONFIG_BLE_MESH_NET_BUF_POOL_USAGE
+
+esp_err_t mesh_pool_monitor_start(uint32_t period_ms)
+{
+    if (period_ms > 0) {
+        ESP_LOGW("MESH_POOL", "CONFIG_BLE_MESH_NET_BUF_POOL_USAGE disabled - pool monitor off");
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_BLE_MESH_NET_BUF_POOL_USAGE
@@ -0,0 +1,10 @@
+#ifndef BLE_MESH_POOL_MONITOR_H
+#define BLE_MESH_POOL_MONITOR_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+// Start periodic sampling of the mesh stack buffer pools (period_ms > 0)
+esp_err_t mesh_pool_monitor_start(uint32_t period_ms);
+
+#endif // BLE_MESH_POOL_MONITOR_H
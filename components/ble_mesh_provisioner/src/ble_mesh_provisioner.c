@@ -46,6 +46,7 @@
 #include "ble_mesh_provisioner.h"
 #include "ble_mesh_callbacks.h"
 #include "ble_mesh_storage.h"
+#include "ble_mesh_pool_monitor.h"
 
 #include "esp_log.h"
 #include "esp_bt.h"
@@ -796,6 +797,9 @@ esp_err_t provisioner_init(const provisioner_config_t *config, const provisioner
     // This receives bulk IMU data from nodes
     esp_ble_mesh_register_custom_model_callback(mesh_vendor_client_cb);
 
+    // Export configuration failure/timeout counters
+    mesh_callbacks_init_metrics();
+
     // STEP 8: Initialize BLE Mesh stack
     // This sets up all the mesh layers (network, transport, access)
     // Registers our composition data (what models we support)
@@ -805,6 +809,12 @@ esp_err_t provisioner_init(const provisioner_config_t *config, const provisioner
         return err;
     }
 
+    // Sample advertising buffer pool usage (non-fatal: monitoring only)
+    err = mesh_pool_monitor_start(config->pool_monitor_period_ms);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Pool monitor not started: %s", esp_err_to_name(err));
+    }
+
     // STEP 9: Set UUID matching filter
     // Only scan for devices whose UUID starts with config->match_prefix
     // Parameters:
@@ -0,0 +1,288 @@
+/*
+ * ============================================================================
+ *                    GATEWAY METRICS COMPONENT - PUBLIC API
+ * ============================================================================
+ *
+ * WHAT IS THIS COMPONENT?
+ * =======================
+ * A small, allocation-free metrics registry. Other components register
+ * named metrics once at init and update them from any task (including the
+ * BLE Mesh callback task) with a single atomic operation.
+ *
+ * METRIC TYPES:
+ * =============
+ * - Counter:   monotonically increasing uint32 (messages, drops, failures)
+ * - Gauge:     signed int32 current value + peak (queue depth, heap free)
+ * - Histogram: fixed upper bounds chosen at registration, one overflow
+ *              bucket, plus count and sum (latencies, sizes)
+ *
+ * PUBLICATION:
+ * ============
+ * gateway_metrics_publisher_start() spawns a low-priority task that, every
+ * interval, runs the registered samplers, serializes a compact JSON snapshot
+ * and hands it to a publish function (typically wifi_mqtt_publish) on
+ * "<prefix>/gateway/metrics". Components with data that does not fit the
+ * counter/gauge/histogram model (per-node tables, task lists) register a
+ * report writer, published on "<prefix>/gateway/<name>" in the same cycle.
+ * The component itself does not depend on wifi_mqtt, so it can be used by
+ * the provisioner without coupling it to MQTT.
+ *
+ * EXAMPLE:
+ * ========
+ * ```c
+ * static gateway_metric_t *s_rx;
+ * static gateway_metric_t *s_latency;
+ * static const uint32_t latency_bounds_us[] = { 1000, 5000, 20000, 100000 };
+ *
+ * void my_init(void) {
+ *     s_rx = gateway_metrics_counter("bridge.rx");
+ *     s_latency = gateway_metrics_histogram("bridge.latency_us", latency_bounds_us, 4);
+ * }
+ *
+ * void on_message(void) {
+ *     gateway_metrics_counter_inc(s_rx);
+ *     gateway_metrics_histogram_observe(s_latency, elapsed_us);
+ * }
+ * ```
+ *
+ * SNAPSHOT FORMAT:
+ * ================
+ * ```json
+ * {"up":1234,"c":{"bridge.rx":42},"g":{"mqtt.outbox":[0,512]},
+ *  "h":{"bridge.latency_us":{"le":[1000,5000],"n":[3,1,0],"sum":4100}}}
+ * ```
+ * - up: uptime in seconds
+ * - c:  counters
+ * - g:  gauges as [current, peak]; peak is the highest value since the
+ *       first update (also for gauges that are always negative)
+ * - h:  histograms; "n" has one more entry than "le" (overflow bucket),
+ *       "sum" is 64-bit
+ */
+
+#ifndef GATEWAY_METRICS_H
+#define GATEWAY_METRICS_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of metrics in the registry */
+#define GATEWAY_METRICS_MAX             48
+
+/** Maximum number of upper bounds per histogram (one extra overflow bucket) */
+#define GATEWAY_METRICS_HIST_MAX_BOUNDS 12
+
+/** Maximum number of sampler callbacks */
+#define GATEWAY_METRICS_MAX_SAMPLERS    8
+
+/** Maximum number of report writers */
+#define GATEWAY_METRICS_MAX_REPORTS     8
+
+/**
+ * Opaque metric handle
+ *
+ * All update functions accept NULL and do nothing, so a failed registration
+ * (registry full) never needs to be checked on the hot path.
+ */
+typedef struct gateway_metric gateway_metric_t;
+
+/*
+ * ============================================================================
+ *                              REGISTRATION
+ * ============================================================================
+ * Names must point to static strings. Registering an existing name returns
+ * the existing metric (if the type matches), so independent modules can
+ * share a metric by name.
+ */
+
+/**
+ * Register (or look up) a counter
+ *
+ * @param name Static metric name (e.g. "bridge.pub_fail")
+ * @return Metric handle, or NULL if the registry is full
+ */
+gateway_metric_t *gateway_metrics_counter(const char *name);
+
+/**
+ * Register (or look up) a gauge
+ *
+ * @param name Static metric name (e.g. "mqtt.outbox_bytes")
+ * @return Metric handle, or NULL if the registry is full
+ */
+gateway_metric_t *gateway_metrics_gauge(const char *name);
+
+/**
+ * Register (or look up) a histogram
+ *
+ * @param name     Static metric name
+ * @param bounds   Ascending bucket upper bounds (inclusive); must be static
+ * @param n_bounds Number of bounds (1..GATEWAY_METRICS_HIST_MAX_BOUNDS)
+ * @return Metric handle, or NULL if the registry is full or bounds invalid
+ */
+gateway_metric_t *gateway_metrics_histogram(const char *name,
+                                            const uint32_t *bounds, uint8_t n_bounds);
+
+/*
+ * ============================================================================
+ *                                UPDATES
+ * ============================================================================
+ * Lock-free and safe from any task. Not ISR-safe on targets without native
+ * 32-bit atomics.
+ */
+
+void gateway_metrics_counter_add(gateway_metric_t *metric, uint32_t n);
+
+static inline void gateway_metrics_counter_inc(gateway_metric_t *metric)
+{
+    gateway_metrics_counter_add(metric, 1);
+}
+
+/** Set gauge to an absolute value (peak is updated) */
+void gateway_metrics_gauge_set(gateway_metric_t *metric, int32_t value);
+
+/** Add a (possibly negative) delta to a gauge (peak is updated) */
+void gateway_metrics_gauge_add(gateway_metric_t *metric, int32_t delta);
+
+/** Record one observation into a histogram */
+void gateway_metrics_histogram_observe(gateway_metric_t *metric, uint32_t value);
+
+/*
+ * ============================================================================
+ *                                READING
+ * ============================================================================
+ */
+
+/** Current counter value (0 for NULL) */
+uint32_t gateway_metrics_counter_get(const gateway_metric_t *metric);
+
+/** Current gauge value (0 for NULL) */
+int32_t gateway_metrics_gauge_get(const gateway_metric_t *metric);
+
+/**
+ * Serialize all metrics as compact JSON (format above)
+ *
+ * @param buf Output buffer
+ * @param len Buffer size
+ * @return Number of characters written (excluding NUL), or 0 if the
+ *         snapshot did not fit
+ */
+size_t gateway_metrics_snapshot_json(char *buf, size_t len);
+
+/*
+ * ============================================================================
+ *                               PUBLICATION
+ * ============================================================================
+ */
+
+/**
+ * Sampler callback
+ *
+ * Called by the publisher task right before each snapshot. Use it to refresh
+ * gauges whose source must be polled (outbox size, heap, queue lengths).
+ */
+typedef void (*gateway_metrics_sampler_t)(void *ctx);
+
+/**
+ * Register a sampler callback
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if all sampler slots are used
+ */
+esp_err_t gateway_metrics_register_sampler(gateway_metrics_sampler_t sampler, void *ctx);
+
+/** Run all registered samplers (the publisher task calls this) */
+void gateway_metrics_run_samplers(void);
+
+/**
+ * Report writer
+ *
+ * Serializes a component-specific JSON document into buf.
+ *
+ * @return Number of characters written (excluding NUL), or 0 to skip
+ *         this cycle (nothing to report or buffer too small)
+ */
+typedef size_t (*gateway_metrics_report_fn_t)(char *buf, size_t len, void *ctx);
+
+/**
+ * Register a report published on "<prefix>/gateway/<name>"
+ *
+ * @param name   Static subtopic name (e.g. "latency")
+ * @param writer Report writer
+ * @param ctx    Passed to writer
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if all slots are used
+ */
+esp_err_t gateway_metrics_register_report(const char *name,
+                                          gateway_metrics_report_fn_t writer, void *ctx);
+
+/** Number of registered reports */
+unsigned gateway_metrics_report_count(void);
+
+/**
+ * Run one report writer
+ *
+ * @param index Report index (0..gateway_metrics_report_count()-1)
+ * @param name  Out: report name
+ * @param buf   Output buffer
+ * @param len   Buffer size
+ * @return Characters written, or 0 if skipped / index out of range
+ */
+size_t gateway_metrics_report_json(unsigned index, const char **name, char *buf, size_t len);
+
+/**
+ * Publish function - same signature as wifi_mqtt_publish()
+ *
+ * @return Message ID (>= 0) on success, -1 on error
+ */
+typedef int (*gateway_metrics_publish_fn_t)(const char *topic, const char *data, int qos);
+
+/**
+ * Publisher configuration
+ */
+typedef struct {
+    const char *topic_prefix;               /*!< Topic prefix; snapshot goes to <prefix>/gateway/metrics */
+    uint32_t interval_ms;                   /*!< Publication interval (0 = default 30000) */
+    gateway_metrics_publish_fn_t publish;   /*!< Publish function (required) */
+    int qos;                                /*!< QoS for snapshots (default 0) */
+    size_t buffer_size;                     /*!< Snapshot/report buffer size (0 = default 3072) */
+} gateway_metrics_publisher_config_t;
+
+/**
+ * Start periodic snapshot publication
+ *
+ * @param config Publisher configuration (copied; strings must stay valid)
+ * @return ESP_OK on success
+ *         ESP_ERR_INVALID_ARG if prefix or publish function is missing
+ *         ESP_ERR_INVALID_STATE if already started
+ *         ESP_ERR_NO_MEM if the task or buffer cannot be allocated
+ */
+esp_err_t gateway_metrics_publisher_start(const gateway_metrics_publisher_config_t *config);
+
+/*
+ * ============================================================================
+ *                             SYSTEM MONITOR
+ * ============================================================================
+ */
+
+/**
+ * Enable heap and task telemetry
+ *
+ * Registers gauges heap.int.{free,min,largest} (and heap.psram.* when
+ * CONFIG_SPIRAM is set), refreshed before every snapshot, plus a "tasks"
+ * report with per-task priority, minimum free stack (bytes) and CPU share
+ * of one core since the previous report (per-mille).
+ *
+ * The task report needs CONFIG_FREERTOS_USE_TRACE_FACILITY; CPU shares need
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if sampler/report slots are exhausted
+ */
+esp_err_t gateway_metrics_sysmon_enable(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GATEWAY_METRICS_H
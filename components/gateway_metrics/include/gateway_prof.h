@@ -0,0 +1,169 @@
+/*
+ * ============================================================================
+ *                 GATEWAY METRICS COMPONENT - CYCLE PROFILER
+ * ============================================================================
+ *
+ * Opt-in cycle-count profiling of the mesh callbacks and bridge handlers.
+ * Each profiled function accumulates:
+ *
+ *   count, total, min, max   CPU cycles per call (esp_cpu_get_cycle_count)
+ *   hist[b]                  calls that took [2^b, 2^(b+1)) cycles
+ *
+ * USAGE:
+ * ======
+ * ```c
+ * static void mesh_vendor_client_cb(...)
+ * {
+ *     GW_PROF_SCOPE(GW_PROF_MESH_VENDOR_CB);   // Measured until the function returns
+ *     ...
+ * }
+ * ```
+ *
+ * Read the results with gateway_prof_get(), or call gateway_prof_enable()
+ * to publish them as the "prof" report on <prefix>/gateway/prof.
+ *
+ * Times are inclusive: a bridge handler called from a mesh callback is
+ * counted in both. Statistics are updated without locking and assume one
+ * writer per function (the BTC task for all of the points below).
+ *
+ * COST WHEN DISABLED:
+ * ===================
+ * Without CONFIG_GATEWAY_PROF_ENABLE every macro expands to nothing and no
+ * storage is reserved.
+ */
+
+#ifndef GATEWAY_PROF_H
+#define GATEWAY_PROF_H
+
+#include "esp_err.h"
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Profiled functions
+ *
+ * Names are in gateway_prof.c (s_prof_names).
+ */
+typedef enum {
+    GW_PROF_MESH_CONFIG_CB,         /*!< mesh_config_client_cb */
+    GW_PROF_MESH_SENSOR_CB,         /*!< mesh_sensor_client_cb */
+    GW_PROF_MESH_VENDOR_CB,         /*!< mesh_vendor_client_cb */
+    GW_PROF_PARSE_COMPOSITION,      /*!< parse_composition_data */
+    GW_PROF_BRIDGE_VENDOR,          /*!< Bridge vendor handler (routing + handler) */
+    GW_PROF_BRIDGE_SENSOR,          /*!< Bridge sensor handler (routing + handler) */
+    GW_PROF_BRIDGE_IMU,             /*!< Bridge IMU message handler */
+    GW_PROF_BRIDGE_HEARTRATE,       /*!< Bridge heart rate handler */
+    GW_PROF_COUNT
+} gateway_prof_id_t;
+
+/** log2 buckets: bucket b counts calls of [2^b, 2^(b+1)) cycles */
+#define GW_PROF_BUCKETS     32
+
+typedef struct {
+    uint32_t count;
+    uint64_t total;                 /*!< Sum of cycles */
+    uint32_t min;                   /*!< UINT32_MAX until the first call */
+    uint32_t max;
+    uint32_t hist[GW_PROF_BUCKETS];
+} gateway_prof_stats_t;
+
+#if CONFIG_GATEWAY_PROF_ENABLE
+
+#include "esp_cpu.h"
+
+extern gateway_prof_stats_t g_gateway_prof[GW_PROF_COUNT];
+
+static inline __attribute__((always_inline))
+void gateway_prof_record(gateway_prof_id_t id, uint32_t start)
+{
+    uint32_t cycles = (uint32_t)esp_cpu_get_cycle_count() - start;
+    gateway_prof_stats_t *s = &g_gateway_prof[id];
+
+    s->count++;
+    s->total += cycles;
+    if (cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+    s->hist[31 - __builtin_clz(cycles | 1)]++;
+}
+
+typedef struct {
+    gateway_prof_id_t id;
+    uint32_t start;
+} gateway_prof_scope_t;
+
+static inline void gateway_prof_scope_end(const gateway_prof_scope_t *scope)
+{
+    gateway_prof_record(scope->id, scope->start);
+}
+
+/** Measure from here until the enclosing scope exits, including early returns */
+#define GW_PROF_SCOPE(id) \
+    const gateway_prof_scope_t _gw_prof_scope __attribute__((cleanup(gateway_prof_scope_end), unused)) = \
+        { (id), (uint32_t)esp_cpu_get_cycle_count() }
+
+/** Explicit region; BEGIN and END must be in the same scope */
+#define GW_PROF_BEGIN(id)   const uint32_t _gw_prof_start_##id = (uint32_t)esp_cpu_get_cycle_count()
+#define GW_PROF_END(id)     gateway_prof_record((id), _gw_prof_start_##id)
+
+#else
+
+#define GW_PROF_SCOPE(id)   ((void)0)
+#define GW_PROF_BEGIN(id)   ((void)0)
+#define GW_PROF_END(id)     ((void)0)
+
+#endif // CONFIG_GATEWAY_PROF_ENABLE
+
+/**
+ * Copy the statistics of one function
+ *
+ * @param id  Profiled function
+ * @param out Destination
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NOT_SUPPORTED if profiling
+ *         is compiled out
+ */
+esp_err_t gateway_prof_get(gateway_prof_id_t id, gateway_prof_stats_t *out);
+
+/** Name of a profiled function (NULL if out of range) */
+const char *gateway_prof_name(gateway_prof_id_t id);
+
+/** Clear all statistics */
+void gateway_prof_reset(void);
+
+/**
+ * Serialize all functions that were called at least once
+ *
+ * {"mhz":240,"f":{"mesh_vendor_cb":{"n":812,"sum":9743110,"min":7012,
+ *  "max":40211,"b0":12,"h":[3,790,19]},...}}
+ *
+ * h[i] counts calls of [2^(b0+i), 2^(b0+i+1)) cycles; empty buckets below
+ * and above are omitted.
+ *
+ * @return Characters written (excluding NUL), or 0 if nothing to report,
+ *         the buffer is too small or profiling is compiled out
+ */
+size_t gateway_prof_json(char *buf, size_t len);
+
+/**
+ * Publish the statistics as the "prof" report (<prefix>/gateway/prof)
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM if report slots are exhausted, or
+ *         ESP_ERR_NOT_SUPPORTED if profiling is compiled out
+ */
+esp_err_t gateway_prof_enable(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GATEWAY_PROF_H
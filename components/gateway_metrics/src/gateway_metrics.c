@@ -0,0 +1,452 @@
+/*
+ * ============================================================================
+ *                  GATEWAY METRICS COMPONENT - REGISTRY
+ * ============================================================================
+ *
+ * Static, fixed-size registry. Updates are single relaxed atomics so they
+ * can be called from the BLE Mesh callback task without a lock; only
+ * registration (init-time) takes a short spinlock.
+ */
+
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define TAG "GW_METRICS"
+
+// Histograms use a separate, smaller bucket pool
+#define GATEWAY_METRICS_MAX_HISTOGRAMS  16
+
+// Gauge peak before the first set/add, so negative gauges (RSSI) get one
+#define GAUGE_NO_PEAK                   INT32_MIN
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+typedef struct {
+    const uint32_t *bounds;
+    uint8_t n_bounds;
+    atomic_uint_least32_t buckets[GATEWAY_METRICS_HIST_MAX_BOUNDS + 1];
+    atomic_uint_least64_t sum;          // 32 bits of µs wrap after ~72 min in total
+} metric_hist_t;
+
+struct gateway_metric {
+    const char *name;
+    metric_type_t type;
+    union {
+        atomic_uint_least32_t counter;
+        struct {
+            atomic_int_least32_t value;
+            atomic_int_least32_t peak;  // GAUGE_NO_PEAK until the first update
+        } gauge;
+        metric_hist_t *hist;
+    };
+};
+
+/*
+ * ============================================================================
+ *                           INTERNAL STATE
+ * ============================================================================
+ */
+
+static gateway_metric_t s_metrics[GATEWAY_METRICS_MAX];
+static atomic_uint s_metric_count = 0;     // Published after the slot is filled
+
+static metric_hist_t s_hists[GATEWAY_METRICS_MAX_HISTOGRAMS];
+static unsigned s_hist_count = 0;
+
+static struct {
+    gateway_metrics_sampler_t fn;
+    void *ctx;
+} s_samplers[GATEWAY_METRICS_MAX_SAMPLERS];
+static atomic_uint s_sampler_count = 0;
+
+static struct {
+    const char *name;
+    gateway_metrics_report_fn_t fn;
+    void *ctx;
+} s_reports[GATEWAY_METRICS_MAX_REPORTS];
+static atomic_uint s_report_count = 0;
+
+static atomic_flag s_register_lock = ATOMIC_FLAG_INIT;
+
+static void register_lock(void)
+{
+    while (atomic_flag_test_and_set_explicit(&s_register_lock, memory_order_acquire)) {
+        // Registration is init-time only; contention is rare and short
+    }
+}
+
+static void register_unlock(void)
+{
+    atomic_flag_clear_explicit(&s_register_lock, memory_order_release);
+}
+
+/*
+ * ============================================================================
+ *                              REGISTRATION
+ * ============================================================================
+ */
+
+static gateway_metric_t *find_metric(const char *name)
+{
+    unsigned count = atomic_load_explicit(&s_metric_count, memory_order_acquire);
+    for (unsigned i = 0; i < count; i++) {
+        if (strcmp(s_metrics[i].name, name) == 0) {
+            return &s_metrics[i];
+        }
+    }
+    return NULL;
+}
+
+static gateway_metric_t *register_metric(const char *name, metric_type_t type,
+                                         const uint32_t *bounds, uint8_t n_bounds)
+{
+    if (!name) {
+        return NULL;
+    }
+
+    register_lock();
+
+    gateway_metric_t *m = find_metric(name);
+    if (m) {
+        register_unlock();
+        if (m->type != type) {
+            ESP_LOGE(TAG, "Metric '%s' already registered with another type", name);
+            return NULL;
+        }
+        return m;
+    }
+
+    unsigned count = atomic_load_explicit(&s_metric_count, memory_order_relaxed);
+    if (count >= GATEWAY_METRICS_MAX) {
+        register_unlock();
+        ESP_LOGW(TAG, "Registry full, '%s' not registered", name);
+        return NULL;
+    }
+
+    m = &s_metrics[count];
+    memset(m, 0, sizeof(*m));
+    m->name = name;
+    m->type = type;
+    if (type == METRIC_GAUGE) {
+        atomic_init(&m->gauge.peak, GAUGE_NO_PEAK);
+    }
+
+    if (type == METRIC_HISTOGRAM) {
+        if (s_hist_count >= GATEWAY_METRICS_MAX_HISTOGRAMS) {
+            register_unlock();
+            ESP_LOGW(TAG, "Histogram pool full, '%s' not registered", name);
+            return NULL;
+        }
+        metric_hist_t *h = &s_hists[s_hist_count++];
+        memset(h, 0, sizeof(*h));
+        h->bounds = bounds;
+        h->n_bounds = n_bounds;
+        m->hist = h;
+    }
+
+    atomic_store_explicit(&s_metric_count, count + 1, memory_order_release);
+    register_unlock();
+    return m;
+}
+
+gateway_metric_t *gateway_metrics_counter(const char *name)
+{
+    return register_metric(name, METRIC_COUNTER, NULL, 0);
+}
+
+gateway_metric_t *gateway_metrics_gauge(const char *name)
+{
+    return register_metric(name, METRIC_GAUGE, NULL, 0);
+}
+
+gateway_metric_t *gateway_metrics_histogram(const char *name,
+                                            const uint32_t *bounds, uint8_t n_bounds)
+{
+    if (!bounds || n_bounds == 0 || n_bounds > GATEWAY_METRICS_HIST_MAX_BOUNDS) {
+        ESP_LOGE(TAG, "Invalid bounds for histogram '%s'", name ? name : "?");
+        return NULL;
+    }
+    for (uint8_t i = 1; i < n_bounds; i++) {
+        if (bounds[i] <= bounds[i - 1]) {
+            ESP_LOGE(TAG, "Histogram '%s' bounds must be ascending", name ? name : "?");
+            return NULL;
+        }
+    }
+    return register_metric(name, METRIC_HISTOGRAM, bounds, n_bounds);
+}
+
+/*
+ * ============================================================================
+ *                                UPDATES
+ * ============================================================================
+ */
+
+void gateway_metrics_counter_add(gateway_metric_t *metric, uint32_t n)
+{
+    if (metric) {
+        atomic_fetch_add_explicit(&metric->counter, n, memory_order_relaxed);
+    }
+}
+
+static void gauge_update_peak(gateway_metric_t *metric, int32_t value)
+{
+    int32_t peak = atomic_load_explicit(&metric->gauge.peak, memory_order_relaxed);
+    while (value > peak &&
+           !atomic_compare_exchange_weak_explicit(&metric->gauge.peak, &peak, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+        // peak reloaded by the failed CAS
+    }
+}
+
+void gateway_metrics_gauge_set(gateway_metric_t *metric, int32_t value)
+{
+    if (!metric) {
+        return;
+    }
+    atomic_store_explicit(&metric->gauge.value, value, memory_order_relaxed);
+    gauge_update_peak(metric, value);
+}
+
+void gateway_metrics_gauge_add(gateway_metric_t *metric, int32_t delta)
+{
+    if (!metric) {
+        return;
+    }
+    int32_t value = atomic_fetch_add_explicit(&metric->gauge.value, delta,
+                                              memory_order_relaxed) + delta;
+    gauge_update_peak(metric, value);
+}
+
+void gateway_metrics_histogram_observe(gateway_metric_t *metric, uint32_t value)
+{
+    if (!metric) {
+        return;
+    }
+
+    metric_hist_t *h = metric->hist;
+    uint8_t bucket = 0;
+    while (bucket < h->n_bounds && value > h->bounds[bucket]) {
+        bucket++;
+    }
+
+    atomic_fetch_add_explicit(&h->buckets[bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+}
+
+/*
+ * ============================================================================
+ *                                READING
+ * ============================================================================
+ */
+
+uint32_t gateway_metrics_counter_get(const gateway_metric_t *metric)
+{
+    if (!metric) {
+        return 0;
+    }
+    return atomic_load_explicit(&((gateway_metric_t *)metric)->counter, memory_order_relaxed);
+}
+
+int32_t gateway_metrics_gauge_get(const gateway_metric_t *metric)
+{
+    if (!metric) {
+        return 0;
+    }
+    return atomic_load_explicit(&((gateway_metric_t *)metric)->gauge.value, memory_order_relaxed);
+}
+
+/*
+ * Snapshot writer: appends to buf and remembers overflow, so the caller
+ * only checks once at the end.
+ */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+} json_writer_t;
+
+static void jw_printf(json_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void jw_printf(json_writer_t *w, const char *fmt, ...)
+{
+    if (w->overflow) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->pos, w->len - w->pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->len - w->pos) {
+        w->overflow = true;
+        return;
+    }
+    w->pos += (size_t)n;
+}
+
+static void write_section(json_writer_t *w, metric_type_t type, const char *key)
+{
+    unsigned count = atomic_load_explicit(&s_metric_count, memory_order_acquire);
+    bool first = true;
+
+    for (unsigned i = 0; i < count; i++) {
+        gateway_metric_t *m = &s_metrics[i];
+        if (m->type != type) {
+            continue;
+        }
+
+        if (first) {
+            jw_printf(w, ",\"%s\":{", key);
+            first = false;
+        } else {
+            jw_printf(w, ",");
+        }
+
+        switch (type) {
+        case METRIC_COUNTER:
+            jw_printf(w, "\"%s\":%" PRIu32, m->name,
+                      (uint32_t)atomic_load_explicit(&m->counter, memory_order_relaxed));
+            break;
+
+        case METRIC_GAUGE: {
+            int32_t value = atomic_load_explicit(&m->gauge.value, memory_order_relaxed);
+            int32_t peak = atomic_load_explicit(&m->gauge.peak, memory_order_relaxed);
+            jw_printf(w, "\"%s\":[%" PRId32 ",%" PRId32 "]", m->name,
+                      value, peak == GAUGE_NO_PEAK ? value : peak);
+            break;
+        }
+
+        case METRIC_HISTOGRAM: {
+            metric_hist_t *h = m->hist;
+            jw_printf(w, "\"%s\":{\"le\":[", m->name);
+            for (uint8_t b = 0; b < h->n_bounds; b++) {
+                jw_printf(w, "%s%" PRIu32, b ? "," : "", h->bounds[b]);
+            }
+            jw_printf(w, "],\"n\":[");
+            for (uint8_t b = 0; b <= h->n_bounds; b++) {
+                jw_printf(w, "%s%" PRIu32, b ? "," : "",
+                          (uint32_t)atomic_load_explicit(&h->buckets[b], memory_order_relaxed));
+            }
+            jw_printf(w, "],\"sum\":%" PRIu64 "}",
+                      (uint64_t)atomic_load_explicit(&h->sum, memory_order_relaxed));
+            break;
+        }
+        }
+    }
+
+    if (!first) {
+        jw_printf(w, "}");
+    }
+}
+
+size_t gateway_metrics_snapshot_json(char *buf, size_t len)
+{
+    if (!buf || len == 0) {
+        return 0;
+    }
+
+    json_writer_t w = { .buf = buf, .len = len };
+
+    jw_printf(&w, "{\"up\":%" PRIu32, (uint32_t)(esp_timer_get_time() / 1000000));
+    write_section(&w, METRIC_COUNTER, "c");
+    write_section(&w, METRIC_GAUGE, "g");
+    write_section(&w, METRIC_HISTOGRAM, "h");
+    jw_printf(&w, "}");
+
+    if (w.overflow) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return w.pos;
+}
+
+/*
+ * ============================================================================
+ *                               SAMPLERS
+ * ============================================================================
+ */
+
+esp_err_t gateway_metrics_register_sampler(gateway_metrics_sampler_t sampler, void *ctx)
+{
+    if (!sampler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    register_lock();
+    unsigned count = atomic_load_explicit(&s_sampler_count, memory_order_relaxed);
+    if (count >= GATEWAY_METRICS_MAX_SAMPLERS) {
+        register_unlock();
+        return ESP_ERR_NO_MEM;
+    }
+    s_samplers[count].fn = sampler;
+    s_samplers[count].ctx = ctx;
+    atomic_store_explicit(&s_sampler_count, count + 1, memory_order_release);
+    register_unlock();
+
+    return ESP_OK;
+}
+
+void gateway_metrics_run_samplers(void)
+{
+    unsigned count = atomic_load_explicit(&s_sampler_count, memory_order_acquire);
+    for (unsigned i = 0; i < count; i++) {
+        s_samplers[i].fn(s_samplers[i].ctx);
+    }
+}
+
+/*
+ * ============================================================================
+ *                                REPORTS
+ * ============================================================================
+ */
+
+esp_err_t gateway_metrics_register_report(const char *name,
+                                          gateway_metrics_report_fn_t writer, void *ctx)
+{
+    if (!name || !writer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    register_lock();
+    unsigned count = atomic_load_explicit(&s_report_count, memory_order_relaxed);
+    if (count >= GATEWAY_METRICS_MAX_REPORTS) {
+        register_unlock();
+        return ESP_ERR_NO_MEM;
+    }
+    s_reports[count].name = name;
+    s_reports[count].fn = writer;
+    s_reports[count].ctx = ctx;
+    atomic_store_explicit(&s_report_count, count + 1, memory_order_release);
+    register_unlock();
+
+    return ESP_OK;
+}
+
+unsigned gateway_metrics_report_count(void)
+{
+    return atomic_load_explicit(&s_report_count, memory_order_acquire);
+}
+
+size_t gateway_metrics_report_json(unsigned index, const char **name, char *buf, size_t len)
+{
+    if (index >= gateway_metrics_report_count() || !buf || len == 0) {
+        return 0;
+    }
+
+    if (name) {
+        *name = s_reports[index].name;
+    }
+    return s_reports[index].fn(buf, len, s_reports[index].ctx);
+}
@@ -0,0 +1,101 @@
+/*
+ * ============================================================================
+ *                  GATEWAY METRICS COMPONENT - PUBLISHER
+ * ============================================================================
+ *
+ * Low-priority task that periodically runs the samplers and publishes a
+ * snapshot. Kept out of gateway_metrics.c so the registry itself builds on
+ * the host without FreeRTOS.
+ */
+
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define TAG "GW_METRICS"
+
+#define PUBLISHER_TASK_STACK      3072
+#define PUBLISHER_TASK_PRIORITY   2       // Below the mesh and MQTT tasks
+#define DEFAULT_INTERVAL_MS       30000
+#define DEFAULT_BUFFER_SIZE       3072    // Fits the per-node latency report
+
+static gateway_metrics_publisher_config_t s_config;
+static char s_topic[96];
+static char *s_buffer = NULL;
+static TaskHandle_t s_task = NULL;
+
+static void publisher_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(s_config.interval_ms));
+
+        gateway_metrics_run_samplers();
+
+        size_t len = gateway_metrics_snapshot_json(s_buffer, s_config.buffer_size);
+        if (len == 0) {
+            ESP_LOGW(TAG, "Snapshot does not fit in %u bytes", (unsigned)s_config.buffer_size);
+            continue;
+        }
+
+        if (s_config.publish(s_topic, s_buffer, s_config.qos) < 0) {
+            ESP_LOGD(TAG, "Metrics publish failed (not connected?)");
+            continue;
+        }
+
+        // Component reports share the buffer, one topic each
+        unsigned reports = gateway_metrics_report_count();
+        for (unsigned i = 0; i < reports; i++) {
+            const char *name = NULL;
+            char topic[sizeof(s_topic)];
+
+            if (gateway_metrics_report_json(i, &name, s_buffer, s_config.buffer_size) == 0) {
+                continue;
+            }
+            snprintf(topic, sizeof(topic), "%s/gateway/%s", s_config.topic_prefix, name);
+            s_config.publish(topic, s_buffer, s_config.qos);
+        }
+    }
+}
+
+esp_err_t gateway_metrics_publisher_start(const gateway_metrics_publisher_config_t *config)
+{
+    if (!config || !config->topic_prefix || !config->publish) {
+        ESP_LOGE(TAG, "Invalid publisher configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    if (s_config.interval_ms == 0) {
+        s_config.interval_ms = DEFAULT_INTERVAL_MS;
+    }
+    if (s_config.buffer_size == 0) {
+        s_config.buffer_size = DEFAULT_BUFFER_SIZE;
+    }
+
+    snprintf(s_topic, sizeof(s_topic), "%s/gateway/metrics", s_config.topic_prefix);
+
+    s_buffer = malloc(s_config.buffer_size);
+    if (!s_buffer) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(publisher_task, "gw_metrics", PUBLISHER_TASK_STACK, NULL,
+                    PUBLISHER_TASK_PRIORITY, &s_task) != pdPASS) {
+        free(s_buffer);
+        s_buffer = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Publishing metrics to %s every %" PRIu32 " ms", s_topic, s_config.interval_ms);
+    return ESP_OK;
+}
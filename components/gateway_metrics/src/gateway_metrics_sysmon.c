@@ -0,0 +1,208 @@
+/*
+ * ============================================================================
+ *              GATEWAY METRICS COMPONENT - SYSTEM MONITOR
+ * ============================================================================
+ *
+ * Heap gauges (sampler) and a per-task report (CPU share, stack high-water
+ * mark, priority) published on "<prefix>/gateway/tasks".
+ *
+ * Requires CONFIG_FREERTOS_USE_TRACE_FACILITY for the task list and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS for CPU shares; without them the
+ * corresponding fields are omitted.
+ */
+
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+#define TAG "GW_SYSMON"
+
+#define SYSMON_MAX_TASKS    32
+
+typedef struct {
+    gateway_metric_t *free;
+    gateway_metric_t *min_free;
+    gateway_metric_t *largest;
+} heap_gauges_t;
+
+static heap_gauges_t s_heap_internal;
+#if CONFIG_SPIRAM
+static heap_gauges_t s_heap_psram;
+#endif
+
+#if configUSE_TRACE_FACILITY
+static TaskStatus_t s_tasks[SYSMON_MAX_TASKS];
+
+#if configGENERATE_RUN_TIME_STATS
+// Previous run-time counters, keyed by task number, to compute per-window CPU
+static struct {
+    UBaseType_t task_number;
+    configRUN_TIME_COUNTER_TYPE runtime;
+} s_prev[SYSMON_MAX_TASKS];
+static unsigned s_prev_count = 0;
+static configRUN_TIME_COUNTER_TYPE s_prev_total = 0;
+#endif
+#endif
+
+static bool s_enabled = false;
+
+/*
+ * ============================================================================
+ *                              HEAP SAMPLER
+ * ============================================================================
+ */
+
+static void sample_heap(const heap_gauges_t *g, uint32_t caps)
+{
+    gateway_metrics_gauge_set(g->free, (int32_t)heap_caps_get_free_size(caps));
+    gateway_metrics_gauge_set(g->min_free, (int32_t)heap_caps_get_minimum_free_size(caps));
+    gateway_metrics_gauge_set(g->largest, (int32_t)heap_caps_get_largest_free_block(caps));
+}
+
+static void sysmon_sampler(void *ctx)
+{
+    sample_heap(&s_heap_internal, MALLOC_CAP_INTERNAL);
+#if CONFIG_SPIRAM
+    sample_heap(&s_heap_psram, MALLOC_CAP_SPIRAM);
+#endif
+}
+
+/*
+ * ============================================================================
+ *                              TASK REPORT
+ * ============================================================================
+ * {"tasks":[{"n":"BTC_TASK","p":19,"hwm":1532,"cpu":41},...]}
+ *   hwm: minimum free stack ever, in bytes
+ *   cpu: share of one core since the previous report, in per-mille
+ */
+
+#if configUSE_TRACE_FACILITY
+
+#if configGENERATE_RUN_TIME_STATS
+static configRUN_TIME_COUNTER_TYPE prev_runtime(UBaseType_t task_number)
+{
+    for (unsigned i = 0; i < s_prev_count; i++) {
+        if (s_prev[i].task_number == task_number) {
+            return s_prev[i].runtime;
+        }
+    }
+    return 0;   // New task: whole lifetime counts as this window
+}
+#endif
+
+static size_t tasks_report(char *buf, size_t len, void *ctx)
+{
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_tasks, SYSMON_MAX_TASKS, &total);
+    size_t pos = 0;
+    int n;
+
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, task report skipped", SYSMON_MAX_TASKS);
+        return 0;
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    configRUN_TIME_COUNTER_TYPE window = total - s_prev_total;
+#endif
+
+    n = snprintf(buf, len, "{\"tasks\":[");
+    if (n < 0 || (size_t)n >= len) {
+        return 0;
+    }
+    pos = (size_t)n;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *t = &s_tasks[i];
+
+        n = snprintf(buf + pos, len - pos, "%s{\"n\":\"%s\",\"p\":%u,\"hwm\":%u",
+                     i ? "," : "", t->pcTaskName,
+                     (unsigned)t->uxCurrentPriority,
+                     (unsigned)(t->usStackHighWaterMark * sizeof(StackType_t)));
+        if (n < 0 || (size_t)n >= len - pos) {
+            return 0;
+        }
+        pos += (size_t)n;
+
+#if configGENERATE_RUN_TIME_STATS
+        if (window > 0) {
+            uint64_t used = t->ulRunTimeCounter - prev_runtime(t->xTaskNumber);
+            n = snprintf(buf + pos, len - pos, ",\"cpu\":%" PRIu32,
+                         (uint32_t)(used * 1000 / window));
+            if (n < 0 || (size_t)n >= len - pos) {
+                return 0;
+            }
+            pos += (size_t)n;
+        }
+#endif
+
+        if (pos + 1 >= len) {
+            return 0;
+        }
+        buf[pos++] = '}';
+        buf[pos] = '\0';
+    }
+
+    n = snprintf(buf + pos, len - pos, "]}");
+    if (n < 0 || (size_t)n >= len - pos) {
+        return 0;
+    }
+    pos += (size_t)n;
+
+#if configGENERATE_RUN_TIME_STATS
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_prev[i].task_number = s_tasks[i].xTaskNumber;
+        s_prev[i].runtime = s_tasks[i].ulRunTimeCounter;
+    }
+    s_prev_count = count;
+    s_prev_total = total;
+#endif
+
+    return pos;
+}
+
+#endif // configUSE_TRACE_FACILITY
+
+/*
+ * ============================================================================
+ *                                 ENABLE
+ * ============================================================================
+ */
+
+esp_err_t gateway_metrics_sysmon_enable(void)
+{
+    if (s_enabled) {
+        return ESP_OK;
+    }
+
+    s_heap_internal.free = gateway_metrics_gauge("heap.int.free");
+    s_heap_internal.min_free = gateway_metrics_gauge("heap.int.min");
+    s_heap_internal.largest = gateway_metrics_gauge("heap.int.largest");
+#if CONFIG_SPIRAM
+    s_heap_psram.free = gateway_metrics_gauge("heap.psram.free");
+    s_heap_psram.min_free = gateway_metrics_gauge("heap.psram.min");
+    s_heap_psram.largest = gateway_metrics_gauge("heap.psram.largest");
+#endif
+
+    esp_err_t err = gateway_metrics_register_sampler(sysmon_sampler, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+#if configUSE_TRACE_FACILITY
+    err = gateway_metrics_register_report("tasks", tasks_report, NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+#else
+    ESP_LOGW(TAG, "CONFIG_FREERTOS_USE_TRACE_FACILITY disabled - no task report");
+#endif
+
+    s_enabled = true;
+    return ESP_OK;
+}
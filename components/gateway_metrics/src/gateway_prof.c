@@ -0,0 +1,155 @@
+/*
+ * ============================================================================
+ *                 GATEWAY METRICS COMPONENT - CYCLE PROFILER
+ * ============================================================================
+ *
+ * Storage, readout and the "prof" report. Recording is inline in
+ * gateway_prof.h.
+ */
+
+#include "gateway_prof.h"
+#include "gateway_metrics.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if CONFIG_GATEWAY_PROF_ENABLE
+
+#include "esp_rom_sys.h"
+
+gateway_prof_stats_t g_gateway_prof[GW_PROF_COUNT] = {
+    [0 ... GW_PROF_COUNT - 1] = { .min = UINT32_MAX },
+};
+
+#endif
+
+static const char *const s_prof_names[GW_PROF_COUNT] = {
+    [GW_PROF_MESH_CONFIG_CB]    = "mesh_config_cb",
+    [GW_PROF_MESH_SENSOR_CB]    = "mesh_sensor_cb",
+    [GW_PROF_MESH_VENDOR_CB]    = "mesh_vendor_cb",
+    [GW_PROF_PARSE_COMPOSITION] = "parse_composition",
+    [GW_PROF_BRIDGE_VENDOR]     = "bridge_vendor",
+    [GW_PROF_BRIDGE_SENSOR]     = "bridge_sensor",
+    [GW_PROF_BRIDGE_IMU]        = "bridge_imu",
+    [GW_PROF_BRIDGE_HEARTRATE]  = "bridge_heartrate",
+};
+
+const char *gateway_prof_name(gateway_prof_id_t id)
+{
+    return (unsigned)id < GW_PROF_COUNT ? s_prof_names[id] : NULL;
+}
+
+#if CONFIG_GATEWAY_PROF_ENABLE
+
+esp_err_t gateway_prof_get(gateway_prof_id_t id, gateway_prof_stats_t *out)
+{
+    if ((unsigned)id >= GW_PROF_COUNT || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = g_gateway_prof[id];
+    return ESP_OK;
+}
+
+void gateway_prof_reset(void)
+{
+    for (unsigned i = 0; i < GW_PROF_COUNT; i++) {
+        memset(&g_gateway_prof[i], 0, sizeof(g_gateway_prof[i]));
+        g_gateway_prof[i].min = UINT32_MAX;
+    }
+}
+
+/*
+ * ============================================================================
+ *                                  REPORT
+ * ============================================================================
+ */
+
+#define APPEND(...) do { \
+        int n = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n < 0 || (size_t)n >= len - pos) { \
+            return 0; \
+        } \
+        pos += (size_t)n; \
+    } while (0)
+
+size_t gateway_prof_json(char *buf, size_t len)
+{
+    size_t pos = 0;
+    bool first = true;
+
+    APPEND("{\"mhz\":%" PRIu32 ",\"f\":{", (uint32_t)esp_rom_get_cpu_ticks_per_us());
+
+    for (unsigned i = 0; i < GW_PROF_COUNT; i++) {
+        // Copy first: the BTC task may update the entry meanwhile
+        gateway_prof_stats_t s = g_gateway_prof[i];
+        if (s.count == 0) {
+            continue;
+        }
+
+        unsigned lo = 0, hi = GW_PROF_BUCKETS - 1;
+        while (lo < hi && s.hist[lo] == 0) {
+            lo++;
+        }
+        while (hi > lo && s.hist[hi] == 0) {
+            hi--;
+        }
+
+        APPEND("%s\"%s\":{\"n\":%" PRIu32 ",\"sum\":%" PRIu64 ",\"min\":%" PRIu32
+               ",\"max\":%" PRIu32 ",\"b0\":%u,\"h\":[",
+               first ? "" : ",", s_prof_names[i], s.count, s.total, s.min, s.max, lo);
+        for (unsigned b = lo; b <= hi; b++) {
+            APPEND("%s%" PRIu32, b == lo ? "" : ",", s.hist[b]);
+        }
+        APPEND("]}");
+        first = false;
+    }
+
+    if (first) {
+        return 0;   // Nothing called yet
+    }
+    APPEND("}}");
+    return pos;
+}
+
+static size_t prof_report(char *buf, size_t len, void *ctx)
+{
+    return gateway_prof_json(buf, len);
+}
+
+esp_err_t gateway_prof_enable(void)
+{
+    static bool s_enabled = false;
+
+    if (s_enabled) {
+        return ESP_OK;
+    }
+    esp_err_t err = gateway_metrics_register_report("prof", prof_report, NULL);
+    if (err == ESP_OK) {
+        s_enabled = true;
+    }
+    return err;
+}
+
+#else // !CONFIG_GATEWAY_PROF_ENABLE
+
+esp_err_t gateway_prof_get(gateway_prof_id_t id, gateway_prof_stats_t *out)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void gateway_prof_reset(void)
+{
+}
+
+size_t gateway_prof_json(char *buf, size_t len)
+{
+    return 0;
+}
+
+esp_err_t gateway_prof_enable(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_GATEWAY_PROF_ENABLE
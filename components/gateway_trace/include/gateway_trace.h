@@ -0,0 +1,197 @@
+/*
+ * ============================================================================
+ *                    GATEWAY TRACE COMPONENT - PUBLIC API
+ * ============================================================================
+ *
+ * WHAT IS THIS COMPONENT?
+ * =======================
+ * A fixed-size binary event ring for the hot paths. ESP_LOGx formatting
+ * takes tens of microseconds and changes the timing of the very races it is
+ * meant to show; a trace record is a cycle-counter read, one atomic
+ * increment and four stores.
+ *
+ * RECORD (16 bytes):
+ * ==================
+ *   uint32 cycles   CPU cycle counter of the recording core
+ *   uint16 event    Event ID (low 14 bits) + phase (top 2 bits)
+ *   uint8  core     Core that recorded it
+ *   uint8  reserved
+ *   uint32 a0, a1   Event arguments (see gateway_trace_event_t)
+ *
+ * The ring keeps the most recent CONFIG_GATEWAY_TRACE_RECORDS records.
+ *
+ * USAGE:
+ * ======
+ * ```c
+ * void my_callback(int event, uint16_t addr)
+ * {
+ *     GW_TRACE_SCOPE(GW_TRACE_EV_MESH_VENDOR_CB, event, addr);   // BEGIN now, END on return
+ *     ...
+ *     GW_TRACE_INSTANT(GW_TRACE_EV_MQTT_PUBACK, msg_id, 0);
+ * }
+ * ```
+ *
+ * DUMP:
+ * =====
+ * gateway_trace_dump() freezes the ring and emits it as binary chunks
+ * (MQTT) or gateway_trace_dump_uart() as "GWTRACE:<hex>" log lines.
+ * tools/trace/gwtrace2chrome.py converts either into Chrome trace-viewer
+ * JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * COST WHEN DISABLED:
+ * ===================
+ * Without CONFIG_GATEWAY_TRACE_ENABLE every macro expands to nothing.
+ */
+
+#ifndef GATEWAY_TRACE_H
+#define GATEWAY_TRACE_H
+
+#include "esp_err.h"
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Event IDs
+ *
+ * Keep in sync with EVENTS in tools/trace/gwtrace2chrome.py. Append only:
+ * IDs are stored in dumps.
+ */
+typedef enum {
+    GW_TRACE_EV_MESH_CONFIG_CB = 1,     /*!< mesh_config_client_cb      a0=event a1=addr */
+    GW_TRACE_EV_MESH_SENSOR_CB,         /*!< mesh_sensor_client_cb      a0=event a1=addr */
+    GW_TRACE_EV_MESH_VENDOR_CB,         /*!< mesh_vendor_client_cb      a0=event a1=addr */
+    GW_TRACE_EV_BRIDGE_VENDOR,          /*!< Bridge vendor handler      a0=opcode a1=src */
+    GW_TRACE_EV_BRIDGE_SENSOR,          /*!< Bridge sensor handler      a0=property a1=src */
+    GW_TRACE_EV_MQTT_PUBLISH,           /*!< wifi_mqtt_publish_async()  a0=qos a1=payload len (END: a0=msg_id) */
+    GW_TRACE_EV_MQTT_PUBACK,            /*!< PUBACK delivered           a0=msg_id */
+    GW_TRACE_EV_LATENCY_ENQUEUE,        /*!< Pending-ack ring push      a0=msg_id a1=slot */
+    GW_TRACE_EV_LATENCY_ACK,            /*!< Pending-ack ring pop       a0=msg_id a1=matched */
+    GW_TRACE_EV_MARK,                   /*!< Free-form marker           a0/a1 user-defined */
+    GW_TRACE_EV_COUNT
+} gateway_trace_event_t;
+
+/** Phase, stored in the top two bits of the event field */
+#define GW_TRACE_PH_INSTANT     0x0000
+#define GW_TRACE_PH_BEGIN       0x4000
+#define GW_TRACE_PH_END         0x8000
+#define GW_TRACE_EVENT_MASK     0x3FFF
+
+typedef struct {
+    uint32_t cycles;
+    uint16_t event;
+    uint8_t core;
+    uint8_t reserved;
+    uint32_t a0;
+    uint32_t a1;
+} gateway_trace_record_t;
+
+/*
+ * ============================================================================
+ *                               DUMP FORMAT
+ * ============================================================================
+ * A dump is split into chunks; each chunk is this header followed by
+ * `records` records, oldest first. All fields little-endian.
+ */
+
+#define GW_TRACE_MAGIC          0x52545747u     // "GWTR"
+#define GW_TRACE_VERSION        1
+
+typedef struct {
+    uint32_t magic;             /*!< GW_TRACE_MAGIC */
+    uint8_t version;            /*!< GW_TRACE_VERSION */
+    uint8_t record_size;        /*!< sizeof(gateway_trace_record_t) */
+    uint16_t dump_id;           /*!< Increments per dump */
+    uint16_t chunk;             /*!< Chunk index within the dump */
+    uint16_t chunks;            /*!< Total chunks in the dump */
+    uint16_t cycles_per_us;     /*!< CPU clock, to convert cycles to time */
+    uint16_t records;           /*!< Records in this chunk */
+} gateway_trace_chunk_hdr_t;
+
+/** Binary sink for dump chunks; same signature as wifi_mqtt_publish_binary() */
+typedef int (*gateway_trace_publish_fn_t)(const char *topic, const void *data, int len, int qos);
+
+#if CONFIG_GATEWAY_TRACE_ENABLE
+
+#include "esp_cpu.h"
+#include <stdatomic.h>
+
+#define GW_TRACE_RECORDS    CONFIG_GATEWAY_TRACE_RECORDS
+
+_Static_assert((GW_TRACE_RECORDS & (GW_TRACE_RECORDS - 1)) == 0,
+               "CONFIG_GATEWAY_TRACE_RECORDS must be a power of two");
+
+extern gateway_trace_record_t g_gateway_trace_ring[GW_TRACE_RECORDS];
+extern atomic_uint g_gateway_trace_head;
+extern volatile uint8_t g_gateway_trace_frozen;
+
+static inline __attribute__((always_inline))
+void gateway_trace_record(uint16_t event, uint32_t a0, uint32_t a1)
+{
+    if (g_gateway_trace_frozen) {
+        return;
+    }
+    unsigned i = atomic_fetch_add_explicit(&g_gateway_trace_head, 1, memory_order_relaxed);
+    gateway_trace_record_t *r = &g_gateway_trace_ring[i & (GW_TRACE_RECORDS - 1)];
+    r->cycles = (uint32_t)esp_cpu_get_cycle_count();
+    r->event = event;
+    r->core = (uint8_t)esp_cpu_get_core_id();
+    r->a0 = a0;
+    r->a1 = a1;
+}
+
+static inline void gateway_trace_scope_end(const uint16_t *event)
+{
+    gateway_trace_record(*event | GW_TRACE_PH_END, 0, 0);
+}
+
+#define GW_TRACE_BEGIN(ev, a0, a1)   gateway_trace_record((ev) | GW_TRACE_PH_BEGIN, (uint32_t)(a0), (uint32_t)(a1))
+#define GW_TRACE_END(ev, a0, a1)     gateway_trace_record((ev) | GW_TRACE_PH_END, (uint32_t)(a0), (uint32_t)(a1))
+#define GW_TRACE_INSTANT(ev, a0, a1) gateway_trace_record((ev) | GW_TRACE_PH_INSTANT, (uint32_t)(a0), (uint32_t)(a1))
+
+/** BEGIN now, END (no arguments) when the enclosing scope exits, including early returns */
+#define GW_TRACE_SCOPE(ev, a0, a1) \
+    GW_TRACE_BEGIN(ev, a0, a1); \
+    const uint16_t _gw_trace_scope __attribute__((cleanup(gateway_trace_scope_end), unused)) = (ev)
+
+#else
+
+#define GW_TRACE_BEGIN(ev, a0, a1)   ((void)0)
+#define GW_TRACE_END(ev, a0, a1)     ((void)0)
+#define GW_TRACE_INSTANT(ev, a0, a1) ((void)0)
+#define GW_TRACE_SCOPE(ev, a0, a1)   ((void)0)
+
+#endif // CONFIG_GATEWAY_TRACE_ENABLE
+
+/**
+ * Dump the ring as binary chunks
+ *
+ * Recording is paused while the ring is copied out and resumed afterwards
+ * (the ring is not cleared). Chunks are sized to fit the default esp-mqtt
+ * buffer.
+ *
+ * @param publish Binary sink (typically wifi_mqtt_publish_binary)
+ * @param topic   Topic passed to publish for every chunk
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED if tracing is compiled out,
+ *         ESP_FAIL if a chunk could not be published
+ */
+esp_err_t gateway_trace_dump(gateway_trace_publish_fn_t publish, const char *topic);
+
+/**
+ * Dump the ring to the console as "GWTRACE:<hex>" lines (one per chunk)
+ *
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED if tracing is compiled out
+ */
+esp_err_t gateway_trace_dump_uart(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GATEWAY_TRACE_H
@@ -0,0 +1,141 @@
+/*
+ * ============================================================================
+ *                    GATEWAY TRACE COMPONENT - RING AND DUMP
+ * ============================================================================
+ *
+ * The ring itself is written inline from gateway_trace.h; this file owns the
+ * storage and serializes it. A dump freezes recording, waits briefly for
+ * writers that were mid-record, copies the ring out chunk by chunk and
+ * unfreezes.
+ */
+
+#include "gateway_trace.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "GW_TRACE"
+
+// Records per chunk: 16 + 60 * 16 = 976 bytes, under esp-mqtt's 1024 buffer
+#define CHUNK_RECORDS   60
+
+#if CONFIG_GATEWAY_TRACE_ENABLE
+
+gateway_trace_record_t g_gateway_trace_ring[GW_TRACE_RECORDS];
+atomic_uint g_gateway_trace_head = 0;
+volatile uint8_t g_gateway_trace_frozen = 0;
+
+static uint16_t s_dump_id = 0;
+
+typedef struct {
+    gateway_trace_chunk_hdr_t hdr;
+    gateway_trace_record_t records[CHUNK_RECORDS];
+} trace_chunk_t;
+
+typedef int (*chunk_sink_t)(const trace_chunk_t *chunk, size_t len, void *ctx);
+
+/**
+ * Freeze the ring and feed it, oldest record first, to sink in chunks
+ */
+static esp_err_t dump_chunks(chunk_sink_t sink, void *ctx)
+{
+    static trace_chunk_t chunk;     // ~1 KB: keep it off the caller's stack
+    esp_err_t result = ESP_OK;
+
+    g_gateway_trace_frozen = 1;
+    vTaskDelay(1);                  // Let writers that passed the check finish
+
+    unsigned head = atomic_load(&g_gateway_trace_head);
+    unsigned count = head < GW_TRACE_RECORDS ? head : GW_TRACE_RECORDS;
+    unsigned first = head - count;
+    uint16_t chunks = (uint16_t)((count + CHUNK_RECORDS - 1) / CHUNK_RECORDS);
+
+    s_dump_id++;
+
+    for (uint16_t c = 0; c < chunks; c++) {
+        unsigned n = count - c * CHUNK_RECORDS;
+        if (n > CHUNK_RECORDS) {
+            n = CHUNK_RECORDS;
+        }
+
+        chunk.hdr = (gateway_trace_chunk_hdr_t) {
+            .magic = GW_TRACE_MAGIC,
+            .version = GW_TRACE_VERSION,
+            .record_size = sizeof(gateway_trace_record_t),
+            .dump_id = s_dump_id,
+            .chunk = c,
+            .chunks = chunks,
+            .cycles_per_us = (uint16_t)esp_rom_get_cpu_ticks_per_us(),
+            .records = (uint16_t)n,
+        };
+        for (unsigned i = 0; i < n; i++) {
+            unsigned idx = (first + c * CHUNK_RECORDS + i) & (GW_TRACE_RECORDS - 1);
+            chunk.records[i] = g_gateway_trace_ring[idx];
+        }
+
+        size_t len = sizeof(chunk.hdr) + n * sizeof(gateway_trace_record_t);
+        if (sink(&chunk, len, ctx) < 0) {
+            result = ESP_FAIL;
+            break;
+        }
+    }
+
+    g_gateway_trace_frozen = 0;
+
+    ESP_LOGI(TAG, "Dump %u: %u records in %u chunks", s_dump_id, count, chunks);
+    return result;
+}
+
+typedef struct {
+    gateway_trace_publish_fn_t publish;
+    const char *topic;
+} publish_ctx_t;
+
+static int publish_sink(const trace_chunk_t *chunk, size_t len, void *ctx)
+{
+    const publish_ctx_t *p = ctx;
+    return p->publish(p->topic, chunk, (int)len, 0);
+}
+
+esp_err_t gateway_trace_dump(gateway_trace_publish_fn_t publish, const char *topic)
+{
+    if (!publish || !topic) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    publish_ctx_t ctx = { .publish = publish, .topic = topic };
+    return dump_chunks(publish_sink, &ctx);
+}
+
+static int uart_sink(const trace_chunk_t *chunk, size_t len, void *ctx)
+{
+    const uint8_t *p = (const uint8_t *)chunk;
+
+    printf("GWTRACE:");
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", p[i]);
+    }
+    printf("\n");
+    return 0;
+}
+
+esp_err_t gateway_trace_dump_uart(void)
+{
+    return dump_chunks(uart_sink, NULL);
+}
+
+#else // !CONFIG_GATEWAY_TRACE_ENABLE
+
+esp_err_t gateway_trace_dump(gateway_trace_publish_fn_t publish, const char *topic)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gateway_trace_dump_uart(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_GATEWAY_TRACE_ENABLE
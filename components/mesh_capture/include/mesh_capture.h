@@ -0,0 +1,128 @@
+/*
+ * ============================================================================
+ *                    MESH CAPTURE COMPONENT - PUBLIC API
+ * ============================================================================
+ *
+ * WHAT IS THIS COMPONENT?
+ * =======================
+ * Records every vendor and sensor message the provisioner hands to the
+ * bridge (rx time, src, dst, opcode, payload) so production traffic can be
+ * replayed in the lab with tools/host_bench/mesh_replay.
+ *
+ * HOW IT WORKS:
+ * =============
+ *   BTC task ──mesh_capture_record()──→ ring buffer ──→ writer task ──→ sink
+ *                 (copy only, never blocks)                             │
+ *                                                  SPIFFS file ←────────┤
+ *                                          <prefix>/gateway/capture ←───┘
+ *
+ * The hot path only copies the record into a FreeRTOS ring buffer. If the
+ * writer cannot keep up, records are dropped and counted in the
+ * "capture.drop" metric instead of delaying the mesh stack.
+ *
+ * The provisioner stays MQTT-agnostic: the MQTT sink is a publish function
+ * supplied by the application, like gateway_metrics.
+ */
+
+#ifndef MESH_CAPTURE_H
+#define MESH_CAPTURE_H
+
+#include "esp_err.h"
+#include "mesh_capture_format.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MESH_CAPTURE_SINK_SPIFFS,   /*!< Append to a file on the "spiffs" partition */
+    MESH_CAPTURE_SINK_MQTT,     /*!< Publish batches of records */
+} mesh_capture_sink_t;
+
+/** Binary publish function; same signature as wifi_mqtt_publish_binary() */
+typedef int (*mesh_capture_publish_fn_t)(const char *topic, const void *data, int len, int qos);
+
+/** Bytes the publish path still holds; same signature as wifi_mqtt_get_outbox_size() */
+typedef int (*mesh_capture_pending_fn_t)(void);
+
+/**
+ * Capture configuration
+ */
+typedef struct {
+    mesh_capture_sink_t sink;           /*!< Where records go */
+    const char *path;                   /*!< SPIFFS file (default "/capture/mesh.cap") */
+    const char *partition_label;        /*!< SPIFFS partition (default "spiffs") */
+    mesh_capture_publish_fn_t publish;  /*!< MQTT sink / upload function */
+    mesh_capture_pending_fn_t pending;  /*!< Paces the upload (NULL = retry refused chunks only) */
+    const char *topic;                  /*!< MQTT topic (required for the MQTT sink) */
+    size_t ring_size;                   /*!< Ring buffer bytes (0 = default 8192) */
+} mesh_capture_config_t;
+
+/**
+ * Initialize capture (mounts SPIFFS for the SPIFFS sink, creates the writer)
+ *
+ * Capture starts stopped; call mesh_capture_start().
+ *
+ * @param config Configuration (copied; strings must stay valid)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if already
+ *         initialized, ESP_ERR_NO_MEM, or the SPIFFS mount error
+ */
+esp_err_t mesh_capture_init(const mesh_capture_config_t *config);
+
+/**
+ * Start capturing
+ *
+ * SPIFFS: truncates the capture file. MQTT: publishes the file header first.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t mesh_capture_start(void);
+
+/** Stop capturing; buffered records are still written */
+void mesh_capture_stop(void);
+
+/** True while capturing */
+bool mesh_capture_is_active(void);
+
+/**
+ * Publish the SPIFFS capture file with the configured publish function
+ *
+ * The file is sent in order as QoS 1 chunks, so concatenating the
+ * payloads reproduces it. Capture must be stopped.
+ *
+ * The upload runs in the writer task, so this returns at once and may be
+ * called from the MQTT task (a gateway command). Each chunk waits until
+ * pending() is at most 8 KiB and is retried while the publish function
+ * refuses it; the upload stops, with an error log, after 30 s without
+ * progress. The outcome is logged.
+ *
+ * @param topic Destination topic (must stay valid until the upload ends)
+ * @return ESP_OK (upload started), ESP_ERR_INVALID_STATE (capturing,
+ *         uploading, wrong sink), ESP_ERR_NOT_FOUND (no file)
+ */
+esp_err_t mesh_capture_upload(const char *topic);
+
+/**
+ * Record one message (called by the provisioner before the bridge handler)
+ *
+ * Cheap no-op while capture is stopped. Never blocks.
+ *
+ * @param kind   MESH_CAPTURE_VENDOR or MESH_CAPTURE_SENSOR
+ * @param src    Source address
+ * @param dst    Destination address
+ * @param opcode Vendor opcode or sensor property ID
+ * @param data   Payload (vendor bytes, or the int32 sensor value)
+ * @param len    Payload length (truncated to 255)
+ * @param rx_us  Receive timestamp (esp_timer_get_time())
+ */
+void mesh_capture_record(mesh_capture_kind_t kind, uint16_t src, uint16_t dst,
+                         uint32_t opcode, const void *data, size_t len, int64_t rx_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_CAPTURE_H
@@ -0,0 +1,50 @@
+/*
+ * ============================================================================
+ *                 MESH CAPTURE - FILE / STREAM FORMAT
+ * ============================================================================
+ *
+ * Portable definition shared by the device capture and the host replay
+ * tool (tools/host_bench/mesh_replay.c). All fields little-endian.
+ *
+ *   [file header]   written once at capture start (optional for readers)
+ *   [record]...     mesh_capture_rec_hdr_t followed by `len` payload bytes
+ *
+ * Records are self-delimiting, so MQTT messages (batches of whole records)
+ * can simply be concatenated, e.g. `mosquitto_sub -N ... > mesh.cap`.
+ *
+ * PAYLOAD:
+ * ========
+ * - MESH_CAPTURE_VENDOR: raw vendor model payload; opcode = vendor opcode
+ * - MESH_CAPTURE_SENSOR: int32 sensor value (as passed to the bridge);
+ *                        opcode = sensor property ID
+ */
+
+#ifndef MESH_CAPTURE_FORMAT_H
+#define MESH_CAPTURE_FORMAT_H
+
+#include <stdint.h>
+
+#define MESH_CAPTURE_MAGIC      0x5041434Du     // "MCAP"
+#define MESH_CAPTURE_VERSION    2       // 2: 16-bit payload length
+
+typedef enum {
+    MESH_CAPTURE_VENDOR = 0,
+    MESH_CAPTURE_SENSOR = 1,
+} mesh_capture_kind_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             /*!< MESH_CAPTURE_MAGIC */
+    uint16_t version;           /*!< MESH_CAPTURE_VERSION */
+    uint16_t rec_hdr_size;      /*!< sizeof(mesh_capture_rec_hdr_t) */
+} mesh_capture_file_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    int64_t rx_us;              /*!< Receive time, microseconds since boot */
+    uint16_t src;               /*!< Source unicast address */
+    uint16_t dst;               /*!< Destination (unicast or group) address */
+    uint32_t opcode;            /*!< Vendor opcode or sensor property ID */
+    uint8_t kind;               /*!< mesh_capture_kind_t */
+    uint16_t len;               /*!< Payload bytes that follow */
+} mesh_capture_rec_hdr_t;
+
+#endif // MESH_CAPTURE_FORMAT_H
@@ -0,0 +1,365 @@
+/*
+ * ============================================================================
+ *                    MESH CAPTURE COMPONENT - IMPLEMENTATION
+ * ============================================================================
+ *
+ * Producer: BTC task (mesh_capture_record), non-blocking ring buffer send.
+ * Consumer: "mesh_capture" task, batches records and writes them to the sink.
+ * File open/close happens only in the writer task, and so does the upload
+ * of the SPIFFS file (mesh_capture_upload() only requests it).
+ */
+
+#include "mesh_capture.h"
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "MESH_CAPTURE"
+
+#define DEFAULT_PATH            "/capture/mesh.cap"
+#define DEFAULT_PARTITION       "spiffs"
+#define DEFAULT_RING_SIZE       8192
+#define BATCH_SIZE              1024    // One MQTT message / one fwrite
+#define FLUSH_INTERVAL_MS       500
+#define WRITER_TASK_STACK       3072
+#define WRITER_TASK_PRIORITY    2       // Same as the metrics publisher
+
+// Upload pacing: a chunk goes out once the publish path has room for it
+#define UPLOAD_PENDING_MAX      (8 * 1024)  // Queued bytes (config.pending) before waiting
+#define UPLOAD_RETRY_MS         100
+#define UPLOAD_STALL_MS         30000       // Give up after this long without progress
+
+static mesh_capture_config_t s_config;
+static RingbufHandle_t s_ring = NULL;
+static TaskHandle_t s_task = NULL;
+static FILE *s_file = NULL;
+
+static volatile bool s_active = false;
+static volatile bool s_start_pending = false;
+
+static uint8_t s_batch[BATCH_SIZE];
+static size_t s_batch_len = 0;
+static uint32_t s_batch_records = 0;
+
+static const char *volatile s_upload_topic = NULL;  // Upload requested, cleared when done
+
+static gateway_metric_t *s_metric_records;
+static gateway_metric_t *s_metric_drop;
+
+static char s_base_path[16];
+
+/*
+ * ============================================================================
+ *                                 HOT PATH
+ * ============================================================================
+ */
+
+void mesh_capture_record(mesh_capture_kind_t kind, uint16_t src, uint16_t dst,
+                         uint32_t opcode, const void *data, size_t len, int64_t rx_us)
+{
+    if (!s_active) {
+        return;
+    }
+
+    void *item = NULL;
+    size_t size = sizeof(mesh_capture_rec_hdr_t) + len;
+    if (len > UINT16_MAX || xRingbufferSendAcquire(s_ring, &item, size, 0) != pdTRUE) {
+        gateway_metrics_counter_inc(s_metric_drop);
+        return;
+    }
+
+    mesh_capture_rec_hdr_t hdr = {
+        .rx_us = rx_us,
+        .src = src,
+        .dst = dst,
+        .opcode = opcode,
+        .kind = (uint8_t)kind,
+        .len = (uint16_t)len,
+    };
+    memcpy(item, &hdr, sizeof(hdr));
+    memcpy((uint8_t *)item + sizeof(hdr), data, len);
+    xRingbufferSendComplete(s_ring, item);
+}
+
+/*
+ * ============================================================================
+ *                                  SINKS
+ * ============================================================================
+ */
+
+static bool sink_write(const void *data, size_t len, int qos)
+{
+    if (s_config.sink == MESH_CAPTURE_SINK_MQTT) {
+        return s_config.publish(s_config.topic, data, (int)len, qos) >= 0;
+    }
+
+    if (!s_file) {
+        return false;
+    }
+    if (fwrite(data, 1, len, s_file) != len) {
+        ESP_LOGE(TAG, "SPIFFS full - capture stopped");
+        s_active = false;
+        return false;
+    }
+    fflush(s_file);
+    return true;
+}
+
+static void flush_batch(void)
+{
+    if (s_batch_len == 0) {
+        return;
+    }
+    if (!sink_write(s_batch, s_batch_len, 1)) {
+        gateway_metrics_counter_add(s_metric_drop, s_batch_records);
+    }
+    s_batch_len = 0;
+    s_batch_records = 0;
+}
+
+static void begin_capture(void)
+{
+    const mesh_capture_file_hdr_t hdr = {
+        .magic = MESH_CAPTURE_MAGIC,
+        .version = MESH_CAPTURE_VERSION,
+        .rec_hdr_size = sizeof(mesh_capture_rec_hdr_t),
+    };
+
+    if (s_config.sink == MESH_CAPTURE_SINK_SPIFFS) {
+        if (s_file) {
+            fclose(s_file);
+        }
+        s_file = fopen(s_config.path, "wb");
+        if (!s_file) {
+            ESP_LOGE(TAG, "Cannot create %s", s_config.path);
+            s_active = false;
+            return;
+        }
+    }
+
+    sink_write(&hdr, sizeof(hdr), 1);
+    ESP_LOGI(TAG, "Capture started → %s",
+             s_config.sink == MESH_CAPTURE_SINK_SPIFFS ? s_config.path : s_config.topic);
+}
+
+/**
+ * Publish one chunk once the publish path has room for it. Waits while
+ * the outbox is over UPLOAD_PENDING_MAX and retries refused publishes,
+ * so the upload follows the broker acks instead of overrunning the outbox.
+ */
+static bool upload_chunk(const char *topic, const uint8_t *data, size_t len)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (1) {
+        bool room = !s_config.pending || s_config.pending() <= UPLOAD_PENDING_MAX;
+        if (room && s_config.publish(topic, data, (int)len, 1) >= 0) {
+            return true;
+        }
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(UPLOAD_STALL_MS)) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(UPLOAD_RETRY_MS));
+    }
+}
+
+static void upload_file(const char *topic)
+{
+    static uint8_t chunk[BATCH_SIZE];
+
+    FILE *f = fopen(s_config.path, "rb");
+    if (!f) {
+        ESP_LOGW(TAG, "Upload: no capture file %s", s_config.path);
+        return;
+    }
+
+    size_t total = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        if (!upload_chunk(topic, chunk, n)) {
+            ESP_LOGE(TAG, "Upload stalled after %u bytes of %s", (unsigned)total, s_config.path);
+            break;
+        }
+        total += n;
+    }
+    fclose(f);
+
+    ESP_LOGI(TAG, "Uploaded %u bytes of %s to %s", (unsigned)total, s_config.path, topic);
+}
+
+static void writer_task(void *arg)
+{
+    while (1) {
+        if (s_start_pending) {
+            s_start_pending = false;
+            s_batch_len = 0;
+            s_batch_records = 0;
+            begin_capture();
+        }
+        if (s_upload_topic && !s_file) {
+            upload_file(s_upload_topic);
+            s_upload_topic = NULL;
+        }
+
+        size_t size = 0;
+        uint8_t *item = xRingbufferReceive(s_ring, &size, pdMS_TO_TICKS(FLUSH_INTERVAL_MS));
+
+        if (!item) {
+            flush_batch();
+            if (!s_active && s_file) {
+                fclose(s_file);
+                s_file = NULL;
+                ESP_LOGI(TAG, "Capture file closed");
+            }
+            continue;
+        }
+
+        if (s_batch_len + size > sizeof(s_batch)) {
+            flush_batch();
+        }
+        if (size > sizeof(s_batch)) {
+            // Larger than a batch: goes out on its own
+            if (!sink_write(item, size, 1)) {
+                gateway_metrics_counter_inc(s_metric_drop);
+            }
+        } else {
+            memcpy(&s_batch[s_batch_len], item, size);
+            s_batch_len += size;
+            s_batch_records++;
+        }
+        vRingbufferReturnItem(s_ring, item);
+        gateway_metrics_counter_inc(s_metric_records);
+    }
+}
+
+/*
+ * ============================================================================
+ *                                 CONTROL
+ * ============================================================================
+ */
+
+static esp_err_t mount_spiffs(void)
+{
+    // Mount point is the first path component ("/capture/mesh.cap" → "/capture")
+    const char *slash = strchr(s_config.path + 1, '/');
+    size_t n = slash ? (size_t)(slash - s_config.path) : strlen(s_config.path);
+    if (n >= sizeof(s_base_path)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(s_base_path, s_config.path, n);
+    s_base_path[n] = '\0';
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = s_base_path,
+        .partition_label = s_config.partition_label,
+        .max_files = 2,
+        .format_if_mount_failed = true,
+    };
+    esp_err_t err = esp_vfs_spiffs_register(&conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "SPIFFS mount failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    size_t total = 0, used = 0;
+    esp_spiffs_info(s_config.partition_label, &total, &used);
+    ESP_LOGI(TAG, "SPIFFS %s: %u / %u bytes used", s_base_path, (unsigned)used, (unsigned)total);
+    return ESP_OK;
+}
+
+esp_err_t mesh_capture_init(const mesh_capture_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->sink == MESH_CAPTURE_SINK_MQTT && (!config->publish || !config->topic)) {
+        ESP_LOGE(TAG, "MQTT sink needs a publish function and topic");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    if (!s_config.path) {
+        s_config.path = DEFAULT_PATH;
+    }
+    if (!s_config.partition_label) {
+        s_config.partition_label = DEFAULT_PARTITION;
+    }
+    if (s_config.ring_size == 0) {
+        s_config.ring_size = DEFAULT_RING_SIZE;
+    }
+
+    if (s_config.sink == MESH_CAPTURE_SINK_SPIFFS) {
+        esp_err_t err = mount_spiffs();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    s_metric_records = gateway_metrics_counter("capture.records");
+    s_metric_drop = gateway_metrics_counter("capture.drop");
+
+    s_ring = xRingbufferCreate(s_config.ring_size, RINGBUF_TYPE_NOSPLIT);
+    if (!s_ring) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(writer_task, "mesh_capture", WRITER_TASK_STACK, NULL,
+                    WRITER_TASK_PRIORITY, &s_task) != pdPASS) {
+        vRingbufferDelete(s_ring);
+        s_ring = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t mesh_capture_start(void)
+{
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_start_pending = true;
+    s_active = true;
+    return ESP_OK;
+}
+
+void mesh_capture_stop(void)
+{
+    if (s_active) {
+        ESP_LOGI(TAG, "Capture stopped");
+    }
+    s_active = false;
+}
+
+bool mesh_capture_is_active(void)
+{
+    return s_active;
+}
+
+esp_err_t mesh_capture_upload(const char *topic)
+{
+    if (!s_task || s_config.sink != MESH_CAPTURE_SINK_SPIFFS || !s_config.publish || !topic) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_active || s_upload_topic) {
+        return ESP_ERR_INVALID_STATE;   // Still capturing, or an upload is running
+    }
+
+    FILE *f = fopen(s_config.path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    fclose(f);
+
+    // The writer task sends it once the file is closed
+    s_upload_topic = topic;
+    return ESP_OK;
+}
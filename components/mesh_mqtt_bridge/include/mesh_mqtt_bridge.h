@@ -71,12 +71,58 @@
 #define MESH_MQTT_BRIDGE_H
 
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Link quality, as judged by the bridge from WiFi RSSI, broker round trip
+ * time and the share of failed publishes (worst of the three)
+ */
+typedef enum {
+    BRIDGE_LINK_GOOD = 0,
+    BRIDGE_LINK_FAIR,
+    BRIDGE_LINK_POOR,
+} bridge_link_quality_t;
+
+/**
+ * LINK ADAPTATION
+ * ===============
+ * The publish path adapts to the link:
+ *
+ *   link   records per publish      QoS
+ *   GOOD   1 (lowest latency)       as the message type asks (0)
+ *   FAIR   up to batch_fair         as the message type asks (0)
+ *   POOR   up to batch_poor         1 for critical types (heart rate), else 0
+ *
+ * Batched records of one message type, from all nodes, go out as a JSON
+ * array, "[{...},{...}]", on <prefix>/<type>/batch (e.g. esp32/imu/batch)
+ * after at most batch_delay_ms. Each record keeps its "node" field.
+ * Fewer, larger publishes cost less airtime and fewer broker round trips
+ * on a lossy link. The link gets worse at once and better only after it
+ * has looked better for a few seconds.
+ *
+ * The latency samples (latency_sample_interval) stay at QoS 1 in every
+ * state: they measure the round trip the policy is based on.
+ *
+ * All fields 0 = defaults.
+ */
+typedef struct {
+    bool disabled;                      /*!< Always GOOD: one record per publish, QoS unchanged */
+    int8_t rssi_fair_dbm;               /*!< RSSI at or below this is fair (default -67) */
+    int8_t rssi_poor_dbm;               /*!< ... poor (default -75) */
+    uint16_t rtt_fair_ms;               /*!< Broker round trip at or above this is fair (default 150) */
+    uint16_t rtt_poor_ms;               /*!< ... poor (default 600) */
+    uint8_t fail_fair_pct;              /*!< Failed publishes (%) at or above this is fair (default 2) */
+    uint8_t fail_poor_pct;              /*!< ... poor (default 10) */
+    uint8_t batch_fair;                 /*!< Records per publish on a fair link (default 4) */
+    uint8_t batch_poor;                 /*!< ... on a poor link (default 16) */
+    uint16_t batch_delay_ms;            /*!< Longest a record waits in a batch (default 250) */
+} bridge_link_policy_t;
+
 /**
  * Bridge configuration
  */
@@ -96,6 +142,18 @@ typedef struct {
      * BLE Mesh application index (usually 0)
      */
     uint16_t mesh_app_idx;
+
+    /**
+     * Latency tracing: publish every Nth message at QoS 1 and time the
+     * broker acknowledgement (0 = off; mesh and queueing hops are still
+     * measured for every message)
+     */
+    uint16_t latency_sample_interval;
+
+    /**
+     * Batching and QoS by link quality (see LINK ADAPTATION)
+     */
+    bridge_link_policy_t link_policy;
 } bridge_config_t;
 
 /**
@@ -120,6 +178,43 @@ typedef struct {
  */
 esp_err_t mesh_mqtt_bridge_init(const bridge_config_t *config);
 
+/**
+ * PUBLISH ACKNOWLEDGEMENT HOOK
+ * ============================
+ *
+ * Forward wifi_mqtt's message_sent and message_published callbacks here so
+ * sampled QoS 1 publishes can be timed from mesh receipt to broker
+ * acknowledgement, with the wait in the MQTT outbox apart from the broker
+ * round trip:
+ *
+ * ```c
+ * wifi_mqtt_config_t mqtt_config = {
+ *     .callbacks.message_sent = mesh_mqtt_bridge_on_sent,
+ *     .callbacks.message_published = mesh_mqtt_bridge_on_published,
+ * };
+ * ```
+ *
+ * Per-node latency histograms (mesh / queue / outbox / net hops) are
+ * published on <prefix>/gateway/latency by the gateway_metrics publisher.
+ * Without message_sent, outbox and net are not measured, and the link
+ * quality goes without round trips.
+ *
+ * @param msg_id Message ID from MQTT_EVENT_PUBLISHED
+ */
+void mesh_mqtt_bridge_on_published(int msg_id);
+
+/**
+ * Publish written to the socket (wifi_mqtt message_sent, see above)
+ *
+ * @param msg_id Message ID of the QoS 1/2 publish
+ */
+void mesh_mqtt_bridge_on_sent(int msg_id);
+
+/**
+ * Current link quality (BRIDGE_LINK_GOOD before any traffic)
+ */
+bridge_link_quality_t mesh_mqtt_bridge_link_quality(void);
+
 #ifdef __cplusplus
 }
 #endif
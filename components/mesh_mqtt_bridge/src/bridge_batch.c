@@ -0,0 +1,201 @@
+/**
+ * ===========================================================================
+ *                      MESH-MQTT BRIDGE - BATCHING
+ * ===========================================================================
+ *
+ * Writers: mesh callback task (add, flush) and the FreeRTOS timer task
+ * (deadline flush), serialized by s_lock. The lock is held while a batch
+ * is handed to wifi_mqtt_publish_async(), which only queues it.
+ */
+
+#include "bridge_batch.h"
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "BRIDGE_BATCH";
+
+#define BATCH_SLOTS         8           // Topics (message types) batched at the same time
+#define BATCH_BUF_SIZE      1024        // One esp-mqtt buffer
+#define BATCH_TOPIC_MAX     64
+
+typedef struct {
+    char topic[BATCH_TOPIC_MAX];        // "" = free
+    int qos;                            // Highest of the records
+    unsigned records;
+    int len;
+    int64_t deadline_us;
+    char buf[BATCH_BUF_SIZE];           // "[rec,rec" - "]" added when sent
+} batch_t;
+
+static batch_t *s_batches;              // BATCH_SLOTS, allocated on first use
+static SemaphoreHandle_t s_lock;
+static TimerHandle_t s_timer;
+static bridge_batch_send_t s_send;
+
+static gateway_metric_t *s_metric_batches;
+static gateway_metric_t *s_metric_batched;
+
+static void batch_send(batch_t *b)
+{
+    b->buf[b->len++] = ']';
+    s_send(b->topic, b->buf, b->len, b->qos);
+    gateway_metrics_counter_inc(s_metric_batches);
+    gateway_metrics_counter_add(s_metric_batched, b->records);
+
+    b->topic[0] = '\0';
+    b->records = 0;
+    b->len = 0;
+}
+
+/** Send the batches past their deadline, arm the timer for the next one */
+static void flush_due(int64_t now)
+{
+    int64_t next = INT64_MAX;
+
+    for (int i = 0; i < BATCH_SLOTS; i++) {
+        batch_t *b = &s_batches[i];
+        if (!b->topic[0]) {
+            continue;
+        }
+        if (b->deadline_us <= now) {
+            batch_send(b);
+        } else if (b->deadline_us < next) {
+            next = b->deadline_us;
+        }
+    }
+
+    if (next != INT64_MAX) {
+        TickType_t ticks = pdMS_TO_TICKS((next - now + 999) / 1000);
+        xTimerChangePeriod(s_timer, ticks ? ticks : 1, 0);
+    }
+}
+
+static void flush_timer_cb(TimerHandle_t timer)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    flush_due(esp_timer_get_time());
+    xSemaphoreGive(s_lock);
+}
+
+static batch_t *batch_find(const char *topic)
+{
+    for (int i = 0; i < BATCH_SLOTS; i++) {
+        if (strcmp(s_batches[i].topic, topic) == 0) {
+            return &s_batches[i];
+        }
+    }
+    return NULL;
+}
+
+/** A free slot, or the one closest to its deadline after sending it */
+static batch_t *batch_claim(void)
+{
+    batch_t *oldest = &s_batches[0];
+
+    for (int i = 0; i < BATCH_SLOTS; i++) {
+        batch_t *b = &s_batches[i];
+        if (!b->topic[0]) {
+            return b;
+        }
+        if (b->deadline_us < oldest->deadline_us) {
+            oldest = b;
+        }
+    }
+    batch_send(oldest);
+    return oldest;
+}
+
+bool bridge_batch_add(const char *topic, const char *record, int len, int qos,
+                      unsigned max_records, uint32_t delay_ms)
+{
+    // "[" + record + "]" must fit on its own
+    if (!s_timer || len <= 0 || len + 2 > BATCH_BUF_SIZE || strlen(topic) >= BATCH_TOPIC_MAX) {
+        return false;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    if (!s_batches) {
+        s_batches = calloc(BATCH_SLOTS, sizeof(batch_t));
+        if (!s_batches) {
+            xSemaphoreGive(s_lock);
+            ESP_LOGW(TAG, "No memory for batching");
+            return false;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    batch_t *b = batch_find(topic);
+    if (b && b->len + 1 + len + 1 > BATCH_BUF_SIZE) {
+        batch_send(b);      // Full: the record starts the next batch
+        b = NULL;
+    }
+
+    bool opened = !b;
+    if (opened) {
+        b = batch_claim();
+        strcpy(b->topic, topic);
+        b->qos = qos;
+        b->deadline_us = now + (int64_t)delay_ms * 1000;
+        b->buf[b->len++] = '[';
+    } else {
+        b->buf[b->len++] = ',';
+    }
+
+    memcpy(b->buf + b->len, record, len);
+    b->len += len;
+    b->records++;
+    if (qos > b->qos) {
+        b->qos = qos;
+    }
+
+    if (b->records >= max_records) {
+        batch_send(b);
+    }
+    if (opened) {
+        flush_due(now);
+    }
+
+    xSemaphoreGive(s_lock);
+    return true;
+}
+
+void bridge_batch_flush(const char *topic)
+{
+    if (!s_lock) {
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_batches) {
+        batch_t *b = batch_find(topic);
+        if (b) {
+            batch_send(b);
+        }
+        flush_due(esp_timer_get_time());
+    }
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t bridge_batch_init(bridge_batch_send_t send)
+{
+    s_send = send;
+    s_metric_batches = gateway_metrics_counter("bridge.batches");
+    s_metric_batched = gateway_metrics_counter("bridge.batched");
+
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        s_timer = xTimerCreate("bridge_batch", 1, pdFALSE, NULL, flush_timer_cb);
+        if (!s_lock || !s_timer) {
+            ESP_LOGE(TAG, "Failed to create batch lock/timer");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
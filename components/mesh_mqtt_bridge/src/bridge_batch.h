@@ -0,0 +1,55 @@
+/**
+ * ===========================================================================
+ *                    MESH-MQTT BRIDGE - BATCHING (PRIVATE)
+ * ===========================================================================
+ *
+ * Collects JSON records per topic while the link is fair or poor and
+ * publishes them as one array. The bridge uses one topic per message
+ * type, so the records of all nodes share a batch:
+ *
+ *   {"node":"0x0010",...}  ┐
+ *   {"node":"0x0011",...}  ├─▶ "[{...},{...},{...}]" on esp32/imu/batch
+ *   {"node":"0x0010",...}  ┘
+ *
+ * A batch goes out when it holds the requested number of records, when
+ * the next record does not fit in BATCH_BUF_SIZE, or batch_delay_ms after
+ * its first record (flush timer, or the next publish if that is earlier).
+ *
+ * The slots are allocated the first time the link degrades. A record that
+ * cannot be batched (no memory, too large) is published on its own.
+ */
+
+#ifndef BRIDGE_BATCH_H
+#define BRIDGE_BATCH_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Publishes a batch or a single record, returns the msg_id or -1
+ */
+typedef int (*bridge_batch_send_t)(const char *topic, const char *payload, int len, int qos);
+
+/**
+ * Create the flush timer
+ */
+esp_err_t bridge_batch_init(bridge_batch_send_t send);
+
+/**
+ * Add a record to the batch of its topic (mesh callback task)
+ *
+ * @param max_records Records per batch
+ * @param delay_ms    Longest the batch may wait
+ * @return true if batched, false if the caller must publish it itself
+ */
+bool bridge_batch_add(const char *topic, const char *record, int len, int qos,
+                      unsigned max_records, uint32_t delay_ms);
+
+/**
+ * Publish the batch of a topic now, if any, and the batches past their
+ * deadline (mesh callback task)
+ */
+void bridge_batch_flush(const char *topic);
+
+#endif // BRIDGE_BATCH_H
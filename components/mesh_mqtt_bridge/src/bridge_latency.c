@@ -0,0 +1,363 @@
+/**
+ * ===========================================================================
+ *                  MESH-MQTT BRIDGE - LATENCY TRACING
+ * ===========================================================================
+ *
+ * Writers: mesh callback task (begin/enqueued) and MQTT task (sent/acked).
+ * Reader:  metrics publisher task (report). Counters are relaxed atomics;
+ * the pending-ack ring hands entries over with an acquire/release msg_id.
+ */
+
+#include "bridge_latency.h"
+#include "bridge_link.h"
+#include "gateway_metrics.h"
+#include "gateway_trace.h"
+#include "esp_timer.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define LATENCY_MAX_NODES       16
+#define LATENCY_PENDING_SLOTS   16      // Sampled QoS 1 publishes awaiting PUBACK
+#define LATENCY_EARLY_SLOTS     4       // Written before enqueued() stored their msg_id
+#define LATENCY_NO_SLOT         0xFF
+
+typedef enum {
+    HOP_MESH,
+    HOP_QUEUE,
+    HOP_OUTBOX,
+    HOP_NET,
+    HOP_COUNT,
+} latency_hop_t;
+
+static const char *const hop_names[HOP_COUNT] = { "mesh", "queue", "outbox", "net" };
+
+// Bucket upper bounds in microseconds (shared by all hops)
+static const uint32_t latency_bounds_us[] = {
+    500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000,
+};
+#define LATENCY_BOUNDS (sizeof(latency_bounds_us) / sizeof(latency_bounds_us[0]))
+
+typedef struct {
+    atomic_uint_least16_t addr;     // 0 = free
+    atomic_uint_least32_t buckets[HOP_COUNT][LATENCY_BOUNDS + 1];
+} node_latency_t;
+
+typedef struct {
+    atomic_int msg_id;              // 0 = free; published last
+    uint8_t slot;
+    int64_t enqueued_us;
+    atomic_llong sent_us;           // 0 = not written yet
+} pending_ack_t;
+
+// Single writer (MQTT task)
+typedef struct {
+    atomic_int msg_id;              // 0 = free; published last
+    int64_t sent_us;
+} early_sent_t;
+
+static node_latency_t s_nodes[LATENCY_MAX_NODES];
+static pending_ack_t s_pending[LATENCY_PENDING_SLOTS];
+static uint8_t s_pending_next = 0;
+static early_sent_t s_early[LATENCY_EARLY_SLOTS];
+static uint8_t s_early_next = 0;
+
+static gateway_metric_t *s_hop_total[HOP_COUNT];
+
+static uint16_t s_sample_interval = 0;
+static uint16_t s_sample_counter = 0;
+
+// Message currently being handled (mesh callback task only)
+static struct {
+    uint8_t slot;
+    int64_t handler_us;
+} s_current = { .slot = LATENCY_NO_SLOT };
+
+/*
+ * ===========================================================================
+ *                              RECORDING
+ * ===========================================================================
+ */
+
+static uint8_t bucket_for(uint32_t us)
+{
+    uint8_t b = 0;
+    while (b < LATENCY_BOUNDS && us > latency_bounds_us[b]) {
+        b++;
+    }
+    return b;
+}
+
+static void record(uint8_t slot, latency_hop_t hop, int64_t elapsed_us)
+{
+    uint32_t us = elapsed_us < 0 ? 0 : (elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us);
+
+    gateway_metrics_histogram_observe(s_hop_total[hop], us);
+
+    if (slot != LATENCY_NO_SLOT) {
+        atomic_fetch_add_explicit(&s_nodes[slot].buckets[hop][bucket_for(us)], 1,
+                                  memory_order_relaxed);
+    }
+}
+
+/**
+ * Find or claim the per-node slot (only the mesh task claims slots)
+ */
+static uint8_t node_slot(uint16_t addr)
+{
+    uint8_t free_slot = LATENCY_NO_SLOT;
+
+    for (uint8_t i = 0; i < LATENCY_MAX_NODES; i++) {
+        uint16_t a = atomic_load_explicit(&s_nodes[i].addr, memory_order_relaxed);
+        if (a == addr) {
+            return i;
+        }
+        if (a == 0 && free_slot == LATENCY_NO_SLOT) {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot != LATENCY_NO_SLOT) {
+        atomic_store_explicit(&s_nodes[free_slot].addr, addr, memory_order_release);
+    }
+    return free_slot;   // LATENCY_NO_SLOT if table full: totals only
+}
+
+void bridge_latency_begin(uint16_t src_addr, int64_t rx_us)
+{
+    s_current.handler_us = esp_timer_get_time();
+    s_current.slot = node_slot(src_addr);
+
+    if (rx_us > 0) {
+        record(s_current.slot, HOP_MESH, s_current.handler_us - rx_us);
+    }
+}
+
+bool bridge_latency_sample_next(void)
+{
+    if (s_sample_interval == 0) {
+        return false;
+    }
+    if (++s_sample_counter >= s_sample_interval) {
+        s_sample_counter = 0;
+        return true;
+    }
+    return false;
+}
+
+void bridge_latency_enqueued(int msg_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    record(s_current.slot, HOP_QUEUE, now - s_current.handler_us);
+
+    if (msg_id <= 0) {
+        return;
+    }
+
+    // Oldest entry is overwritten if acks never arrive (disconnect)
+    pending_ack_t *p = &s_pending[s_pending_next];
+    s_pending_next = (s_pending_next + 1) % LATENCY_PENDING_SLOTS;
+
+    atomic_store_explicit(&p->msg_id, 0, memory_order_relaxed);
+    p->slot = s_current.slot;
+    p->enqueued_us = now;
+    atomic_store_explicit(&p->sent_us, 0, memory_order_relaxed);
+    atomic_store_explicit(&p->msg_id, msg_id, memory_order_release);
+    GW_TRACE_INSTANT(GW_TRACE_EV_LATENCY_ENQUEUE, msg_id, p->slot);
+}
+
+static pending_ack_t *pending_find(int msg_id)
+{
+    for (int i = 0; i < LATENCY_PENDING_SLOTS; i++) {
+        if (atomic_load_explicit(&s_pending[i].msg_id, memory_order_acquire) == msg_id) {
+            return &s_pending[i];
+        }
+    }
+    return NULL;
+}
+
+/** Write time kept by bridge_latency_sent() for a msg_id it did not know yet, 0 = none */
+static int64_t early_sent_us(int msg_id)
+{
+    for (int i = 0; i < LATENCY_EARLY_SLOTS; i++) {
+        early_sent_t *e = &s_early[i];
+        if (atomic_load_explicit(&e->msg_id, memory_order_acquire) == msg_id) {
+            int64_t us = e->sent_us;
+            if (atomic_load_explicit(&e->msg_id, memory_order_acquire) == msg_id) {
+                return us;
+            }
+        }
+    }
+    return 0;
+}
+
+void bridge_latency_sent(int msg_id)
+{
+    if (msg_id <= 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    pending_ack_t *p = pending_find(msg_id);
+
+    if (p) {
+        // First write only: a retransmission (DUP) keeps the original time
+        int64_t expected = 0;
+        atomic_compare_exchange_strong_explicit(&p->sent_us, &expected, now,
+                                                memory_order_relaxed, memory_order_relaxed);
+        return;
+    }
+
+    // The MQTT task can write it before the mesh task returns from
+    // wifi_mqtt_publish_async(): keep the time for bridge_latency_acked()
+    early_sent_t *e = &s_early[s_early_next];
+    s_early_next = (s_early_next + 1) % LATENCY_EARLY_SLOTS;
+
+    atomic_store_explicit(&e->msg_id, 0, memory_order_relaxed);
+    e->sent_us = now;
+    atomic_store_explicit(&e->msg_id, msg_id, memory_order_release);
+}
+
+void bridge_latency_acked(int msg_id)
+{
+    if (msg_id <= 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    pending_ack_t *p = pending_find(msg_id);
+    if (!p) {
+        return;
+    }
+
+    int expected = msg_id;
+    uint8_t slot = p->slot;
+    int64_t enqueued_us = p->enqueued_us;
+    int64_t sent_us = atomic_load_explicit(&p->sent_us, memory_order_relaxed);
+
+    // Claim it; a concurrent overwrite wins and the sample is discarded
+    bool matched = atomic_compare_exchange_strong_explicit(&p->msg_id, &expected, 0,
+                                                           memory_order_acq_rel,
+                                                           memory_order_relaxed);
+    if (matched) {
+        if (sent_us == 0) {
+            sent_us = early_sent_us(msg_id);
+        }
+        // Without a write time (no message_sent) the outbox wait cannot be
+        // told from the round trip: neither is recorded
+        if (sent_us != 0) {
+            record(slot, HOP_OUTBOX, sent_us - enqueued_us);
+            record(slot, HOP_NET, now - sent_us);
+            bridge_link_rtt((uint32_t)(now - sent_us));
+        }
+    }
+    GW_TRACE_INSTANT(GW_TRACE_EV_LATENCY_ACK, msg_id, matched);
+}
+
+/*
+ * ===========================================================================
+ *                                REPORT
+ * ===========================================================================
+ * {"le_us":[500,...],"nodes":[{"addr":"0x0010","mesh":[..],"queue":[..],"outbox":[..],"net":[..]}]}
+ * Trailing zero buckets are trimmed to keep the payload small.
+ */
+
+static int append(char *buf, size_t len, size_t *pos, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static int append(char *buf, size_t len, size_t *pos, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *pos, len - *pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= len - *pos) {
+        return -1;
+    }
+    *pos += (size_t)n;
+    return 0;
+}
+
+static size_t latency_report(char *buf, size_t len, void *ctx)
+{
+    size_t pos = 0;
+    bool first_node = true;
+
+    if (append(buf, len, &pos, "{\"le_us\":[") < 0) {
+        return 0;
+    }
+    for (size_t b = 0; b < LATENCY_BOUNDS; b++) {
+        if (append(buf, len, &pos, "%s%" PRIu32, b ? "," : "", latency_bounds_us[b]) < 0) {
+            return 0;
+        }
+    }
+    if (append(buf, len, &pos, "],\"nodes\":[") < 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < LATENCY_MAX_NODES; i++) {
+        uint16_t addr = atomic_load_explicit(&s_nodes[i].addr, memory_order_acquire);
+        if (addr == 0) {
+            continue;
+        }
+
+        if (append(buf, len, &pos, "%s{\"addr\":\"0x%04x\"", first_node ? "" : ",", addr) < 0) {
+            return 0;
+        }
+        first_node = false;
+
+        for (int h = 0; h < HOP_COUNT; h++) {
+            uint32_t counts[LATENCY_BOUNDS + 1];
+            int last = -1;
+
+            for (size_t b = 0; b <= LATENCY_BOUNDS; b++) {
+                counts[b] = atomic_load_explicit(&s_nodes[i].buckets[h][b], memory_order_relaxed);
+                if (counts[b]) {
+                    last = (int)b;
+                }
+            }
+
+            if (append(buf, len, &pos, ",\"%s\":[", hop_names[h]) < 0) {
+                return 0;
+            }
+            for (int b = 0; b <= last; b++) {
+                if (append(buf, len, &pos, "%s%" PRIu32, b ? "," : "", counts[b]) < 0) {
+                    return 0;
+                }
+            }
+            if (append(buf, len, &pos, "]") < 0) {
+                return 0;
+            }
+        }
+
+        if (append(buf, len, &pos, "}") < 0) {
+            return 0;
+        }
+    }
+
+    if (append(buf, len, &pos, "]}") < 0) {
+        return 0;
+    }
+    return pos;
+}
+
+/*
+ * ===========================================================================
+ *                                 INIT
+ * ===========================================================================
+ */
+
+void bridge_latency_init(uint16_t sample_interval)
+{
+    s_sample_interval = sample_interval;
+
+    s_hop_total[HOP_MESH] = gateway_metrics_histogram("lat.mesh_us", latency_bounds_us, LATENCY_BOUNDS);
+    s_hop_total[HOP_QUEUE] = gateway_metrics_histogram("lat.queue_us", latency_bounds_us, LATENCY_BOUNDS);
+    s_hop_total[HOP_OUTBOX] = gateway_metrics_histogram("lat.outbox_us", latency_bounds_us, LATENCY_BOUNDS);
+    s_hop_total[HOP_NET] = gateway_metrics_histogram("lat.net_us", latency_bounds_us, LATENCY_BOUNDS);
+
+    gateway_metrics_register_report("latency", latency_report, NULL);
+}
@@ -0,0 +1,69 @@
+/**
+ * ===========================================================================
+ *                  MESH-MQTT BRIDGE - LATENCY TRACING (PRIVATE)
+ * ===========================================================================
+ *
+ * Splits the time from mesh receipt to broker acknowledgement into hops:
+ *
+ *   rx ──mesh──▶ handler ──queue──▶ enqueued ──outbox──▶ written ──net──▶ PUBACK
+ *   │            │                  │                    │                │
+ *   mesh cb      provisioner_*_     wifi_mqtt_publish    message_sent     MQTT_EVENT_
+ *   entry        msg_handler        _async returned      (MQTT task)      PUBLISHED
+ *
+ * - mesh:   time spent in the provisioner callback before our handler runs
+ * - queue:  JSON formatting + wifi_mqtt_publish_async() until it is in the
+ *           esp-mqtt outbox
+ * - outbox: wait in the outbox until the MQTT task writes it to the socket
+ * - net:    broker round trip from that write; the link quality input
+ *
+ * outbox and net are measured for messages sampled at QoS 1 only, and
+ * need wifi_mqtt's message_sent (mqtt:// and mqtts://).
+ *
+ * Totals go to gateway_metrics histograms (lat.*_us); per-node histograms
+ * are published as the "latency" report.
+ */
+
+#ifndef BRIDGE_LATENCY_H
+#define BRIDGE_LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Register histograms and the per-node report
+ *
+ * @param sample_interval Trace every Nth publish at QoS 1 (0 = never)
+ */
+void bridge_latency_init(uint16_t sample_interval);
+
+/**
+ * Start tracing a message (mesh callback task, handler entry)
+ *
+ * @param src_addr Source node
+ * @param rx_us    Timestamp at mesh callback entry
+ */
+void bridge_latency_begin(uint16_t src_addr, int64_t rx_us);
+
+/**
+ * Should the next publish be sampled at QoS 1?
+ */
+bool bridge_latency_sample_next(void);
+
+/**
+ * Publish accepted by wifi_mqtt (mesh callback task)
+ *
+ * @param msg_id Message ID of a sampled QoS 1 publish, or 0 if not sampled
+ */
+void bridge_latency_enqueued(int msg_id);
+
+/**
+ * The MQTT task wrote a publish to the socket (MQTT task)
+ */
+void bridge_latency_sent(int msg_id);
+
+/**
+ * Broker acknowledged a publish (MQTT task)
+ */
+void bridge_latency_acked(int msg_id);
+
+#endif // BRIDGE_LATENCY_H
@@ -0,0 +1,205 @@
+/**
+ * ===========================================================================
+ *                    MESH-MQTT BRIDGE - LINK QUALITY
+ * ===========================================================================
+ *
+ * Writers: mesh callback task (evaluation, publish results), MQTT task
+ * (round trips) and the batch flush timer (publish results). Shared
+ * inputs are relaxed atomics; evaluation state is mesh task only.
+ */
+
+#include "bridge_link.h"
+#include "wifi_mqtt.h"
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+
+static const char *TAG = "BRIDGE_LINK";
+
+#define LINK_EVAL_MS            1000
+#define LINK_RECOVER_EVALS      3       // Evaluations in a row that look better before stepping up
+
+#define DEFAULT_RSSI_FAIR_DBM   -67
+#define DEFAULT_RSSI_POOR_DBM   -75
+#define DEFAULT_RTT_FAIR_MS     150
+#define DEFAULT_RTT_POOR_MS     600
+#define DEFAULT_FAIL_FAIR_PCT   2
+#define DEFAULT_FAIL_POOR_PCT   10
+#define DEFAULT_BATCH_FAIR      4
+#define DEFAULT_BATCH_POOR      16
+#define DEFAULT_BATCH_DELAY_MS  250
+
+static const char *const s_link_names[] = { "good", "fair", "poor" };
+
+static bridge_link_policy_t s_policy = { .disabled = true };
+static atomic_int s_link = BRIDGE_LINK_GOOD;
+
+// Inputs
+static atomic_uint s_rtt_us;            // EWMA, 0 = no sample yet
+static atomic_uint s_attempts;          // Since the last evaluation
+static atomic_uint s_failures;
+
+// Evaluation (mesh callback task)
+static int64_t s_next_eval_us;
+static int s_rssi;                      // EWMA in dBm, 0 = not known
+static unsigned s_fail_pct;             // EWMA
+static unsigned s_better;               // Evaluations in a row below the current quality
+
+static gateway_metric_t *s_metric_quality;
+static gateway_metric_t *s_metric_rtt_ms;
+static gateway_metric_t *s_metric_rssi;
+
+/** Higher value = worse link */
+static bridge_link_quality_t grade(int value, int fair, int poor)
+{
+    return value >= poor ? BRIDGE_LINK_POOR : value >= fair ? BRIDGE_LINK_FAIR : BRIDGE_LINK_GOOD;
+}
+
+static int ewma(int avg, int sample)
+{
+    return (3 * avg + sample) / 4;
+}
+
+static void evaluate(void)
+{
+    bridge_link_quality_t target = BRIDGE_LINK_GOOD, q;
+
+    // RSSI (0 while WiFi is down, or on a target without WiFi)
+    int rssi = wifi_mqtt_get_rssi();
+    if (rssi != 0) {
+        s_rssi = s_rssi ? ewma(s_rssi, rssi) : rssi;
+    }
+    if (s_rssi != 0) {
+        q = grade(-s_rssi, -s_policy.rssi_fair_dbm, -s_policy.rssi_poor_dbm);
+        target = q > target ? q : target;
+    }
+
+    // Round trip
+    unsigned rtt_ms = atomic_load_explicit(&s_rtt_us, memory_order_relaxed) / 1000;
+    if (rtt_ms) {
+        q = grade((int)rtt_ms, s_policy.rtt_fair_ms, s_policy.rtt_poor_ms);
+        target = q > target ? q : target;
+    }
+
+    // Failures in this window
+    unsigned attempts = atomic_exchange_explicit(&s_attempts, 0, memory_order_relaxed);
+    unsigned failures = atomic_exchange_explicit(&s_failures, 0, memory_order_relaxed);
+    if (attempts) {
+        s_fail_pct = (unsigned)ewma((int)s_fail_pct, (int)(failures * 100 / attempts));
+    }
+    q = grade((int)s_fail_pct, s_policy.fail_fair_pct, s_policy.fail_poor_pct);
+    target = q > target ? q : target;
+
+    // Worse at once, better one step at a time after LINK_RECOVER_EVALS
+    bridge_link_quality_t link = atomic_load_explicit(&s_link, memory_order_relaxed);
+    bridge_link_quality_t next = link;
+    if (target > link) {
+        next = target;
+        s_better = 0;
+    } else if (target < link && ++s_better >= LINK_RECOVER_EVALS) {
+        next = link - 1;
+        s_better = 0;
+    } else if (target == link) {
+        s_better = 0;
+    }
+
+    if (next != link) {
+        ESP_LOGI(TAG, "Link %s -> %s (rssi %d dBm, rtt %u ms, failed %u%%)",
+                 s_link_names[link], s_link_names[next], s_rssi, rtt_ms, s_fail_pct);
+        atomic_store_explicit(&s_link, next, memory_order_relaxed);
+    }
+
+    gateway_metrics_gauge_set(s_metric_quality, next);
+    gateway_metrics_gauge_set(s_metric_rtt_ms, (int32_t)rtt_ms);
+    gateway_metrics_gauge_set(s_metric_rssi, s_rssi);
+}
+
+bridge_link_quality_t bridge_link_update(void)
+{
+    if (s_policy.disabled) {
+        return BRIDGE_LINK_GOOD;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (now >= s_next_eval_us) {
+        s_next_eval_us = now + LINK_EVAL_MS * 1000LL;
+        evaluate();
+    }
+    return atomic_load_explicit(&s_link, memory_order_relaxed);
+}
+
+void bridge_link_publish_result(bool ok)
+{
+    atomic_fetch_add_explicit(&s_attempts, 1, memory_order_relaxed);
+    if (!ok) {
+        atomic_fetch_add_explicit(&s_failures, 1, memory_order_relaxed);
+    }
+}
+
+void bridge_link_rtt(uint32_t us)
+{
+    // Single writer (MQTT task): load + store is enough
+    unsigned avg = atomic_load_explicit(&s_rtt_us, memory_order_relaxed);
+    avg = avg ? (3 * avg + us) / 4 : (us ? us : 1);
+    atomic_store_explicit(&s_rtt_us, avg, memory_order_relaxed);
+}
+
+unsigned bridge_link_batch(bridge_link_quality_t link)
+{
+    switch (link) {
+    case BRIDGE_LINK_POOR:
+        return s_policy.batch_poor;
+    case BRIDGE_LINK_FAIR:
+        return s_policy.batch_fair;
+    default:
+        return 1;
+    }
+}
+
+uint32_t bridge_link_batch_delay_ms(void)
+{
+    return s_policy.batch_delay_ms;
+}
+
+int bridge_link_qos(bridge_link_quality_t link, bool critical, int qos)
+{
+    if (link == BRIDGE_LINK_POOR) {
+        return critical ? 1 : 0;
+    }
+    return qos;
+}
+
+bridge_link_quality_t mesh_mqtt_bridge_link_quality(void)
+{
+    return atomic_load_explicit(&s_link, memory_order_relaxed);
+}
+
+void bridge_link_init(const bridge_link_policy_t *policy)
+{
+    s_policy = *policy;
+
+#define POLICY_DEFAULT(field, value) do { if (s_policy.field == 0) s_policy.field = (value); } while (0)
+    POLICY_DEFAULT(rssi_fair_dbm, DEFAULT_RSSI_FAIR_DBM);
+    POLICY_DEFAULT(rssi_poor_dbm, DEFAULT_RSSI_POOR_DBM);
+    POLICY_DEFAULT(rtt_fair_ms, DEFAULT_RTT_FAIR_MS);
+    POLICY_DEFAULT(rtt_poor_ms, DEFAULT_RTT_POOR_MS);
+    POLICY_DEFAULT(fail_fair_pct, DEFAULT_FAIL_FAIR_PCT);
+    POLICY_DEFAULT(fail_poor_pct, DEFAULT_FAIL_POOR_PCT);
+    POLICY_DEFAULT(batch_fair, DEFAULT_BATCH_FAIR);
+    POLICY_DEFAULT(batch_poor, DEFAULT_BATCH_POOR);
+    POLICY_DEFAULT(batch_delay_ms, DEFAULT_BATCH_DELAY_MS);
+#undef POLICY_DEFAULT
+
+    s_metric_quality = gateway_metrics_gauge("link.quality");
+    s_metric_rtt_ms = gateway_metrics_gauge("link.rtt_ms");
+    s_metric_rssi = gateway_metrics_gauge("link.rssi");
+
+    if (!s_policy.disabled) {
+        ESP_LOGI(TAG, "Link adaptation: rssi %d/%d dBm, rtt %u/%u ms, failed %u/%u%%, batch %u/%u (%u ms)",
+                 s_policy.rssi_fair_dbm, s_policy.rssi_poor_dbm,
+                 s_policy.rtt_fair_ms, s_policy.rtt_poor_ms,
+                 s_policy.fail_fair_pct, s_policy.fail_poor_pct,
+                 s_policy.batch_fair, s_policy.batch_poor, s_policy.batch_delay_ms);
+    }
+}
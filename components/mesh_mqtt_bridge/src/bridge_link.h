@@ -0,0 +1,63 @@
+/**
+ * ===========================================================================
+ *                  MESH-MQTT BRIDGE - LINK QUALITY (PRIVATE)
+ * ===========================================================================
+ *
+ * Tracks the uplink and decides how to publish (see LINK ADAPTATION in
+ * mesh_mqtt_bridge.h):
+ *
+ *   RSSI        wifi_mqtt_get_rssi(), read at each evaluation
+ *   round trip  QoS 1 latency samples, bridge_latency_acked() → here
+ *   failures    every publish result
+ *
+ * Each input is smoothed (EWMA) and classified against the policy
+ * thresholds; the link is the worst of the three. It is re-evaluated at
+ * most once per LINK_EVAL_MS, on the publish path.
+ */
+
+#ifndef BRIDGE_LINK_H
+#define BRIDGE_LINK_H
+
+#include "mesh_mqtt_bridge.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Set the policy (0 fields = defaults) and register the link.* metrics
+ */
+void bridge_link_init(const bridge_link_policy_t *policy);
+
+/**
+ * Re-evaluate if due and return the current quality (mesh callback task)
+ */
+bridge_link_quality_t bridge_link_update(void);
+
+/**
+ * Record a publish result (any task)
+ */
+void bridge_link_publish_result(bool ok);
+
+/**
+ * Record a broker round trip (MQTT task)
+ */
+void bridge_link_rtt(uint32_t us);
+
+/**
+ * Records per publish for a link quality (1 = no batching)
+ */
+unsigned bridge_link_batch(bridge_link_quality_t link);
+
+/**
+ * Longest a batched record may wait, in ms
+ */
+uint32_t bridge_link_batch_delay_ms(void);
+
+/**
+ * QoS for a message of the given type
+ *
+ * @param critical Message type that must survive a poor link
+ * @param qos      QoS the message type normally uses
+ */
+int bridge_link_qos(bridge_link_quality_t link, bool critical, int qos);
+
+#endif // BRIDGE_LINK_H
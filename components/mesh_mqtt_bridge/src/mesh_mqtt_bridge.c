@@ -8,7 +8,14 @@
  */
 
 #include "mesh_mqtt_bridge.h"
+#include "bridge_latency.h"
+#include "bridge_link.h"
+#include "bridge_batch.h"
+#include "ble_mesh_provisioner.h"
 #include "wifi_mqtt.h"
+#include "gateway_metrics.h"
+#include "gateway_prof.h"
+#include "gateway_trace.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include <string.h>
@@ -27,6 +34,84 @@ static bool g_bridge_initialized = false;
 // Sensor property IDs (from BLE Mesh spec)
 #define SENSOR_PROPERTY_HEART_RATE  0x2A37
 
+/**
+ * ===========================================================================
+ *                                 METRICS
+ * ===========================================================================
+ * Registered in mesh_mqtt_bridge_init(). Per-opcode receive counters live
+ * next to the routing table (g_route_rx).
+ */
+static gateway_metric_t *g_metric_rx_hr;
+static gateway_metric_t *g_metric_rx_unknown;
+static gateway_metric_t *g_metric_drop;
+static gateway_metric_t *g_metric_pub_fail;
+static gateway_metric_t *g_metric_offline;
+
+/**
+ * Queue a message with wifi_mqtt_publish_async() for bridge_publish() and
+ * bridge_batch, counting the outcome in the metrics and the link quality.
+ */
+static int bridge_send(const char *topic, const char *payload, int len, int qos)
+{
+    GW_TRACE_BEGIN(GW_TRACE_EV_MQTT_PUBLISH, qos, len);
+    int msg_id = wifi_mqtt_publish_async(topic, payload, len, qos, NULL);
+    GW_TRACE_END(GW_TRACE_EV_MQTT_PUBLISH, msg_id, 0);
+
+    bridge_link_publish_result(msg_id >= 0);
+    if (msg_id < 0) {
+        gateway_metrics_counter_inc(g_metric_pub_fail);
+    }
+    return msg_id;
+}
+
+/**
+ * Publish one JSON record the way the link allows (see LINK ADAPTATION):
+ * batched while the link is fair or poor, QoS by message type and link.
+ * Every Nth message is published on its own at QoS 1 so the broker
+ * acknowledgement can be timed; that time also rates the link.
+ * While the uplink is offline (no IP or no broker) the record is dropped
+ * up front: it would only fail, and count against the link quality. Our
+ * own subscriptions do not matter for publishing.
+ *
+ * Batches are per message type, not per node (the records name their
+ * node): with a batch per node topic, more nodes than batch slots would
+ * evict one-record batches on every add. A latency sample may overtake
+ * batched records of its node; each record carries its own time.
+ *
+ * @param topic       Topic of the record on its own (per node)
+ * @param batch_topic Topic of the message type's batches
+ * @param critical    Message type that gets QoS 1 on a poor link
+ */
+static void bridge_publish(const char *topic, const char *batch_topic,
+                           const char *payload, int len, int qos, bool critical)
+{
+    if ((wifi_mqtt_get_state() & WIFI_MQTT_STATE_ONLINE) != WIFI_MQTT_STATE_ONLINE) {
+        gateway_metrics_counter_inc(g_metric_offline);
+        return;
+    }
+
+    bridge_link_quality_t link = bridge_link_update();
+    bool sampled = bridge_latency_sample_next();
+    unsigned batch = bridge_link_batch(link);
+
+    qos = bridge_link_qos(link, critical, qos);
+    if (!sampled && batch > 1 &&
+        bridge_batch_add(batch_topic, payload, len, qos, batch, bridge_link_batch_delay_ms())) {
+        bridge_latency_enqueued(0);
+        return;
+    }
+
+    if (sampled && qos == 0) {
+        qos = 1;
+    }
+    int msg_id = bridge_send(topic, payload, len, qos);
+    if (msg_id < 0) {
+        return;
+    }
+
+    bridge_latency_enqueued(sampled ? msg_id : 0);
+}
+
 /**
  * ===========================================================================
  *                           MESSAGE HANDLERS
@@ -39,21 +124,24 @@ static bool g_bridge_initialized = false;
  */
 static void handle_heartrate_message(uint16_t src_addr, int32_t heart_rate)
 {
+    GW_PROF_SCOPE(GW_PROF_BRIDGE_HEARTRATE);
+
     // Get current timestamp in milliseconds
     uint32_t timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
 
     // Format JSON payload with timestamp
     char payload[128];
-    snprintf(payload, sizeof(payload),
-             "{\"node\":\"0x%04x\",\"heartrate\":%d,\"timestamp\":%" PRIu32 "}",
-             src_addr, (int)heart_rate, timestamp_ms);
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"node\":\"0x%04x\",\"heartrate\":%d,\"timestamp\":%" PRIu32 "}",
+                       src_addr, (int)heart_rate, timestamp_ms);
 
     // Publish to MQTT
-    char topic[64];
+    char topic[64], batch_topic[64];
     snprintf(topic, sizeof(topic), "%s/heartrate/0x%04x", g_bridge_config.mqtt_topic_prefix, src_addr);
+    snprintf(batch_topic, sizeof(batch_topic), "%s/heartrate/batch", g_bridge_config.mqtt_topic_prefix);
 
     ESP_LOGI(TAG, "Publishing HR from 0x%04x: %d bpm to %s", src_addr, (int)heart_rate, topic);
-    wifi_mqtt_publish(topic, payload, 0);
+    bridge_publish(topic, batch_topic, payload, len, 0, true);   // Critical: QoS 1 on a poor link
 }
 
 /**
@@ -61,8 +149,11 @@ static void handle_heartrate_message(uint16_t src_addr, int32_t heart_rate)
  */
 static void handle_imu_message(uint16_t src_addr, uint8_t *data, uint16_t length)
 {
+    GW_PROF_SCOPE(GW_PROF_BRIDGE_IMU);
+
     if (length != 8) {
         ESP_LOGW(TAG, "Invalid IMU message length: %d (expected 8)", length);
+        gateway_metrics_counter_inc(g_metric_drop);
         return;
     }
 
@@ -89,20 +180,21 @@ static void handle_imu_message(uint16_t src_addr, uint8_t *data, uint16_t length
 
     // Format JSON payload
     char payload[256];
-    snprintf(payload, sizeof(payload),
-             "{\"node\":\"0x%04x\",\"time\":%u,"
-             "\"accel\":{\"x\":%.1f,\"y\":%.1f,\"z\":%.1f},"
-             "\"gyro\":{\"x\":%d,\"y\":%d,\"z\":%d}}",
-             src_addr, imu->timestamp_ms,
-             ax, ay, az,
-             gx, gy, gz);
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"node\":\"0x%04x\",\"time\":%u,"
+                       "\"accel\":{\"x\":%.1f,\"y\":%.1f,\"z\":%.1f},"
+                       "\"gyro\":{\"x\":%d,\"y\":%d,\"z\":%d}}",
+                       src_addr, imu->timestamp_ms,
+                       ax, ay, az,
+                       gx, gy, gz);
 
     // Publish to MQTT
-    char topic[64];
+    char topic[64], batch_topic[64];
     snprintf(topic, sizeof(topic), "%s/imu/0x%04x", g_bridge_config.mqtt_topic_prefix, src_addr);
+    snprintf(batch_topic, sizeof(batch_topic), "%s/imu/batch", g_bridge_config.mqtt_topic_prefix);
 
     ESP_LOGI(TAG, "Publishing IMU from 0x%04x to %s", src_addr, topic);
-    wifi_mqtt_publish(topic, payload, 0);
+    bridge_publish(topic, batch_topic, payload, len, 0, false);
 }
 
 /**
@@ -119,10 +211,11 @@ typedef struct {
     uint32_t opcode;
     message_handler_t handler;
     const char *name;
+    const char *metric;     // Receive counter name in gateway_metrics
 } message_route_t;
 
 static const message_route_t message_router[] = {
-    { VENDOR_OP_IMU_DATA, handle_imu_message, "IMU Data" },
+    { VENDOR_OP_IMU_DATA, handle_imu_message, "IMU Data", "rx.imu" },
     // Add new message types here:
     // { VENDOR_OP_SENSOR_DATA, handle_sensor_message, "Sensor Data" },
     // { VENDOR_OP_STATUS, handle_status_message, "Status" },
@@ -130,6 +223,9 @@ static const message_route_t message_router[] = {
 
 #define ROUTER_SIZE (sizeof(message_router) / sizeof(message_route_t))
 
+// Receive counter per route (same index as message_router)
+static gateway_metric_t *g_route_rx[ROUTER_SIZE];
+
 /**
  * ===========================================================================
  *                      SENSOR MESSAGE HANDLER (OVERRIDE)
@@ -145,13 +241,19 @@ void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int
         return;  // Bridge not initialized, ignore messages
     }
 
+    GW_TRACE_SCOPE(GW_TRACE_EV_BRIDGE_SENSOR, property_id, src_addr);
+    GW_PROF_SCOPE(GW_PROF_BRIDGE_SENSOR);
+    bridge_latency_begin(src_addr, provisioner_get_rx_time_us());
+
     ESP_LOGD(TAG, "Received sensor message: property=0x%04x, src=0x%04x, value=%d",
              property_id, src_addr, (int)value);
 
     // Route sensor messages based on property ID
     if (property_id == SENSOR_PROPERTY_HEART_RATE) {
+        gateway_metrics_counter_inc(g_metric_rx_hr);
         handle_heartrate_message(src_addr, value);
     } else {
+        gateway_metrics_counter_inc(g_metric_rx_unknown);
         ESP_LOGD(TAG, "Unhandled sensor property: 0x%04x", property_id);
     }
 }
@@ -172,6 +274,10 @@ void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
         return;  // Bridge not initialized, ignore messages
     }
 
+    GW_TRACE_SCOPE(GW_TRACE_EV_BRIDGE_VENDOR, opcode, src_addr);
+    GW_PROF_SCOPE(GW_PROF_BRIDGE_VENDOR);
+    bridge_latency_begin(src_addr, provisioner_get_rx_time_us());
+
     ESP_LOGD(TAG, "Received vendor message: opcode=0x%06lx, src=0x%04x, len=%d",
              opcode, src_addr, length);
 
@@ -179,12 +285,14 @@ void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
     for (int i = 0; i < ROUTER_SIZE; i++) {
         if (message_router[i].opcode == opcode) {
             ESP_LOGI(TAG, "Routing %s message from 0x%04x", message_router[i].name, src_addr);
+            gateway_metrics_counter_inc(g_route_rx[i]);
             message_router[i].handler(src_addr, data, length);
             return;
         }
     }
 
     // Unknown opcode
+    gateway_metrics_counter_inc(g_metric_rx_unknown);
     ESP_LOGW(TAG, "Unknown vendor opcode: 0x%06lx from 0x%04x", opcode, src_addr);
 }
 
@@ -203,6 +311,31 @@ static void mqtt_message_received(const char *topic, const char *data, int data_
     // TODO: Implement MQTT → Mesh routing if needed
 }
 
+/**
+ * ===========================================================================
+ *                      PUBLISH ACKNOWLEDGEMENT (QoS 1)
+ * ===========================================================================
+ */
+
+void mesh_mqtt_bridge_on_sent(int msg_id)
+{
+    if (!g_bridge_initialized) {
+        return;
+    }
+
+    bridge_latency_sent(msg_id);
+}
+
+void mesh_mqtt_bridge_on_published(int msg_id)
+{
+    if (!g_bridge_initialized) {
+        return;
+    }
+
+    GW_TRACE_INSTANT(GW_TRACE_EV_MQTT_PUBACK, msg_id, 0);
+    bridge_latency_acked(msg_id);
+}
+
 /**
  * ===========================================================================
  *                         BRIDGE INITIALIZATION
@@ -229,6 +362,25 @@ esp_err_t mesh_mqtt_bridge_init(const bridge_config_t *config)
     ESP_LOGI(TAG, "  Mesh net_idx: %d", config->mesh_net_idx);
     ESP_LOGI(TAG, "  Mesh app_idx: %d", config->mesh_app_idx);
     ESP_LOGI(TAG, "  Message routes: %d", ROUTER_SIZE);
+    ESP_LOGI(TAG, "  Latency sample interval: %d", config->latency_sample_interval);
+    ESP_LOGI(TAG, "  Link adaptation: %s", config->link_policy.disabled ? "off" : "on");
+
+    // Register metrics
+    for (int i = 0; i < ROUTER_SIZE; i++) {
+        g_route_rx[i] = gateway_metrics_counter(message_router[i].metric);
+    }
+    g_metric_rx_hr = gateway_metrics_counter("rx.heartrate");
+    g_metric_rx_unknown = gateway_metrics_counter("rx.unknown");
+    g_metric_drop = gateway_metrics_counter("bridge.drop");
+    g_metric_pub_fail = gateway_metrics_counter("bridge.pub_fail");
+    g_metric_offline = gateway_metrics_counter("bridge.offline");
+    bridge_latency_init(config->latency_sample_interval);
+    bridge_link_init(&config->link_policy);
+
+    esp_err_t err = bridge_batch_init(bridge_send);
+    if (err != ESP_OK) {
+        return err;
+    }
 
     // Subscribe to MQTT control topics (optional, for bi-directional communication)
     // char control_topic[64];
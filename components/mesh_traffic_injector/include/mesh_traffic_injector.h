@@ -0,0 +1,77 @@
+/*
+ * ============================================================================
+ *                 MESH TRAFFIC INJECTOR - PUBLIC API
+ * ============================================================================
+ *
+ * WHAT IS THIS COMPONENT?
+ * =======================
+ * A soak-test tool that drives the bridge without a radio: a FreeRTOS task
+ * calls provisioner_vendor_msg_handler() / provisioner_sensor_msg_handler()
+ * with synthetic frames from many virtual nodes, exactly as the mesh
+ * callbacks would. Everything downstream (bridge, wifi_mqtt, broker) runs
+ * for real, so the gateway can be loaded at several times production rate
+ * with one board on the desk.
+ *
+ * MEASURING:
+ * ==========
+ * - The injector counts frames in the "inject.sent" counter and how far it
+ *   fell behind schedule in the "inject.lag_ms" gauge (gateway_metrics).
+ *   A growing lag means the bridge cannot sustain the offered rate.
+ * - tools/host_bench/soak_monitor.py subscribes to the broker and reports
+ *   received rate and loss from the per-node IMU sequence numbers
+ *   (see traffic_gen.h).
+ *
+ * CAVEAT:
+ * =======
+ * The bridge assumes all handler calls come from one task. The injector
+ * only runs while no node is provisioned: it refuses to start otherwise and
+ * stops when the provisioner adds one.
+ */
+
+#ifndef MESH_TRAFFIC_INJECTOR_H
+#define MESH_TRAFFIC_INJECTOR_H
+
+#include "esp_err.h"
+#include "traffic_gen.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Injector configuration
+ */
+typedef struct {
+    traffic_gen_config_t traffic;   /*!< Nodes, rate, jitter, pattern */
+    uint32_t duration_s;            /*!< Stop after this many seconds (0 = until stopped) */
+    uint32_t start_delay_ms;        /*!< Wait before the first frame (e.g. for MQTT to connect) */
+} mesh_traffic_injector_config_t;
+
+/**
+ * Start the injector task
+ *
+ * @param config Injector configuration (copied)
+ * @return ESP_OK on success
+ *         ESP_ERR_INVALID_ARG if config is NULL
+ *         ESP_ERR_INVALID_STATE if already running or mesh nodes are provisioned
+ *         ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t mesh_traffic_injector_start(const mesh_traffic_injector_config_t *config);
+
+/**
+ * Ask the injector task to stop (returns immediately)
+ */
+void mesh_traffic_injector_stop(void);
+
+/**
+ * Check whether the injector task is running
+ */
+bool mesh_traffic_injector_is_running(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_TRAFFIC_INJECTOR_H
@@ -0,0 +1,108 @@
+/*
+ * ============================================================================
+ *              MESH TRAFFIC INJECTOR - FRAME GENERATOR
+ * ============================================================================
+ *
+ * Portable (no ESP-IDF dependency) generator of synthetic mesh frames, shared
+ * by the on-device injector task and the host soak tool.
+ *
+ * SCHEDULE:
+ * =========
+ * Virtual nodes are served round-robin. Frame g belongs to node
+ * (g % node_count) and is that node's k-th frame, k = g / node_count.
+ * The mean gap between frames is 1 / (node_count * rate_hz); each gap is
+ * randomly stretched or shrunk by up to jitter_pct percent.
+ *
+ * LOSS DETECTION:
+ * ===============
+ * IMU frames carry a per-node sequence number in the 16-bit timestamp
+ * field, which the bridge forwards as "time" in the JSON payload. It counts
+ * IMU frames only (heart-rate frames do not consume a number), so a
+ * subscriber sees consecutive values per node and every gap is a loss.
+ */
+
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Must match the bridge / node definitions
+#define TRAFFIC_VENDOR_OP_IMU_DATA      0xC00001
+#define TRAFFIC_SENSOR_PROP_HEART_RATE  0x2A37
+
+/**
+ * IMU payload pattern
+ */
+typedef enum {
+    TRAFFIC_PATTERN_STILL,      /*!< Device lying flat: accel z = 1 g, no rotation */
+    TRAFFIC_PATTERN_WAVE,       /*!< Triangle wave on every axis, phase-shifted per node */
+    TRAFFIC_PATTERN_RANDOM,     /*!< Uniform random bytes (full int8 range) */
+} traffic_pattern_t;
+
+/**
+ * Generator configuration
+ */
+typedef struct {
+    uint16_t node_count;        /*!< Number of virtual nodes (default 10) */
+    uint16_t first_addr;        /*!< Unicast address of the first virtual node (default 0x0100) */
+    uint16_t rate_hz;           /*!< Frames per second per node (default 10) */
+    uint8_t jitter_pct;         /*!< Random +/- variation of each gap, percent (0..100) */
+    uint8_t hr_every;           /*!< Every Nth frame of a node is heart rate (0 = IMU only) */
+    traffic_pattern_t pattern;  /*!< IMU payload pattern */
+    uint32_t seed;              /*!< PRNG seed (0 = fixed default) */
+} traffic_gen_config_t;
+
+typedef enum {
+    TRAFFIC_FRAME_VENDOR,       /*!< Use opcode/data/length */
+    TRAFFIC_FRAME_SENSOR,       /*!< Use property_id/value */
+} traffic_frame_kind_t;
+
+/**
+ * One generated frame, in the shape of the provisioner message handlers
+ */
+typedef struct {
+    traffic_frame_kind_t kind;
+    uint16_t src_addr;
+    uint32_t opcode;
+    uint8_t data[8];
+    uint16_t length;
+    uint16_t property_id;
+    int32_t value;
+} traffic_frame_t;
+
+/**
+ * Generator state (plain struct so it can live on the stack or in .bss)
+ */
+typedef struct {
+    traffic_gen_config_t config;
+    uint64_t index;             /*!< Global frame index g */
+    uint32_t mean_gap_ns;
+    uint32_t rng;
+} traffic_gen_t;
+
+/**
+ * Initialize a generator; zero fields of config take their defaults
+ */
+void traffic_gen_init(traffic_gen_t *gen, const traffic_gen_config_t *config);
+
+/**
+ * Produce the next frame
+ *
+ * @param gen   Generator
+ * @param frame Out: frame to feed to the handlers
+ * @return Gap in nanoseconds until the following frame is due
+ */
+uint32_t traffic_gen_next(traffic_gen_t *gen, traffic_frame_t *frame);
+
+/** Aggregate frame rate over all nodes (frames/s) */
+uint32_t traffic_gen_total_rate(const traffic_gen_t *gen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRAFFIC_GEN_H
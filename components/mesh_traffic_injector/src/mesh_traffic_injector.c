@@ -0,0 +1,163 @@
+/*
+ * ============================================================================
+ *                 MESH TRAFFIC INJECTOR - DEVICE TASK
+ * ============================================================================
+ *
+ * Paces traffic_gen frames against esp_timer and feeds them to the same weak
+ * handlers the mesh callbacks call. Frames that are due within one tick are
+ * sent immediately; when the task falls behind it sends back-to-back (no
+ * frames are skipped) and reports the backlog as inject.lag_ms.
+ *
+ * The handlers are called from this task, not the BTC task, so injecting
+ * next to real nodes would race the mesh callbacks in the bridge. The
+ * injector refuses to start while nodes are provisioned and stops as soon
+ * as one is.
+ */
+
+#include "mesh_traffic_injector.h"
+#include "ble_mesh_provisioner.h"
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+
+#define TAG "MESH_INJECT"
+
+#define INJECTOR_TASK_STACK      4096    // Bridge handlers format JSON with floats
+#define INJECTOR_TASK_PRIORITY   4       // Below the MQTT task (5), above metrics (2)
+#define INJECTOR_BURST_MAX       32      // Yield after this many frames without sleeping
+#define INJECTOR_LOG_INTERVAL_US (10 * 1000000LL)
+
+// Handlers under test (implemented by mesh_mqtt_bridge, weak in the provisioner)
+void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
+                                    uint8_t *data, uint16_t length);
+void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int32_t value);
+
+static mesh_traffic_injector_config_t s_config;
+static traffic_gen_t s_gen;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_stop = false;
+
+static gateway_metric_t *s_metric_sent;
+static gateway_metric_t *s_metric_lag;
+
+static void inject_frame(traffic_frame_t *frame)
+{
+    provisioner_set_rx_time_us(esp_timer_get_time());
+
+    if (frame->kind == TRAFFIC_FRAME_VENDOR) {
+        provisioner_vendor_msg_handler(frame->src_addr, frame->opcode, frame->data, frame->length);
+    } else {
+        provisioner_sensor_msg_handler(frame->src_addr, frame->property_id, frame->value);
+    }
+    gateway_metrics_counter_inc(s_metric_sent);
+}
+
+static void injector_task(void *arg)
+{
+    const int64_t tick_us = portTICK_PERIOD_MS * 1000LL;
+    traffic_frame_t frame;
+    uint32_t burst = 0;
+    uint64_t sent = 0;
+    uint64_t sent_at_log = 0;
+
+    if (s_config.start_delay_ms) {
+        vTaskDelay(pdMS_TO_TICKS(s_config.start_delay_ms));
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = s_config.duration_s ? start_us + s_config.duration_s * 1000000LL : INT64_MAX;
+    int64_t due_ns = start_us * 1000;
+    int64_t last_log_us = start_us;
+
+    ESP_LOGI(TAG, "Injecting %" PRIu32 " frames/s from %u virtual nodes",
+             traffic_gen_total_rate(&s_gen), s_gen.config.node_count);
+
+    while (!s_stop) {
+        int64_t now_us = esp_timer_get_time();
+        if (now_us >= end_us) {
+            break;
+        }
+        if (provisioner_get_node_count() > 0) {
+            ESP_LOGE(TAG, "Mesh node provisioned - stopping injection");
+            break;
+        }
+
+        int64_t ahead_us = due_ns / 1000 - now_us;
+        if (ahead_us >= tick_us) {
+            vTaskDelay((TickType_t)(ahead_us / tick_us));
+            burst = 0;
+            continue;
+        }
+
+        due_ns += traffic_gen_next(&s_gen, &frame);
+        inject_frame(&frame);
+        sent++;
+
+        gateway_metrics_gauge_set(s_metric_lag, ahead_us < 0 ? (int32_t)(-ahead_us / 1000) : 0);
+
+        // Behind schedule: keep going, but let lower-priority tasks (IDLE) run
+        if (++burst >= INJECTOR_BURST_MAX) {
+            vTaskDelay(1);
+            burst = 0;
+        }
+
+        if (now_us - last_log_us >= INJECTOR_LOG_INTERVAL_US) {
+            ESP_LOGI(TAG, "%" PRIu64 " frames/s, lag %" PRId64 " ms",
+                     (sent - sent_at_log) * 1000000 / (uint64_t)(now_us - last_log_us),
+                     ahead_us < 0 ? -ahead_us / 1000 : 0);
+            sent_at_log = sent;
+            last_log_us = now_us;
+        }
+    }
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    ESP_LOGI(TAG, "Injector stopped: %" PRIu64 " frames in %" PRId64 " ms (%" PRIu64 " frames/s sustained)",
+             sent, elapsed_us / 1000,
+             elapsed_us > 0 ? sent * 1000000 / (uint64_t)elapsed_us : 0);
+
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t mesh_traffic_injector_start(const mesh_traffic_injector_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (provisioner_get_node_count() > 0) {
+        ESP_LOGE(TAG, "%u mesh nodes provisioned - injector refused", provisioner_get_node_count());
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    traffic_gen_init(&s_gen, &s_config.traffic);
+
+    s_metric_sent = gateway_metrics_counter("inject.sent");
+    s_metric_lag = gateway_metrics_gauge("inject.lag_ms");
+
+    s_stop = false;
+    if (xTaskCreate(injector_task, "mesh_inject", INJECTOR_TASK_STACK, NULL,
+                    INJECTOR_TASK_PRIORITY, &s_task) != pdPASS) {
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGW(TAG, "Synthetic traffic enabled - stops when a mesh node is provisioned");
+    return ESP_OK;
+}
+
+void mesh_traffic_injector_stop(void)
+{
+    s_stop = true;
+}
+
+bool mesh_traffic_injector_is_running(void)
+{
+    return s_task != NULL;
+}
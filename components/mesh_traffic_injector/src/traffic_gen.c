@@ -0,0 +1,132 @@
+/*
+ * ============================================================================
+ *              MESH TRAFFIC INJECTOR - FRAME GENERATOR
+ * ============================================================================
+ *
+ * Integer-only so the device build pulls in no soft-float code and the host
+ * build produces the exact same frames for the same seed.
+ */
+
+#include "traffic_gen.h"
+#include <string.h>
+
+#define DEFAULT_NODE_COUNT  10
+#define DEFAULT_FIRST_ADDR  0x0100
+#define DEFAULT_RATE_HZ     10
+#define DEFAULT_SEED        0x2545F491u
+
+// Triangle wave period in frames
+#define WAVE_PERIOD         64
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Triangle wave in [-amplitude, amplitude]
+ */
+static int8_t wave(uint32_t t, int8_t amplitude)
+{
+    int32_t phase = (int32_t)(t % WAVE_PERIOD);
+    int32_t half = WAVE_PERIOD / 2;
+    int32_t v = phase < half ? phase : WAVE_PERIOD - phase;     // 0..half..0
+    return (int8_t)((v * 2 - half) * amplitude / half);
+}
+
+void traffic_gen_init(traffic_gen_t *gen, const traffic_gen_config_t *config)
+{
+    memset(gen, 0, sizeof(*gen));
+    gen->config = *config;
+
+    if (gen->config.node_count == 0) {
+        gen->config.node_count = DEFAULT_NODE_COUNT;
+    }
+    if (gen->config.first_addr == 0) {
+        gen->config.first_addr = DEFAULT_FIRST_ADDR;
+    }
+    if (gen->config.rate_hz == 0) {
+        gen->config.rate_hz = DEFAULT_RATE_HZ;
+    }
+    if (gen->config.jitter_pct > 100) {
+        gen->config.jitter_pct = 100;
+    }
+
+    gen->mean_gap_ns = 1000000000u / traffic_gen_total_rate(gen);
+    gen->rng = gen->config.seed ? gen->config.seed : DEFAULT_SEED;
+}
+
+uint32_t traffic_gen_total_rate(const traffic_gen_t *gen)
+{
+    uint32_t rate = (uint32_t)gen->config.node_count * gen->config.rate_hz;
+    return rate ? rate : 1;
+}
+
+static void fill_imu(traffic_gen_t *gen, uint16_t node, uint32_t k, uint8_t *data)
+{
+    int8_t *axes = (int8_t *)&data[2];
+
+    switch (gen->config.pattern) {
+    case TRAFFIC_PATTERN_WAVE: {
+        uint32_t t = k + node * 7u;                 // Nodes out of phase
+        for (int i = 0; i < 6; i++) {
+            axes[i] = wave(t + (uint32_t)i * (WAVE_PERIOD / 6), i < 3 ? 20 : 50);
+        }
+        break;
+    }
+    case TRAFFIC_PATTERN_RANDOM: {
+        uint32_t r1 = xorshift32(&gen->rng);
+        uint32_t r2 = xorshift32(&gen->rng);
+        memcpy(&axes[0], &r1, 4);
+        memcpy(&axes[4], &r2, 2);
+        break;
+    }
+    case TRAFFIC_PATTERN_STILL:
+    default:
+        memset(axes, 0, 6);
+        axes[2] = 10;                               // 1 g in 0.1 g units
+        break;
+    }
+}
+
+uint32_t traffic_gen_next(traffic_gen_t *gen, traffic_frame_t *frame)
+{
+    const traffic_gen_config_t *cfg = &gen->config;
+    uint16_t node = (uint16_t)(gen->index % cfg->node_count);
+    uint32_t k = (uint32_t)(gen->index / cfg->node_count);
+
+    gen->index++;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->src_addr = (uint16_t)(cfg->first_addr + node);
+
+    if (cfg->hr_every && (k + 1) % cfg->hr_every == 0) {
+        frame->kind = TRAFFIC_FRAME_SENSOR;
+        frame->property_id = TRAFFIC_SENSOR_PROP_HEART_RATE;
+        frame->value = 60 + (int32_t)((k + node) % 80);
+    } else {
+        // IMU sequence: k minus the heart-rate frames before it
+        uint32_t seq = cfg->hr_every ? k - k / cfg->hr_every : k;
+
+        frame->kind = TRAFFIC_FRAME_VENDOR;
+        frame->opcode = TRAFFIC_VENDOR_OP_IMU_DATA;
+        frame->length = 8;
+        frame->data[0] = (uint8_t)(seq & 0xFF);     // timestamp_ms, little-endian
+        frame->data[1] = (uint8_t)(seq >> 8);
+        fill_imu(gen, node, k, frame->data);
+    }
+
+    if (cfg->jitter_pct == 0) {
+        return gen->mean_gap_ns;
+    }
+
+    // Uniform in [-jitter, +jitter] percent of the mean gap
+    uint32_t span = gen->mean_gap_ns / 100 * cfg->jitter_pct;
+    uint32_t offset = span ? xorshift32(&gen->rng) % (2 * span + 1) : 0;
+    return gen->mean_gap_ns - span + offset;
+}
@@ -28,7 +28,7 @@ typedef struct {
 } mqtt_bridge_config_t;
 
 /**
- * Sensor data packet structure (same as phone_bridge)
+ * Sensor data packet structure (phone_bridge's, without node_addr)
  */
 typedef struct {
     uint32_t timestamp;            // Milliseconds since boot
@@ -6,11 +6,23 @@
  *
  * Architecture:
  * Phone (GATT Client) <-> ESP32 Gateway (GATT Server + Mesh Proxy) <-> Mesh Nodes
+ *
+ * Up to 3 phones can be connected at once. Each has its own notification
+ * subscription (CCC), MTU, congestion state and queue, so a slow phone
+ * neither delays nor starves the others.
+ *
+ * Node filter (characteristic 0xFFF2, read/write, per phone):
+ * A list of up to 16 little-endian mesh addresses, 2 bytes each. A phone
+ * then only receives samples whose source is one of the unicast addresses
+ * (0x0001-0x7FFF) or that were published to one of the groups
+ * (0xC000-0xFFFF). An empty list, the default on connect, selects every
+ * node. Other addresses are rejected with ESP_GATT_OUT_OF_RANGE.
  */
 
 #ifndef PHONE_BRIDGE_H
 #define PHONE_BRIDGE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
@@ -37,36 +49,140 @@ typedef struct {
     uint8_t heart_rate;       // bpm
 
     uint8_t data_valid;       // 0=invalid, 1=valid
+
+    // Added with node filtering, after the original fields so their
+    // offsets do not change. Not in single-sample notifications.
+    uint16_t node_addr;       // Mesh unicast address of the source node
 } __attribute__((packed)) sensor_data_packet_t;
 
+/** Bytes of a sample before node_addr was added: the single-sample notification */
+#define PHONE_LEGACY_SAMPLE_LEN   offsetof(sensor_data_packet_t, node_addr)
+
+/**
+ * Notification payload: a count followed by that many samples, oldest first
+ *
+ * As many samples as fit in the negotiated ATT MTU (MTU - 3 bytes, at
+ * most 512) share one notification: 7 at an MTU of 247, 15 at 517. At an
+ * MTU of 33 to 35 a batch of one does not fit: each notification is
+ * then a bare sample without node_addr (PHONE_LEGACY_SAMPLE_LEN bytes),
+ * byte for byte the format before batching (tell the formats apart by
+ * length). With the default MTU of 23 not even that fits, so the
+ * phone must request a larger MTU (iOS does, Android apps call
+ * requestMtu()); until it does, its samples are counted in mtu_skipped.
+ */
+typedef struct {
+    uint8_t count;                      // Samples that follow
+    sensor_data_packet_t samples[];
+} __attribute__((packed)) phone_notify_batch_t;
+
+/**
+ * What to do with samples the phone link cannot take yet
+ *
+ * The stack reports congestion (ESP_GATTS_CONGEST_EVT) when its buffers
+ * for the link are full. Notifications then pause and samples queue, up
+ * to queue_samples, until the congestion clears. A notification the stack
+ * refuses keeps its samples queued for the next attempt.
+ */
+typedef enum {
+    PHONE_QUEUE_DROP_OLDEST = 0,        // Full queue: drop the oldest sample (history apps)
+    PHONE_QUEUE_COALESCE_LATEST,        // While congested, keep only the newest sample of each node (live displays)
+} phone_queue_policy_t;
+
+/**
+ * Link settings the gateway requests from each phone when it connects
+ *
+ *                  interval      latency  timeout  data length  PHY
+ *   THROUGHPUT     15-30 ms      0        4 s      251 bytes    2M
+ *   BALANCED       30-60 ms      0        4 s      251 bytes    2M
+ *   LOW_POWER      120-180 ms    4        6 s      (default)    (phone's)
+ *
+ * The intervals follow Apple's accessory guidelines, so iOS accepts them.
+ * The phone has the last word on all of them; the outcome is logged. 2M
+ * PHY is only requested with CONFIG_BT_BLE_50_FEATURES_SUPPORTED.
+ */
+typedef enum {
+    PHONE_PROFILE_BALANCED = 0,
+    PHONE_PROFILE_THROUGHPUT,
+    PHONE_PROFILE_LOW_POWER,
+} phone_link_profile_t;
+
+/**
+ * Phone bridge configuration (all fields optional)
+ */
+typedef struct {
+    phone_queue_policy_t queue_policy;  // Default: PHONE_QUEUE_DROP_OLDEST
+    uint16_t queue_samples;             // Samples queued at most (0 = 64)
+    phone_link_profile_t link_profile;  // Default: PHONE_PROFILE_BALANCED
+} phone_bridge_config_t;
+
+/**
+ * Notification counters since phone_bridge_init()
+ */
+typedef struct {
+    uint32_t notifications;             // Accepted by the stack
+    uint32_t samples;                   // Sent in those notifications
+    uint32_t dropped_oldest;            // Samples dropped from a full queue
+    uint32_t coalesced;                 // Samples replaced by a newer one while congested
+    uint32_t send_failed;               // Notifications the stack refused (samples stay queued) or failed to send
+    uint32_t congestions;               // Times the link reported congestion
+    uint32_t filtered;                  // Samples a phone's node filter left out
+    uint32_t mtu_skipped;               // Samples left out because the phone's MTU is too small for one
+    uint32_t notify_rate;               // Notifications per second, all phones, over the last second
+    uint32_t sample_rate;               // Samples per second in those
+    phone_link_profile_t link_profile;  // Profile the rates were achieved with
+} phone_bridge_stats_t;
+
 /**
  * Initialize phone bridge GATT service
  *
  * Creates BLE GATT service with characteristic for sensor data notifications.
  * Must be called after BLE stack is initialized.
  *
+ * @param config Configuration, NULL for defaults
  * @return ESP_OK on success
  */
-esp_err_t phone_bridge_init(void);
+esp_err_t phone_bridge_init(const phone_bridge_config_t *config);
 
 /**
  * Update sensor data from mesh and notify phone
  *
  * Call this when new sensor data arrives from mesh network.
- * Automatically sends notification to connected phone if subscribed.
+ * For each subscribed phone whose node filter selects data->node_addr or
+ * dst, the sample is queued and notified together with the next ones (see
+ * phone_notify_batch_t): as soon as a notification is full, or at the
+ * latest 25 ms after the first sample was queued. While the link is
+ * congested samples queue (see phone_queue_policy_t). Phones whose filter
+ * leaves the node out never see the sample.
  *
  * @param data Sensor data packet to send
- * @return ESP_OK on success
+ * @param dst  Destination of the mesh message (a group, or the gateway's own
+ *             address), matched against the groups in the node filters
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before phone_bridge_init()
  */
-esp_err_t phone_bridge_update_data(const sensor_data_packet_t *data);
+esp_err_t phone_bridge_update_data(const sensor_data_packet_t *data, uint16_t dst);
 
 /**
  * Check if phone is connected
  *
- * @return true if phone is connected and subscribed to notifications
+ * @return true if at least one phone is connected and subscribed to notifications
  */
 bool phone_bridge_is_connected(void);
 
+/**
+ * Get the notification counters
+ */
+void phone_bridge_get_stats(phone_bridge_stats_t *stats);
+
+/**
+ * Switch the link profile, for connected phones too
+ *
+ * To compare profiles, stream for a few seconds after each switch and
+ * read notify_rate from phone_bridge_get_stats().
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unknown profile
+ */
+esp_err_t phone_bridge_set_profile(phone_link_profile_t profile);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,11 +6,17 @@
 
 #include "phone_bridge.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
 #include "esp_bt_defs.h"
 #include "esp_bt_main.h"
 #include "esp_gatt_common_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "PHONE_BRIDGE";
@@ -18,20 +24,115 @@ static const char *TAG = "PHONE_BRIDGE";
 // UUIDs for our custom service
 // Service UUID: 0000FFF0-0000-1000-8000-00805F9B34FB
 // Characteristic UUID: 0000FFF1-0000-1000-8000-00805F9B34FB
+// Node filter UUID:    0000FFF2-0000-1000-8000-00805F9B34FB
 #define PHONE_BRIDGE_SERVICE_UUID       0xFFF0
 #define SENSOR_DATA_CHAR_UUID           0xFFF1
+#define NODE_FILTER_CHAR_UUID           0xFFF2
 
 #define GATTS_TAG                       "PHONE_GATT"
 #define DEVICE_NAME                     "ESP32-Mesh-Gateway"
 
-#define GATTS_NUM_HANDLE                4
+#define GATTS_NUM_HANDLE                6
+#define PHONE_APP_ID                    0x55    // GATTS app ID (mesh uses different IDs)
+#define LINK_ROLE_MASTER                0       // connect.link_role of links we initiated
+
+// Notification batching (see phone_notify_batch_t)
+#define PHONE_LOCAL_MTU                 517     // Largest ATT MTU accepted from the phone
+#define PHONE_DEFAULT_MTU               23      // Until the phone exchanges MTUs
+#define PHONE_NOTIFY_MAX                512     // Largest attribute value
+#define PHONE_FLUSH_MS                  25      // Longest a sample waits for others to share its notification
+#define PHONE_QUEUE_DEFAULT             64      // Samples queued while the link is congested
+
+#define PHONE_MAX_CONN                  3       // Phones served at once
+#define PHONE_MESH_CONN                 2       // Links the provisioner needs: PB-GATT and proxy client
+#define CCC_NOTIFY                      0x0001
+
+// The stack must allow the phones and the mesh links together (sdkconfig.defaults)
+#if defined(CONFIG_BT_ACL_CONNECTIONS) && CONFIG_BT_ACL_CONNECTIONS < PHONE_MAX_CONN + PHONE_MESH_CONN
+#warning "CONFIG_BT_ACL_CONNECTIONS is below PHONE_MAX_CONN + PHONE_MESH_CONN: phones or mesh links will be refused"
+#endif
+#if defined(CONFIG_BTDM_CTRL_BLE_MAX_CONN) && CONFIG_BTDM_CTRL_BLE_MAX_CONN < PHONE_MAX_CONN + PHONE_MESH_CONN
+#warning "CONFIG_BTDM_CTRL_BLE_MAX_CONN is below PHONE_MAX_CONN + PHONE_MESH_CONN: phones or mesh links will be refused"
+#endif
+
+// Node filter (see phone_bridge.h)
+#define PHONE_FILTER_MAX                16      // Addresses per phone
+#define MESH_ADDR_IS_UNICAST(a)         ((a) >= 0x0001 && (a) <= 0x7FFF)
+#define MESH_ADDR_IS_GROUP(a)           ((a) >= 0xC000)
+
+#define PHONE_RATE_WINDOW_MS            1000    // notify_rate / sample_rate window
+#define PHONE_DATA_LEN_MAX              251     // LE Data Length Extension, octets per packet
+
+/** Link settings requested per profile (see phone_link_profile_t) */
+typedef struct {
+    const char *name;
+    uint16_t min_int;                   // Connection interval, 1.25 ms units
+    uint16_t max_int;
+    uint16_t latency;                   // Connection events the phone may skip
+    uint16_t timeout;                   // Supervision timeout, 10 ms units
+    uint16_t data_len;                  // 0 = leave the default (27)
+    bool phy_2m;
+} link_profile_t;
+
+static const link_profile_t link_profiles[] = {
+    [PHONE_PROFILE_BALANCED]   = { "balanced",   24,  48,  0, 400, PHONE_DATA_LEN_MAX, true },
+    [PHONE_PROFILE_THROUGHPUT] = { "throughput", 12,  24,  0, 400, PHONE_DATA_LEN_MAX, true },
+    [PHONE_PROFILE_LOW_POWER]  = { "low-power",  96, 144,  4, 600, 0,                  false },
+};
 
-// GATT interface and connection IDs
+/**
+ * One connected phone
+ *
+ * in_use, conn_id, mtu, ccc and congested are written by the GATTS
+ * handler only, congested by ESP_GATTS_CONGEST_EVT. The queue (a
+ * ring of queue_cap samples) is used by the caller of
+ * phone_bridge_update_data() and the flush timer under queue_lock, never
+ * by the GATTS handler: it runs in the BTC task, which send_indicate()
+ * may wait on. A slot's queue is emptied the first time
+ * it is found unused or unsubscribed.
+ *
+ * The node filter is written by the GATTS handler and read by
+ * phone_bridge_update_data(), both under conn_lock, which is only held
+ * to copy or match the addresses. conn_lock also covers taking and
+ * releasing a slot (in_use, bda) against phone_bridge_set_profile(), so
+ * every phone gets the latest profile; the link requests themselves are
+ * made after it is released.
+ */
+typedef struct {
+    bool in_use;
+    uint16_t conn_id;
+    esp_bd_addr_t bda;
+    uint16_t mtu;                       // PHONE_DEFAULT_MTU until the phone exchanges MTUs
+    uint16_t ccc;                       // Client Characteristic Configuration of this phone
+    bool congested;
+    bool mtu_warned;
+
+    uint16_t filter[PHONE_FILTER_MAX];  // Unicast addresses and groups
+    uint8_t filter_count;               // 0 = every node
+
+    sensor_data_packet_t *queue;
+    unsigned head;                      // Oldest sample
+    unsigned count;
+} phone_conn_t;
+
+// GATT interface and connections
 static uint16_t phone_bridge_handle_table[GATTS_NUM_HANDLE];
-static uint16_t phone_conn_id = 0;
 static uint16_t phone_gatts_if = ESP_GATT_IF_NONE;
-static bool phone_connected = false;
-static bool notifications_enabled = false;
+static phone_conn_t phone_conns[PHONE_MAX_CONN];
+
+static phone_bridge_config_t bridge_config;
+static unsigned queue_cap;
+static SemaphoreHandle_t queue_lock = NULL;
+static SemaphoreHandle_t conn_lock = NULL;
+static TimerHandle_t flush_timer = NULL;
+static uint8_t notify_buf[PHONE_NOTIFY_MAX];
+
+static phone_bridge_stats_t stats;
+static int64_t rate_start_us;           // Current rate window (queue_lock)
+static uint32_t rate_notifications;
+static uint32_t rate_samples;
+static uint32_t conf_failed;            // Notifications that failed after being accepted (GATTS handler)
+static uint32_t congestions;            // Times a link reported congestion (GATTS handler)
 
 // Current sensor data
 static sensor_data_packet_t current_data = {0};
@@ -42,16 +143,21 @@ static const uint16_t character_declaration_uuid = ESP_GATT_UUID_CHAR_DECLARE;
 static const uint16_t character_client_config_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
 
 static const uint8_t char_prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t char_prop_read_write = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
 
 // Service UUID
 static const uint16_t service_uuid = PHONE_BRIDGE_SERVICE_UUID;
 
-// Characteristic UUID
+// Characteristic UUIDs
 static const uint16_t sensor_data_uuid = SENSOR_DATA_CHAR_UUID;
+static const uint16_t node_filter_uuid = NODE_FILTER_CHAR_UUID;
 
-// Client Characteristic Configuration Descriptor value
+// Client Characteristic Configuration Descriptor value (answered per phone, see phone_conn_t)
 static uint16_t ccc_val = 0x0000;
 
+// Node filter value (answered per phone, see phone_conn_t)
+static uint8_t filter_val[PHONE_FILTER_MAX * sizeof(uint16_t)];
+
 // GATT attribute database
 static const esp_gatts_attr_db_t gatt_db[GATTS_NUM_HANDLE] = {
     // Service Declaration
@@ -95,7 +201,7 @@ static const esp_gatts_attr_db_t gatt_db[GATTS_NUM_HANDLE] = {
 
     // Sensor Data Client Characteristic Configuration Descriptor
     [3] = {
-        {ESP_GATT_AUTO_RSP},
+        {ESP_GATT_RSP_BY_APP},
         {
             ESP_UUID_LEN_16,
             (uint8_t *)&character_client_config_uuid,
@@ -105,22 +211,306 @@ static const esp_gatts_attr_db_t gatt_db[GATTS_NUM_HANDLE] = {
             (uint8_t *)&ccc_val
         }
     },
+
+    // Node Filter Characteristic Declaration
+    [4] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_16,
+            (uint8_t *)&character_declaration_uuid,
+            ESP_GATT_PERM_READ,
+            sizeof(uint8_t),
+            sizeof(char_prop_read_write),
+            (uint8_t *)&char_prop_read_write
+        }
+    },
+
+    // Node Filter Characteristic Value
+    [5] = {
+        {ESP_GATT_RSP_BY_APP},
+        {
+            ESP_UUID_LEN_16,
+            (uint8_t *)&node_filter_uuid,
+            ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+            sizeof(filter_val),
+            0,
+            filter_val
+        }
+    },
 };
 
+static phone_conn_t *conn_find(uint16_t conn_id)
+{
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        if (phone_conns[i].in_use && phone_conns[i].conn_id == conn_id) {
+            return &phone_conns[i];
+        }
+    }
+    return NULL;
+}
+
+static bool conn_subscribed(const phone_conn_t *conn)
+{
+    return conn->in_use && (conn->ccc & CCC_NOTIFY) && phone_gatts_if != ESP_GATT_IF_NONE;
+}
+
+// Whether a phone's node filter lets a sample through (conn_lock held)
+static bool filter_selects(const phone_conn_t *conn, uint16_t src, uint16_t dst)
+{
+    if (conn->filter_count == 0) {
+        return true;
+    }
+    for (unsigned i = 0; i < conn->filter_count; i++) {
+        uint16_t addr = conn->filter[i];
+        if (MESH_ADDR_IS_GROUP(addr) ? addr == dst : addr == src) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Replace a phone's node filter with a written value (GATTS handler)
+static esp_gatt_status_t filter_write(phone_conn_t *conn, const uint8_t *value, uint16_t len)
+{
+    uint16_t filter[PHONE_FILTER_MAX];
+    unsigned count = len / sizeof(uint16_t);
+
+    if (len % sizeof(uint16_t) || count > PHONE_FILTER_MAX) {
+        return ESP_GATT_INVALID_ATTR_LEN;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        filter[i] = value[2 * i + 1] << 8 | value[2 * i];
+        if (!MESH_ADDR_IS_UNICAST(filter[i]) && !MESH_ADDR_IS_GROUP(filter[i])) {
+            ESP_LOGW(TAG, "conn_id=%d filter: 0x%04x is not a unicast or group address",
+                     conn->conn_id, filter[i]);
+            return ESP_GATT_OUT_OF_RANGE;
+        }
+    }
+
+    xSemaphoreTake(conn_lock, portMAX_DELAY);
+    memcpy(conn->filter, filter, count * sizeof(uint16_t));
+    conn->filter_count = count;
+    xSemaphoreGive(conn_lock);
+
+    if (count) {
+        ESP_LOGI(TAG, "conn_id=%d filter: %u addresses, first 0x%04x", conn->conn_id, count, filter[0]);
+    } else {
+        ESP_LOGI(TAG, "conn_id=%d filter: every node", conn->conn_id);
+    }
+    return ESP_GATT_OK;
+}
+
+// Bytes one notification carries at a connection's MTU
+static unsigned notify_payload(const phone_conn_t *conn)
+{
+    unsigned payload = conn->mtu - 3;
+
+    return payload > PHONE_NOTIFY_MAX ? PHONE_NOTIFY_MAX : payload;
+}
+
+// Samples per notification at a connection's MTU (0 = not even one fits
+// behind the count, see legacy_fits())
+static unsigned samples_per_notify(const phone_conn_t *conn)
+{
+    unsigned payload = notify_payload(conn);
+
+    if (payload < sizeof(phone_notify_batch_t) + sizeof(sensor_data_packet_t)) {
+        return 0;
+    }
+    return (payload - sizeof(phone_notify_batch_t)) / sizeof(sensor_data_packet_t);
+}
+
+// Whether a bare sample without the count and node_addr fits (the format
+// before batching)
+static bool legacy_fits(const phone_conn_t *conn)
+{
+    return notify_payload(conn) >= PHONE_LEGACY_SAMPLE_LEN;
+}
+
+// Add a sample, making room as the policy says (queue_lock held)
+static void queue_push(phone_conn_t *conn, const sensor_data_packet_t *sample)
+{
+    if (conn->congested && bridge_config.queue_policy == PHONE_QUEUE_COALESCE_LATEST) {
+        // One sample per node, so a phone following several nodes keeps them all
+        for (unsigned i = 0; i < conn->count; i++) {
+            sensor_data_packet_t *queued = &conn->queue[(conn->head + i) % queue_cap];
+            if (queued->node_addr == sample->node_addr) {
+                *queued = *sample;
+                stats.coalesced++;
+                return;
+            }
+        }
+    }
+    if (conn->count == queue_cap) {
+        conn->head = (conn->head + 1) % queue_cap;
+        conn->count--;
+        stats.dropped_oldest++;
+    }
+    conn->queue[(conn->head + conn->count) % queue_cap] = *sample;
+    conn->count++;
+}
+
+// Notify queued samples while the link takes them: full notifications
+// only, or everything if partial (queue_lock held). Samples leave the
+// queue only once the stack accepted their notification.
+static void queue_send(phone_conn_t *conn, bool partial)
+{
+    if (!conn_subscribed(conn)) {
+        conn->count = 0;        // Nobody to send to
+        return;
+    }
+
+    unsigned per_notify = samples_per_notify(conn);
+    bool legacy = per_notify == 0;
+    if (legacy) {
+        if (!legacy_fits(conn)) {
+            return;             // Until the MTU exchange
+        }
+        per_notify = 1;
+    }
+    while (!conn->congested && conn->count > 0 && (partial || conn->count >= per_notify)) {
+        unsigned n = conn->count < per_notify ? conn->count : per_notify;
+        phone_notify_batch_t *batch = (phone_notify_batch_t *)notify_buf;
+        uint16_t len;
+
+        if (legacy) {
+            memcpy(notify_buf, &conn->queue[conn->head], PHONE_LEGACY_SAMPLE_LEN);
+            len = PHONE_LEGACY_SAMPLE_LEN;
+        } else {
+            batch->count = n;
+            for (unsigned i = 0; i < n; i++) {
+                batch->samples[i] = conn->queue[(conn->head + i) % queue_cap];
+            }
+            len = sizeof(phone_notify_batch_t) + n * sizeof(sensor_data_packet_t);
+        }
+        esp_err_t ret = esp_ble_gatts_send_indicate(
+            phone_gatts_if,
+            conn->conn_id,
+            phone_bridge_handle_table[2],
+            len,
+            notify_buf,
+            false  // notification, not indication
+        );
+        if (ret != ESP_OK) {
+            // Out of buffers, most likely: retry after the congestion
+            // clears, or from the flush timer if none is reported
+            stats.send_failed++;
+            break;
+        }
+        stats.notifications++;
+        stats.samples += n;
+        rate_notifications++;
+        rate_samples += n;
+        conn->head = (conn->head + n) % queue_cap;
+        conn->count -= n;
+    }
+}
+
+// Close the rate window once it is long enough (queue_lock held)
+static void rate_update(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_ms = (now - rate_start_us) / 1000;
+
+    if (elapsed_ms >= PHONE_RATE_WINDOW_MS) {
+        stats.notify_rate = (uint32_t)((int64_t)rate_notifications * 1000 / elapsed_ms);
+        stats.sample_rate = (uint32_t)((int64_t)rate_samples * 1000 / elapsed_ms);
+        rate_start_us = now;
+        rate_notifications = 0;
+        rate_samples = 0;
+    }
+}
+
+// Ask a phone for the link settings of a profile (conn_lock not held:
+// the requests are queued to the BTC task)
+static void conn_apply_profile(uint16_t conn_id, esp_bd_addr_t bda, phone_link_profile_t link_profile)
+{
+    const link_profile_t *profile = &link_profiles[link_profile];
+    esp_ble_conn_update_params_t params = {
+        .min_int = profile->min_int,
+        .max_int = profile->max_int,
+        .latency = profile->latency,
+        .timeout = profile->timeout,
+    };
+
+    memcpy(params.bda, bda, sizeof(esp_bd_addr_t));
+    esp_err_t ret = esp_ble_gap_update_conn_params(&params);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "conn_id=%d connection parameter request failed: %d", conn_id, ret);
+    }
+    if (profile->data_len) {
+        ret = esp_ble_gap_set_pkt_data_len(bda, profile->data_len);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "conn_id=%d data length request failed: %d", conn_id, ret);
+        }
+    }
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    if (profile->phy_2m) {
+        ret = esp_ble_gap_set_preferred_phy(bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                            ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "conn_id=%d 2M PHY request failed: %d", conn_id, ret);
+        }
+    }
+#endif
+    ESP_LOGI(TAG, "conn_id=%d requested the %s profile", conn_id, profile->name);
+}
+
+static void flush_timer_cb(TimerHandle_t timer)
+{
+    bool retry = false;
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        queue_send(&phone_conns[i], true);
+        // Congested phones resume from ESP_GATTS_CONGEST_EVT instead
+        retry |= phone_conns[i].count > 0 && !phone_conns[i].congested;
+    }
+    rate_update();
+    xSemaphoreGive(queue_lock);
+
+    if (retry) {
+        xTimerChangePeriod(flush_timer, pdMS_TO_TICKS(PHONE_FLUSH_MS), 0);
+    }
+}
+
+// Advertise (again) so more phones can connect
+static void start_advertising(void)
+{
+    esp_ble_gap_start_advertising(&(esp_ble_adv_params_t){
+        .adv_int_min = 0x20,
+        .adv_int_max = 0x40,
+        .adv_type = ADV_TYPE_IND,
+        .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+        .channel_map = ADV_CHNL_ALL,
+        .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+    });
+}
+
 // GAP event handler
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
     switch (event) {
     case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
-        esp_ble_gap_start_advertising(&(esp_ble_adv_params_t){
-            .adv_int_min = 0x20,
-            .adv_int_max = 0x40,
-            .adv_type = ADV_TYPE_IND,
-            .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
-            .channel_map = ADV_CHNL_ALL,
-            .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
-        });
+        start_advertising();
         break;
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        ESP_LOGI(TAG, "Connection parameters: status %d, interval %u.%02u ms, latency %u, timeout %u ms",
+                 param->update_conn_params.status,
+                 param->update_conn_params.conn_int * 125 / 100, param->update_conn_params.conn_int * 125 % 100,
+                 param->update_conn_params.latency, param->update_conn_params.timeout * 10);
+        break;
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+        ESP_LOGI(TAG, "Data length: status %d, tx %u / rx %u bytes", param->pkt_data_length_cmpl.status,
+                 param->pkt_data_length_cmpl.params.tx_len, param->pkt_data_length_cmpl.params.rx_len);
+        break;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+        ESP_LOGI(TAG, "PHY: status %d, tx %s / rx %s", param->phy_update.status,
+                 param->phy_update.tx_phy == ESP_BLE_GAP_PHY_2M ? "2M" : "1M/coded",
+                 param->phy_update.rx_phy == ESP_BLE_GAP_PHY_2M ? "2M" : "1M/coded");
+        break;
+#endif
     case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
         if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
             ESP_LOGE(TAG, "Advertising start failed");
@@ -138,6 +528,12 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
 {
     ESP_LOGD(TAG, "GATTS event: %d, gatts_if: %d", event, gatts_if);
 
+    // Events of other GATT server apps (the mesh proxy / PB-GATT) are not ours
+    if (event == ESP_GATTS_REG_EVT ? param->reg.app_id != PHONE_APP_ID
+                                   : gatts_if != phone_gatts_if) {
+        return;
+    }
+
     switch (event) {
     case ESP_GATTS_REG_EVT:
         ESP_LOGI(TAG, "GATT server registered (app_id=%d, status=%d), creating service",
@@ -169,32 +565,176 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         }
         break;
 
-    case ESP_GATTS_CONNECT_EVT:
-        ESP_LOGI(TAG, "Phone connected!");
-        phone_conn_id = param->connect.conn_id;
-        phone_connected = true;
+    case ESP_GATTS_CONNECT_EVT: {
+        phone_conn_t *conn = NULL;
+        int in_use = 0;
+
+        // Every LE link is reported to every GATT app, including the
+        // provisioner's own links to mesh nodes (central role): no phone
+        if (param->connect.link_role == LINK_ROLE_MASTER) {
+            ESP_LOGD(TAG, "conn_id=%d is a link we initiated, not a phone", param->connect.conn_id);
+            break;
+        }
+
+        for (int i = 0; i < PHONE_MAX_CONN; i++) {
+            if (!phone_conns[i].in_use && !conn) {
+                conn = &phone_conns[i];
+            } else if (phone_conns[i].in_use) {
+                in_use++;
+            }
+        }
+        if (!conn) {
+            ESP_LOGW(TAG, "Phone connected (conn_id=%d), but %d are served already",
+                     param->connect.conn_id, PHONE_MAX_CONN);
+            break;
+        }
+
+        conn->mtu = PHONE_DEFAULT_MTU;
+        conn->ccc = 0;
+        conn->congested = false;
+        conn->mtu_warned = false;
+        xSemaphoreTake(conn_lock, portMAX_DELAY);
+        conn->conn_id = param->connect.conn_id;
+        memcpy(conn->bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+        conn->filter_count = 0;
+        conn->in_use = true;
+        phone_link_profile_t profile = bridge_config.link_profile;
+        xSemaphoreGive(conn_lock);
+        ESP_LOGI(TAG, "Phone connected! (conn_id=%d, %d of %d)", conn->conn_id, in_use + 1, PHONE_MAX_CONN);
+        conn_apply_profile(conn->conn_id, conn->bda, profile);
+
+        // Connecting stopped advertising: let the next phone in
+        if (in_use + 1 < PHONE_MAX_CONN) {
+            start_advertising();
+        }
+        break;
+    }
+
+    case ESP_GATTS_CONGEST_EVT: {
+        // Notifications to this phone pause until the stack has room again,
+        // then the timer task sends what queued up meanwhile
+        phone_conn_t *conn = conn_find(param->congest.conn_id);
+        if (!conn) {
+            break;
+        }
+        conn->congested = param->congest.congested;
+        if (conn->congested) {
+            congestions++;
+        } else {
+            xTimerChangePeriod(flush_timer, 1, 0);
+        }
+        ESP_LOGD(TAG, "conn_id=%d %s", conn->conn_id, conn->congested ? "congested" : "uncongested");
+        break;
+    }
+
+    case ESP_GATTS_CONF_EVT: {
+        // Outcome of a notification the stack accepted earlier. CONGESTED
+        // means it was sent and the channel is now congested, which
+        // ESP_GATTS_CONGEST_EVT reports: not a failure
+        if (param->conf.status == ESP_GATT_OK || param->conf.status == ESP_GATT_CONGESTED) {
+            break;
+        }
+        conf_failed++;
+        ESP_LOGD(TAG, "conn_id=%d notification failed: status 0x%x", param->conf.conn_id, param->conf.status);
         break;
+    }
 
-    case ESP_GATTS_DISCONNECT_EVT:
-        ESP_LOGI(TAG, "Phone disconnected");
-        phone_connected = false;
-        notifications_enabled = false;
-        esp_ble_gap_start_advertising(&(esp_ble_adv_params_t){
-            .adv_int_min = 0x20,
-            .adv_int_max = 0x40,
-            .adv_type = ADV_TYPE_IND,
-            .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
-            .channel_map = ADV_CHNL_ALL,
-            .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
-        });
+    case ESP_GATTS_MTU_EVT: {
+        phone_conn_t *conn = conn_find(param->mtu.conn_id);
+        if (conn) {
+            conn->mtu = param->mtu.mtu;
+            if (samples_per_notify(conn) == 0 && legacy_fits(conn)) {
+                ESP_LOGI(TAG, "conn_id=%d MTU %u: one sample per notification, without the count",
+                         conn->conn_id, conn->mtu);
+            } else {
+                ESP_LOGI(TAG, "conn_id=%d MTU %u: %u samples per notification",
+                         conn->conn_id, conn->mtu, samples_per_notify(conn));
+            }
+        }
+        break;
+    }
+
+    case ESP_GATTS_DISCONNECT_EVT: {
+        phone_conn_t *conn = conn_find(param->disconnect.conn_id);
+        if (!conn) {
+            break;
+        }
+        ESP_LOGI(TAG, "Phone disconnected (conn_id=%d)", conn->conn_id);
+        xSemaphoreTake(conn_lock, portMAX_DELAY);
+        conn->in_use = false;
+        xSemaphoreGive(conn_lock);
+        start_advertising();
+        break;
+    }
+
+    case ESP_GATTS_READ_EVT:
+        // CCC: each phone reads its own
+        if (param->read.handle == phone_bridge_handle_table[3]) {
+            phone_conn_t *conn = conn_find(param->read.conn_id);
+            uint16_t ccc = conn ? conn->ccc : 0;
+            esp_gatt_rsp_t rsp = {0};
+
+            rsp.attr_value.handle = param->read.handle;
+            rsp.attr_value.len = sizeof(ccc);
+            rsp.attr_value.value[0] = ccc & 0xFF;
+            rsp.attr_value.value[1] = ccc >> 8;
+            esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+        } else if (param->read.handle == phone_bridge_handle_table[5]) {
+            // Node filter: each phone reads its own, possibly in parts (read blob)
+            phone_conn_t *conn = conn_find(param->read.conn_id);
+            esp_gatt_status_t status = ESP_GATT_OK;
+            esp_gatt_rsp_t rsp = {0};
+            uint16_t len = 0;
+
+            rsp.attr_value.handle = param->read.handle;
+            if (conn) {
+                xSemaphoreTake(conn_lock, portMAX_DELAY);
+                for (unsigned i = 0; i < conn->filter_count; i++) {
+                    rsp.attr_value.value[len++] = conn->filter[i] & 0xFF;
+                    rsp.attr_value.value[len++] = conn->filter[i] >> 8;
+                }
+                xSemaphoreGive(conn_lock);
+            }
+            if (param->read.offset > len) {
+                status = ESP_GATT_INVALID_OFFSET;
+            } else {
+                rsp.attr_value.offset = param->read.offset;
+                rsp.attr_value.len = len - param->read.offset;
+                memmove(rsp.attr_value.value, rsp.attr_value.value + param->read.offset, rsp.attr_value.len);
+            }
+            esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, status, &rsp);
+        }
         break;
 
     case ESP_GATTS_WRITE_EVT:
         // Check if CCC descriptor was written (enable/disable notifications)
         if (param->write.handle == phone_bridge_handle_table[3]) {
-            uint16_t descr_value = param->write.value[1] << 8 | param->write.value[0];
-            notifications_enabled = (descr_value == 0x0001);
-            ESP_LOGI(TAG, "Notifications %s", notifications_enabled ? "enabled" : "disabled");
+            phone_conn_t *conn = conn_find(param->write.conn_id);
+            esp_gatt_status_t status = ESP_GATT_OK;
+
+            if (param->write.len != sizeof(uint16_t)) {
+                status = ESP_GATT_INVALID_ATTR_LEN;
+            } else if (conn) {
+                conn->ccc = param->write.value[1] << 8 | param->write.value[0];
+                ESP_LOGI(TAG, "conn_id=%d notifications %s", conn->conn_id,
+                         (conn->ccc & CCC_NOTIFY) ? "enabled" : "disabled");
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+            }
+        } else if (param->write.handle == phone_bridge_handle_table[5]) {
+            // Node filter: the whole list in one write (needs an MTU of 35 for 16 addresses)
+            phone_conn_t *conn = conn_find(param->write.conn_id);
+            esp_gatt_status_t status = ESP_GATT_OK;
+
+            if (param->write.is_prep || param->write.offset) {
+                status = ESP_GATT_REQ_NOT_SUPPORTED;
+            } else if (conn) {
+                status = filter_write(conn, param->write.value, param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+            }
         }
         break;
 
@@ -203,15 +743,44 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
     }
 }
 
-esp_err_t phone_bridge_init(void)
+esp_err_t phone_bridge_init(const phone_bridge_config_t *config)
 {
     ESP_LOGI(TAG, "Initializing phone bridge GATT service");
 
     // Note: BLE Mesh already initialized the BLE stack
     // We need to register our GATT service alongside mesh
 
+    if (config) {
+        bridge_config = *config;
+    }
+    if (bridge_config.link_profile > PHONE_PROFILE_LOW_POWER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    queue_cap = bridge_config.queue_samples ? bridge_config.queue_samples : PHONE_QUEUE_DEFAULT;
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        phone_conns[i].queue = calloc(queue_cap, sizeof(sensor_data_packet_t));
+        if (!phone_conns[i].queue) {
+            ESP_LOGE(TAG, "Failed to allocate notification queues");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    queue_lock = xSemaphoreCreateMutex();
+    conn_lock = xSemaphoreCreateMutex();
+    flush_timer = xTimerCreate("phone_flush", pdMS_TO_TICKS(PHONE_FLUSH_MS), pdFALSE, NULL, flush_timer_cb);
+    if (!queue_lock || !conn_lock || !flush_timer) {
+        ESP_LOGE(TAG, "Failed to create notification lock/timer");
+        return ESP_ERR_NO_MEM;
+    }
+    rate_start_us = esp_timer_get_time();
+
+    // Lets the phone negotiate an MTU large enough for several samples
+    esp_err_t ret = esp_ble_gatt_set_local_mtu(PHONE_LOCAL_MTU);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Set local MTU failed: %d", ret);
+    }
+
     // Register GAP callback (mesh may have already registered, this adds another)
-    esp_err_t ret = esp_ble_gap_register_callback(gap_event_handler);
+    ret = esp_ble_gap_register_callback(gap_event_handler);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "GAP register callback failed: %d", ret);
     }
@@ -223,40 +792,139 @@ esp_err_t phone_bridge_init(void)
     }
 
     // Register GATT server app with a unique app ID (mesh uses different IDs)
-    ret = esp_ble_gatts_app_register(0x55);  // Use different app ID from mesh
+    ret = esp_ble_gatts_app_register(PHONE_APP_ID);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "GATTS app register failed: %d", ret);
     }
 
-    ESP_LOGI(TAG, "Phone bridge initialization complete");
+    ESP_LOGI(TAG, "Phone bridge initialization complete (%s profile)", link_profiles[bridge_config.link_profile].name);
     return ESP_OK;
 }
 
-esp_err_t phone_bridge_update_data(const sensor_data_packet_t *data)
+esp_err_t phone_bridge_update_data(const sensor_data_packet_t *data, uint16_t dst)
 {
     if (!data) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (!queue_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     // Update current data
     memcpy(&current_data, data, sizeof(sensor_data_packet_t));
 
-    // Send notification if phone is connected and subscribed
-    if (phone_connected && notifications_enabled && phone_gatts_if != ESP_GATT_IF_NONE) {
-        esp_ble_gatts_send_indicate(
-            phone_gatts_if,
-            phone_conn_id,
-            phone_bridge_handle_table[2],
-            sizeof(sensor_data_packet_t),
-            (uint8_t *)&current_data,
-            false  // notification, not indication
-        );
+    // Phones whose node filter selects this sample
+    bool selected[PHONE_MAX_CONN];
+    xSemaphoreTake(conn_lock, portMAX_DELAY);
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        selected[i] = filter_selects(&phone_conns[i], data->node_addr, dst);
+    }
+    xSemaphoreGive(conn_lock);
+
+    // Queue a notification for every subscribed phone that selected it
+    bool queued = false;
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        phone_conn_t *conn = &phone_conns[i];
+
+        if (!conn_subscribed(conn)) {
+            conn->count = 0;
+            continue;
+        }
+        if (!selected[i]) {
+            stats.filtered++;
+            continue;
+        }
+        if (samples_per_notify(conn) == 0 && !legacy_fits(conn)) {
+            if (!conn->mtu_warned) {
+                ESP_LOGW(TAG, "conn_id=%d MTU %u too small for a sample, the phone must request a larger one",
+                         conn->conn_id, conn->mtu);
+                conn->mtu_warned = true;
+            }
+            stats.mtu_skipped++;
+            continue;
+        }
+        queue_push(conn, data);
+        queue_send(conn, false);
+        queued |= conn->count > 0;
+    }
+
+    // Bounds the wait of the oldest sample still queued
+    if (queued && !xTimerIsTimerActive(flush_timer)) {
+        xTimerChangePeriod(flush_timer, pdMS_TO_TICKS(PHONE_FLUSH_MS), 0);
     }
+    xSemaphoreGive(queue_lock);
 
     return ESP_OK;
 }
 
 bool phone_bridge_is_connected(void)
 {
-    return phone_connected && notifications_enabled;
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        if (conn_subscribed(&phone_conns[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void phone_bridge_get_stats(phone_bridge_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    if (queue_lock) {
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        rate_update();
+        *out = stats;
+        xSemaphoreGive(queue_lock);
+    } else {
+        *out = stats;
+    }
+    out->send_failed += conf_failed;
+    out->congestions = congestions;
+    out->link_profile = bridge_config.link_profile;
+}
+
+esp_err_t phone_bridge_set_profile(phone_link_profile_t profile)
+{
+    if (profile > PHONE_PROFILE_LOW_POWER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!conn_lock) {
+        bridge_config.link_profile = profile;
+        return ESP_OK;
+    }
+
+    // Phones connected by now get it here, later ones on connect
+    uint16_t conn_ids[PHONE_MAX_CONN];
+    esp_bd_addr_t bdas[PHONE_MAX_CONN];
+    int n = 0;
+
+    xSemaphoreTake(conn_lock, portMAX_DELAY);
+    bridge_config.link_profile = profile;
+    for (int i = 0; i < PHONE_MAX_CONN; i++) {
+        if (phone_conns[i].in_use) {
+            conn_ids[n] = phone_conns[i].conn_id;
+            memcpy(bdas[n], phone_conns[i].bda, sizeof(esp_bd_addr_t));
+            n++;
+        }
+    }
+    xSemaphoreGive(conn_lock);
+
+    for (int i = 0; i < n; i++) {
+        conn_apply_profile(conn_ids[i], bdas[i], profile);
+    }
+
+    // Rates from here on belong to the new profile
+    if (queue_lock) {
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        rate_start_us = esp_timer_get_time();
+        rate_notifications = 0;
+        rate_samples = 0;
+        stats.notify_rate = 0;
+        stats.sample_rate = 0;
+        xSemaphoreGive(queue_lock);
+    }
+    return ESP_OK;
 }
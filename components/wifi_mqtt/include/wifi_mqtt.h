@@ -10,12 +10,15 @@
  *
  * FEATURES:
  * =========
- * - Automatic WiFi connection with auto-reconnect
+ * - Automatic WiFi connection with auto-reconnect (exponential backoff + jitter)
  * - MQTT client with QoS support
- * - Subscribe/Publish interface
+ * - Subscribe/Publish interface (blocking or queued with completion tokens)
+ * - Per-topic message handlers with + and # wildcards
+ * - Subscriptions restored automatically after every reconnect
+ * - Several broker connections over the one WiFi station (wifi_mqtt_client_t)
  * - Event callbacks (connected, disconnected, message received)
  * - Thread-safe message publishing
- * - Connection state monitoring
+ * - Connection state monitoring, with a wait-until-ready call
  *
  * TYPICAL USAGE:
  * ==============
@@ -96,7 +99,7 @@ typedef void (*wifi_disconnected_cb_t)(void);
 
 /**
  * Called when MQTT broker connection is established
- * This is the right time to subscribe to topics
+ * Earlier subscriptions have already been sent again at this point
  */
 typedef void (*mqtt_connected_cb_t)(void);
 
@@ -127,10 +130,44 @@ typedef void (*mqtt_disconnected_cb_t)(void);
  */
 typedef void (*mqtt_message_cb_t)(const char *topic, const char *data, int data_len);
 
+/**
+ * Called for a message matching a filter registered with
+ * wifi_mqtt_subscribe_handler()
+ *
+ * @param topic     Topic of the message (NOT null-terminated)
+ * @param topic_len Topic length in bytes
+ * @param data      Payload (NOT null-terminated)
+ * @param data_len  Payload length in bytes
+ * @param ctx       Context given at registration
+ *
+ * Runs in the MQTT task. topic and data point into the MQTT receive buffer
+ * and are only valid during the call.
+ */
+typedef void (*wifi_mqtt_topic_cb_t)(const char *topic, int topic_len,
+                                     const char *data, int data_len, void *ctx);
+
+/**
+ * Called for each fragment of a message matching a filter registered with
+ * wifi_mqtt_subscribe_stream()
+ *
+ * Payloads larger than the MQTT receive buffer (CONFIG_MQTT_BUFFER_SIZE)
+ * arrive in fragments. A stream handler sees them in order as they arrive,
+ * without any reassembly buffer: offset is the position of data in the
+ * payload and total_len the payload size. The message is complete when
+ * offset + data_len == total_len. A message that fits arrives as a single
+ * call with offset 0.
+ *
+ * Runs in the MQTT task; topic and data are only valid during the call.
+ */
+typedef void (*wifi_mqtt_stream_cb_t)(const char *topic, int topic_len,
+                                      const char *data, int data_len,
+                                      int offset, int total_len, void *ctx);
+
 /**
  * Called when a published message is acknowledged by the broker (QoS 1/2 only)
  *
- * @param msg_id Message ID returned from wifi_mqtt_publish()
+ * @param msg_id Message ID returned from wifi_mqtt_publish() or
+ *               wifi_mqtt_publish_async()
  */
 typedef void (*mqtt_published_cb_t)(int msg_id);
 
@@ -142,8 +179,12 @@ typedef struct {
     wifi_disconnected_cb_t wifi_disconnected;   /*!< WiFi disconnected */
     mqtt_connected_cb_t mqtt_connected;         /*!< MQTT connected */
     mqtt_disconnected_cb_t mqtt_disconnected;   /*!< MQTT disconnected */
-    mqtt_message_cb_t message_received;         /*!< MQTT message received */
+    mqtt_message_cb_t message_received;         /*!< MQTT message received (no topic handler matched) */
     mqtt_published_cb_t message_published;      /*!< MQTT publish acknowledged */
+    mqtt_published_cb_t message_dropped;        /*!< Queued QoS 1/2 message expired before it was acknowledged
+                                                     (needs CONFIG_MQTT_REPORT_DELETED_MESSAGES) */
+    mqtt_published_cb_t message_sent;           /*!< QoS 1/2 publish written to the socket by the MQTT task
+                                                     (mqtt:// and mqtts:// only; for latency tracing) */
 } wifi_mqtt_callbacks_t;
 
 /*
@@ -162,7 +203,7 @@ typedef struct {
      */
     const char *wifi_ssid;              /*!< WiFi SSID (network name) */
     const char *wifi_password;          /*!< WiFi password */
-    uint8_t max_wifi_retry;             /*!< Max WiFi connection retries (0 = infinite, default: 5) */
+    uint8_t max_wifi_retry;             /*!< WiFi attempts before an error is logged (retries continue, default: 5) */
 
     /*
      * MQTT Configuration
@@ -181,7 +222,18 @@ typedef struct {
      * =================
      */
     bool auto_reconnect;                /*!< Auto-reconnect on disconnect (default: true) */
-    uint32_t reconnect_timeout_ms;      /*!< Reconnect timeout in ms (default: 10000) */
+    uint32_t reconnect_timeout_ms;      /*!< Maximum reconnect backoff in ms (default: 10000) */
+    uint32_t reconnect_min_ms;          /*!< First reconnect backoff in ms, doubled per attempt (default: 500) */
+    uint32_t rx_reassembly_max;         /*!< Largest fragmented payload reassembled for whole-message consumers (default: 4096) */
+    uint32_t outbox_max_bytes;          /*!< Outbox size cap in bytes, see OUTBOX LIMITS (0 = unbounded) */
+    uint16_t outbox_max_msgs;           /*!< Cap on unacknowledged QoS 1/2 messages (0 = unbounded) */
+
+    /*
+     * TLS (mqtts://)
+     * ==============
+     */
+    const char *mqtt_ca_cert;           /*!< Broker CA certificate, PEM (NULL = CONFIG_MBEDTLS_CERTIFICATE_BUNDLE) */
+    bool tls_session_resumption;        /*!< Resume the TLS session on reconnect, see TLS SESSION RESUMPTION */
 
     /*
      * Callbacks
@@ -190,6 +242,22 @@ typedef struct {
     wifi_mqtt_callbacks_t callbacks;    /*!< Event callbacks (all optional) */
 } wifi_mqtt_config_t;
 
+/*
+ * TLS SESSION RESUMPTION
+ * ======================
+ * A full TLS handshake costs the ESP32 an ECDHE key exchange and a
+ * certificate chain check, most of the time it takes to reconnect to an
+ * mqtts:// broker. With tls_session_resumption the client keeps the TLS
+ * session of its last connection and offers it (session ticket) on the
+ * next connect; a broker that accepts it skips both. A broker without
+ * ticket support simply does a full handshake.
+ *
+ * The session is kept in RAM, per client: the first connect after boot is
+ * always a full handshake. Requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+ * (otherwise a warning is logged and the standard transport is used).
+ * Handshake times are in wifi_mqtt_stats_t.
+ */
+
 /*
  * ============================================================================
  *                          INITIALIZATION & CONTROL
@@ -271,6 +339,57 @@ bool wifi_mqtt_is_wifi_connected(void);
  */
 bool wifi_mqtt_is_mqtt_connected(void);
 
+/*
+ * ============================================================================
+ *                           CONNECTION STATE
+ * ============================================================================
+ *
+ * The state is kept in FreeRTOS event groups, set by the WiFi and MQTT
+ * event handlers:
+ *
+ *   WIFI ──▶ IP ──▶ MQTT ──▶ SUBSCRIBED  =  WIFI_MQTT_STATE_READY
+ *
+ * SUBSCRIBED follows MQTT once the broker acknowledged every subscription
+ * restored on connect (right away if there are none). Subscriptions made
+ * while connected do not affect it. Publishing does not need it:
+ * WIFI_MQTT_STATE_ONLINE is enough, and is set from CONNACK on.
+ *
+ * A producer can block until the connection is usable instead of polling
+ * or spinning through failed publishes:
+ *
+ * ```c
+ * if (wifi_mqtt_wait_ready(100) != ESP_OK) {
+ *     // Offline: keep the reading, count it, or drop it
+ * }
+ * ```
+ *
+ * Do not wait from MQTT callbacks: they run in the task that sets the bits.
+ */
+
+#define WIFI_MQTT_STATE_WIFI        (1u << 0)   /*!< Associated with the AP */
+#define WIFI_MQTT_STATE_IP          (1u << 1)   /*!< Got an IP address */
+#define WIFI_MQTT_STATE_MQTT        (1u << 2)   /*!< Connected to the broker */
+#define WIFI_MQTT_STATE_SUBSCRIBED  (1u << 3)   /*!< Subscriptions restored after connect */
+#define WIFI_MQTT_STATE_READY       (WIFI_MQTT_STATE_WIFI | WIFI_MQTT_STATE_IP | \
+                                     WIFI_MQTT_STATE_MQTT | WIFI_MQTT_STATE_SUBSCRIBED)
+#define WIFI_MQTT_STATE_ONLINE      (WIFI_MQTT_STATE_IP | WIFI_MQTT_STATE_MQTT)  /*!< Enough to publish */
+
+#define WIFI_MQTT_WAIT_FOREVER      UINT32_MAX
+
+/**
+ * Current WIFI_MQTT_STATE_* bits of the default client
+ */
+uint32_t wifi_mqtt_get_state(void);
+
+/**
+ * Wait until the default client is WIFI_MQTT_STATE_READY
+ *
+ * @param timeout_ms 0 = only check, WIFI_MQTT_WAIT_FOREVER = no timeout
+ * @return ESP_OK when ready, ESP_ERR_TIMEOUT, or ESP_ERR_INVALID_STATE
+ *         before wifi_mqtt_init()
+ */
+esp_err_t wifi_mqtt_wait_ready(uint32_t timeout_ms);
+
 /*
  * ============================================================================
  *                         MQTT PUBLISH & SUBSCRIBE
@@ -293,6 +412,7 @@ bool wifi_mqtt_is_mqtt_connected(void);
  * NOTES:
  * - For QoS 0: Message ID is always -1
  * - For QoS 1/2: Message ID can be used to track acknowledgment
+ * - QoS 1/2 are subject to the outbox limits (see OUTBOX LIMITS)
  * - Max message size depends on MQTT broker (typically 256 KB)
  *
  * EXAMPLES:
@@ -325,14 +445,108 @@ int wifi_mqtt_publish(const char *topic, const char *data, int qos);
  */
 int wifi_mqtt_publish_binary(const char *topic, const void *data, int len, int qos);
 
+/**
+ * State of an asynchronous publish
+ */
+typedef enum {
+    WIFI_MQTT_PUB_PENDING = 0,  /*!< Queued, outcome not known yet */
+    WIFI_MQTT_PUB_DONE,         /*!< QoS 0: queued. QoS 1/2: acknowledged by the broker */
+    WIFI_MQTT_PUB_FAILED,       /*!< Expired from the outbox before it was acknowledged
+                                     (MQTT_EVENT_DELETED, see OUTBOX LIMITS) */
+} wifi_mqtt_pub_state_t;
+
+typedef struct wifi_mqtt_pub_token wifi_mqtt_pub_token_t;
+
+/**
+ * Completion token for wifi_mqtt_publish_async()
+ *
+ * Owned by the caller and must stay valid until state leaves PENDING.
+ * done is called once, from the MQTT task (QoS 1/2) or from inside
+ * wifi_mqtt_publish_async() (QoS 0).
+ */
+struct wifi_mqtt_pub_token {
+    volatile wifi_mqtt_pub_state_t state;   /*!< Written by wifi_mqtt */
+    int msg_id;                             /*!< Written by wifi_mqtt */
+    void (*done)(wifi_mqtt_pub_token_t *token); /*!< Optional completion callback */
+    void *arg;                              /*!< Caller context */
+};
+
+/*
+ * OUTBOX LIMITS
+ * =============
+ * QoS 1/2 messages stay in the esp-mqtt outbox until acknowledged, and
+ * wifi_mqtt_publish_async() messages of any QoS until sent. On a slow
+ * link the outbox grows without bound. With outbox_max_bytes and/or
+ * outbox_max_msgs set, messages are refused when they would go over the
+ * limit. Refusing is priority based, least important traffic first:
+ *
+ * - QoS 0 (async only) is refused once the outbox holds 3/4 of
+ *   outbox_max_bytes. The last quarter is kept for QoS 1/2.
+ * - QoS 1/2 is refused at outbox_max_bytes, or once outbox_max_msgs
+ *   messages are waiting for their acknowledgment.
+ *
+ * esp-mqtt cannot remove queued messages, so the limits are enforced
+ * when a message is admitted and never by deleting older ones. Messages
+ * older than OUTBOX_EXPIRED_TIMEOUT_MS (menuconfig) still expire as
+ * before (message_dropped).
+ *
+ * Expiry is reported by esp-mqtt only with CONFIG_MQTT_REPORT_DELETED_MESSAGES=y
+ * (ESP-MQTT Configurations in menuconfig), and wifi_mqtt does not build
+ * without it: an expired message would otherwise keep its place in
+ * outbox_max_msgs and its token slot (WIFI_MQTT_PUB_FAILED) forever.
+ * A refused publish returns -1 and is counted
+ * in wifi_mqtt_stats_t.outbox_dropped_qos0 / outbox_dropped_qos1.
+ */
+
+/**
+ * Queue an MQTT message without waiting for the network
+ *
+ * wifi_mqtt_publish() writes to the socket in the calling task (and for
+ * QoS 1/2 waits for the write to finish). This copies the message into the
+ * esp-mqtt outbox and returns; the MQTT task sends it. Use it from time
+ * critical tasks such as the BLE Mesh callbacks.
+ *
+ * THREAD-SAFE: Can be called from any task (may briefly wait for the
+ * client lock while the MQTT task is busy)
+ *
+ * OUTCOME:
+ * - QoS 0: done as soon as it is queued (there is no acknowledgment)
+ * - QoS 1/2: message_published(msg_id) when the broker acknowledges it,
+ *   message_dropped(msg_id) if it expires from the outbox first. With a
+ *   token, its state and done callback report the same.
+ *
+ * @param topic MQTT topic
+ * @param data  Payload (copied, can be binary)
+ * @param len   Payload length in bytes (never computed with strlen)
+ * @param qos   Quality of Service (0, 1, or 2)
+ * @param token Completion token (NULL if not needed)
+ * @return Message ID (>0 for QoS 1/2, 0 for QoS 0), or -1 if not
+ *         connected, the outbox is full (see OUTBOX LIMITS) or no token
+ *         slot is free. The token is not completed on -1.
+ *
+ * EXAMPLE:
+ * ```c
+ * int n = snprintf(json, sizeof(json), "{\"hr\":%d}", hr);
+ * wifi_mqtt_publish_async("sensor/hr", json, n, 0, NULL);
+ * ```
+ */
+int wifi_mqtt_publish_async(const char *topic, const void *data, int len, int qos,
+                            wifi_mqtt_pub_token_t *token);
+
 /**
  * Subscribe to MQTT topic
  *
  * When a message is received on this topic, the message_received callback fires.
  *
+ * The subscription is remembered: it is sent again (batched with the
+ * others) every time the MQTT connection comes back. While disconnected
+ * it is only recorded and sent on connect.
+ *
  * @param topic MQTT topic pattern (e.g., "sensor/#" for wildcard)
  * @param qos   Quality of Service to request (0, 1, or 2)
- * @return Message ID (>0) on success, -1 on error
+ * @return Message ID (>0) on success, 0 if recorded while disconnected,
+ *         -1 on an invalid filter, out of memory, or if the SUBSCRIBE
+ *         could not be sent (it stays recorded and is retried)
  *
  * TOPIC WILDCARDS:
  * - "#" matches multiple levels (e.g., "sensor/#" matches "sensor/temp", "sensor/room/temp")
@@ -355,11 +569,178 @@ int wifi_mqtt_subscribe(const char *topic, int qos);
 /**
  * Unsubscribe from MQTT topic
  *
+ * Also forgets the subscription for future reconnects. No UNSUBSCRIBE is
+ * sent while a topic handler still uses the same filter.
+ *
  * @param topic MQTT topic to unsubscribe from
- * @return Message ID (>0) on success, -1 on error
+ * @return Message ID (>0) on success, 0 if nothing was sent, -1 on error
  */
 int wifi_mqtt_unsubscribe(const char *topic);
 
+/**
+ * Subscribe to a topic filter with its own handler
+ *
+ * Messages are matched against all registered filters in a topic trie and
+ * every matching handler is called, directly on the received topic (no
+ * copy, no length limit). message_received only gets the messages no
+ * handler matched. Several components can register handlers, including
+ * for the same filter; the filter is subscribed with the highest QoS asked
+ * for.
+ *
+ * Registering the same filter, cb and ctx again only updates the QoS and
+ * resends the SUBSCRIBE. Handlers may (un)register handlers. Like
+ * wifi_mqtt_subscribe(), the filter is resubscribed on every reconnect, so
+ * handlers can be registered once right after wifi_mqtt_init().
+ *
+ * @param filter Topic filter ("+" and "#" wildcards as whole levels)
+ * @param qos    Quality of Service to request (0, 1, or 2)
+ * @param cb     Handler
+ * @param ctx    Passed to the handler
+ * @return Message ID of the SUBSCRIBE (>0), 0 if registered while MQTT is
+ *         not connected (subscribed on connect), -1 on an invalid filter,
+ *         out of memory, or if the SUBSCRIBE could not be sent (the handler
+ *         stays registered and the SUBSCRIBE is retried)
+ *
+ * EXAMPLE:
+ * ```c
+ * static void on_config(const char *topic, int topic_len,
+ *                       const char *data, int data_len, void *ctx)
+ * {
+ *     ESP_LOGI(TAG, "%.*s: %.*s", topic_len, topic, data_len, data);
+ * }
+ *
+ * wifi_mqtt_subscribe_handler("gateway/+/config", 1, on_config, NULL);
+ * ```
+ */
+int wifi_mqtt_subscribe_handler(const char *filter, int qos, wifi_mqtt_topic_cb_t cb, void *ctx);
+
+/**
+ * Remove a handler registered with wifi_mqtt_subscribe_handler()
+ *
+ * The filter is unsubscribed when its last handler is removed.
+ *
+ * @return Message ID of the UNSUBSCRIBE (>0), 0 if no UNSUBSCRIBE was
+ *         sent, -1 if the handler is not registered
+ */
+int wifi_mqtt_unsubscribe_handler(const char *filter, wifi_mqtt_topic_cb_t cb, void *ctx);
+
+/**
+ * Subscribe to a topic filter with a fragment stream handler
+ *
+ * Like wifi_mqtt_subscribe_handler(), but the handler gets payloads as
+ * they arrive, fragment by fragment (see wifi_mqtt_stream_cb_t). Use it
+ * for payloads too large to hold in RAM, such as configuration blobs or
+ * firmware chunks.
+ *
+ * FRAGMENTED MESSAGES:
+ * Whole-message handlers and message_received get fragmented payloads
+ * reassembled in one buffer, reused between messages, of at most
+ * rx_reassembly_max bytes. Larger payloads are dropped for them (counted
+ * in wifi_mqtt_stats_t.rx_dropped); stream handlers still see them.
+ *
+ * @return Same as wifi_mqtt_subscribe_handler()
+ */
+int wifi_mqtt_subscribe_stream(const char *filter, int qos, wifi_mqtt_stream_cb_t cb, void *ctx);
+
+/**
+ * Remove a handler registered with wifi_mqtt_subscribe_stream()
+ *
+ * @return Same as wifi_mqtt_unsubscribe_handler()
+ */
+int wifi_mqtt_unsubscribe_stream(const char *filter, wifi_mqtt_stream_cb_t cb, void *ctx);
+
+/*
+ * ============================================================================
+ *                          MULTIPLE CONNECTIONS
+ * ============================================================================
+ *
+ * wifi_mqtt_init() sets up WiFi and one MQTT connection, the default
+ * client, which all functions above use. More clients can be added on the
+ * same WiFi station, each with its own esp-mqtt task, outbox, subscriptions,
+ * handlers and reconnect backoff. Traffic on one connection then never
+ * waits behind another, e.g. commands behind a large telemetry batch.
+ *
+ * ```c
+ * wifi_mqtt_client_config_t ctl_config = {
+ *     .name = "ctl",
+ *     .mqtt_broker_uri = "mqtt://broker.example.com",
+ * };
+ * wifi_mqtt_client_t *ctl;
+ * ESP_ERROR_CHECK(wifi_mqtt_client_create(&ctl_config, &ctl));
+ * wifi_mqtt_client_subscribe_handler(ctl, "gateway/cmd", 1, on_command, NULL);
+ * ```
+ *
+ * Clients start and stop with wifi_mqtt_start() / wifi_mqtt_stop() and
+ * live until reboot. Each costs an esp-mqtt task and its buffers.
+ */
+
+typedef struct wifi_mqtt_client wifi_mqtt_client_t;
+
+/**
+ * Configuration of an additional MQTT connection
+ *
+ * Reconnect backoff settings are shared and come from wifi_mqtt_config_t.
+ */
+typedef struct {
+    const char *name;                   /*!< Short name for logs and the generated client ID (required) */
+    const char *mqtt_broker_uri;        /*!< MQTT broker URI */
+    const char *mqtt_username;          /*!< MQTT username (NULL if no auth) */
+    const char *mqtt_password;          /*!< MQTT password (NULL if no auth) */
+    const char *mqtt_client_id;         /*!< MQTT client ID (NULL: "<name>_<random>"; must differ between clients) */
+    uint16_t mqtt_port;                 /*!< MQTT broker port (0 = from the URI scheme) */
+    uint16_t mqtt_keepalive;            /*!< MQTT keepalive interval in seconds (default: 120) */
+    uint32_t rx_reassembly_max;         /*!< See wifi_mqtt_config_t (default: 4096) */
+    uint32_t outbox_max_bytes;          /*!< See wifi_mqtt_config_t (0 = unbounded) */
+    uint16_t outbox_max_msgs;           /*!< See wifi_mqtt_config_t (0 = unbounded) */
+    const char *mqtt_ca_cert;           /*!< See wifi_mqtt_config_t */
+    bool tls_session_resumption;        /*!< See wifi_mqtt_config_t */
+    wifi_mqtt_callbacks_t callbacks;    /*!< MQTT callbacks of this connection (wifi_* are ignored) */
+} wifi_mqtt_client_config_t;
+
+/**
+ * Add an MQTT connection
+ *
+ * Call after wifi_mqtt_init(). If wifi_mqtt_start() was already called and
+ * WiFi is up, the client connects right away.
+ *
+ * @param config Configuration (strings must stay valid)
+ * @param out    New client
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE before
+ *         wifi_mqtt_init(), ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t wifi_mqtt_client_create(const wifi_mqtt_client_config_t *config, wifi_mqtt_client_t **out);
+
+/**
+ * The connection configured by wifi_mqtt_init() (NULL before)
+ */
+wifi_mqtt_client_t *wifi_mqtt_default_client(void);
+
+/*
+ * Per-client versions of the functions above. They behave the same on the
+ * given client and return -1 (or false / 0 / ESP_ERR_INVALID_ARG) for a
+ * NULL client.
+ * wifi_mqtt_client_publish() takes a length; 0 means strlen(data).
+ */
+bool wifi_mqtt_client_is_connected(wifi_mqtt_client_t *client);
+uint32_t wifi_mqtt_client_get_state(wifi_mqtt_client_t *client);
+esp_err_t wifi_mqtt_client_wait_ready(wifi_mqtt_client_t *client, uint32_t timeout_ms);
+int wifi_mqtt_client_publish(wifi_mqtt_client_t *client, const char *topic,
+                             const void *data, int len, int qos);
+int wifi_mqtt_client_publish_async(wifi_mqtt_client_t *client, const char *topic,
+                                   const void *data, int len, int qos,
+                                   wifi_mqtt_pub_token_t *token);
+int wifi_mqtt_client_subscribe(wifi_mqtt_client_t *client, const char *topic, int qos);
+int wifi_mqtt_client_unsubscribe(wifi_mqtt_client_t *client, const char *topic);
+int wifi_mqtt_client_subscribe_handler(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                       wifi_mqtt_topic_cb_t cb, void *ctx);
+int wifi_mqtt_client_unsubscribe_handler(wifi_mqtt_client_t *client, const char *filter,
+                                         wifi_mqtt_topic_cb_t cb, void *ctx);
+int wifi_mqtt_client_subscribe_stream(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                      wifi_mqtt_stream_cb_t cb, void *ctx);
+int wifi_mqtt_client_unsubscribe_stream(wifi_mqtt_client_t *client, const char *filter,
+                                        wifi_mqtt_stream_cb_t cb, void *ctx);
+int wifi_mqtt_client_get_outbox_size(wifi_mqtt_client_t *client);
+
 /*
  * ============================================================================
  *                            UTILITY FUNCTIONS
@@ -397,6 +778,65 @@ esp_err_t wifi_mqtt_get_ip_address(char *ip_str, size_t len);
  */
 int8_t wifi_mqtt_get_rssi(void);
 
+/**
+ * Get MQTT outbox size
+ *
+ * The outbox holds QoS 1/2 messages waiting for acknowledgment (and any
+ * message not yet written to the socket).
+ *
+ * @return Outbox size in bytes (0 if the client is not initialized)
+ */
+int wifi_mqtt_get_outbox_size(void);
+
+/**
+ * Reconnect statistics of one link (WiFi or MQTT)
+ *
+ * An outage lasts from the first disconnect until the link is up again,
+ * however many attempts it takes.
+ */
+typedef struct {
+    uint32_t disconnects;       /*!< Outages since init */
+    uint32_t attempts;          /*!< Reconnect attempts made by the backoff scheduler */
+    uint32_t last_outage_ms;    /*!< Duration of the last completed outage */
+    uint32_t max_outage_ms;     /*!< Longest completed outage */
+    bool down;                  /*!< Currently down */
+    uint32_t down_for_ms;       /*!< Duration of the current outage (0 if up) */
+} wifi_mqtt_link_stats_t;
+
+typedef struct {
+    wifi_mqtt_link_stats_t wifi;
+    wifi_mqtt_link_stats_t mqtt;
+    uint32_t rx_reassembled;    /*!< Fragmented messages delivered whole */
+    uint32_t rx_dropped;        /*!< Fragmented messages dropped (too large, incomplete, no memory) */
+    uint32_t outbox_bytes;      /*!< Current outbox size */
+    uint32_t outbox_msgs;       /*!< QoS 1/2 messages waiting for their acknowledgment */
+    uint32_t outbox_dropped_qos0;   /*!< QoS 0 publishes refused by the outbox limits */
+    uint32_t outbox_dropped_qos1;   /*!< QoS 1/2 publishes refused by the outbox limits */
+    uint32_t tls_handshakes;        /*!< mqtts:// connects (tls_session_resumption only) */
+    uint32_t tls_resume_attempts;   /*!< ... of which offered the previous session */
+    uint32_t tls_full_handshake_ms;     /*!< TCP + TLS time of the last connect without a session */
+    uint32_t tls_resume_handshake_ms;   /*!< ... and of the last one with a session offered */
+} wifi_mqtt_stats_t;
+
+/**
+ * Get reconnect and receive statistics (of the default client)
+ *
+ * RECONNECT POLICY:
+ * After a disconnect (or failed attempt) the next attempt waits a random
+ * time between d/2 and d, d = min(reconnect_timeout_ms, reconnect_min_ms *
+ * 2^attempt). Attempts never stop. MQTT attempts pause while WiFi is down
+ * and resume immediately when WiFi gets an IP.
+ *
+ * @param stats Output
+ */
+void wifi_mqtt_get_stats(wifi_mqtt_stats_t *stats);
+
+/**
+ * Statistics of one client: the shared WiFi link, its own MQTT link and
+ * receive counters
+ */
+void wifi_mqtt_client_get_stats(wifi_mqtt_client_t *client, wifi_mqtt_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
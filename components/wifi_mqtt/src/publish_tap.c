@@ -0,0 +1,123 @@
+/**
+ * ===========================================================================
+ *                    WiFi-MQTT COMPONENT - PUBLISH WRITE TAP
+ * ===========================================================================
+ */
+
+#include "publish_tap.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MQTT_TYPE_PUBLISH   3
+
+typedef struct {
+    esp_transport_handle_t inner;
+    publish_tap_cb_t cb;
+    void *ctx;
+} publish_tap_t;
+
+/**
+ * Packet identifier of a QoS 1/2 PUBLISH at the start of buf, 0 for any
+ * other packet (or a buffer too short to tell)
+ */
+static int publish_msg_id(const uint8_t *buf, int len)
+{
+    if (len < 2 || (buf[0] >> 4) != MQTT_TYPE_PUBLISH || ((buf[0] >> 1) & 0x3) == 0) {
+        return 0;
+    }
+
+    // Remaining length: 1 to 4 bytes, 7 bits each
+    int pos = 1;
+    while (pos < len && pos < 5 && (buf[pos] & 0x80)) {
+        pos++;
+    }
+    pos++;
+
+    // Topic name, then the packet identifier
+    if (pos + 2 > len) {
+        return 0;
+    }
+    pos += 2 + (buf[pos] << 8 | buf[pos + 1]);
+    if (pos + 2 > len) {
+        return 0;
+    }
+    return buf[pos] << 8 | buf[pos + 1];
+}
+
+static int tap_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+    return esp_transport_connect(tap->inner, host, port, timeout_ms);
+}
+
+static int tap_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+    return esp_transport_read(tap->inner, buffer, len, timeout_ms);
+}
+
+static int tap_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+
+    int ret = esp_transport_write(tap->inner, buffer, len, timeout_ms);
+    if (ret > 0) {
+        int msg_id = publish_msg_id((const uint8_t *)buffer, ret);
+        if (msg_id) {
+            tap->cb(msg_id, tap->ctx);
+        }
+    }
+    return ret;
+}
+
+static int tap_close(esp_transport_handle_t t)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+    return esp_transport_close(tap->inner);
+}
+
+static int tap_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+    return esp_transport_poll_read(tap->inner, timeout_ms);
+}
+
+static int tap_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+    return esp_transport_poll_write(tap->inner, timeout_ms);
+}
+
+static int tap_destroy(esp_transport_handle_t t)
+{
+    publish_tap_t *tap = esp_transport_get_context_data(t);
+
+    esp_transport_destroy(tap->inner);
+    free(tap);
+    return 0;
+}
+
+esp_transport_handle_t publish_tap_transport_new(esp_transport_handle_t inner, int default_port,
+                                                 publish_tap_cb_t cb, void *ctx)
+{
+    if (!inner) {
+        return NULL;
+    }
+
+    publish_tap_t *tap = calloc(1, sizeof(*tap));
+    esp_transport_handle_t t = tap ? esp_transport_init() : NULL;
+    if (!t) {
+        free(tap);
+        esp_transport_destroy(inner);
+        return NULL;
+    }
+
+    tap->inner = inner;
+    tap->cb = cb;
+    tap->ctx = ctx;
+    esp_transport_set_context_data(t, tap);
+    esp_transport_set_func(t, tap_connect, tap_read, tap_write, tap_close,
+                           tap_poll_read, tap_poll_write, tap_destroy);
+    esp_transport_set_default_port(t, default_port);
+    return t;
+}
@@ -0,0 +1,39 @@
+/**
+ * ===========================================================================
+ *                 WiFi-MQTT COMPONENT - PUBLISH WRITE TAP (PRIVATE)
+ * ===========================================================================
+ *
+ * An esp_transport that wraps the real one (TCP, SSL or tls_resume) and
+ * reports the msg_id of every QoS 1/2 PUBLISH the MQTT task writes to it.
+ * esp-mqtt has no event for that moment: wifi_mqtt_publish_async() only
+ * enqueues, and MQTT_EVENT_PUBLISHED comes with the PUBACK. With the write
+ * time in between, the wait in the outbox and the broker round trip can
+ * be told apart.
+ *
+ * esp-mqtt writes each packet with one esp_transport_write() call, so the
+ * fixed header, topic and packet identifier are at the start of the
+ * buffer. Retransmissions (DUP) are reported again.
+ */
+
+#ifndef PUBLISH_TAP_H
+#define PUBLISH_TAP_H
+
+#include "esp_transport.h"
+
+/**
+ * A QoS 1/2 PUBLISH was written (MQTT task)
+ */
+typedef void (*publish_tap_cb_t)(int msg_id, void *ctx);
+
+/**
+ * New transport around inner, for esp_mqtt_client_config_t.network.transport
+ * (esp-mqtt destroys it with the client, and it destroys inner)
+ *
+ * @param inner        Transport that does the I/O; destroyed on failure too
+ * @param default_port Port when the URI has none (1883, 8883)
+ * @return Transport, NULL when out of memory
+ */
+esp_transport_handle_t publish_tap_transport_new(esp_transport_handle_t inner, int default_port,
+                                                 publish_tap_cb_t cb, void *ctx);
+
+#endif // PUBLISH_TAP_H
@@ -0,0 +1,231 @@
+/**
+ * ===========================================================================
+ *                WiFi-MQTT COMPONENT - TLS SESSION RESUMPTION
+ * ===========================================================================
+ */
+
+#include "tls_resume.h"
+#include <stdlib.h>
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+#include "esp_tls.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <string.h>
+#include <sys/select.h>
+
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+
+#define TAG "TLS_RESUME"
+
+#define TLS_DEFAULT_PORT    8883
+
+typedef struct {
+    esp_tls_t *tls;                         // NULL = closed
+    esp_tls_client_session_t *session;      // From the last connection, NULL = none
+    const char *ca_cert;
+    tls_resume_stats_t *stats;
+} tls_resume_t;
+
+/** Wait until the socket is readable / writable: 1, 0 on timeout, -1 on error */
+static int tls_poll(tls_resume_t *ctx, int timeout_ms, bool write)
+{
+    int fd = -1;
+    if (!ctx->tls || esp_tls_get_conn_sockfd(ctx->tls, &fd) != ESP_OK || fd < 0) {
+        return -1;
+    }
+
+    fd_set fds, errfds;
+    FD_ZERO(&fds);
+    FD_ZERO(&errfds);
+    FD_SET(fd, &fds);
+    FD_SET(fd, &errfds);
+
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(fd + 1, write ? NULL : &fds, write ? &fds : NULL, &errfds,
+                     timeout_ms < 0 ? NULL : &tv);
+    if (ret > 0 && FD_ISSET(fd, &errfds)) {
+        return -1;
+    }
+    return ret;
+}
+
+static void session_drop(tls_resume_t *ctx)
+{
+    if (ctx->session) {
+        esp_tls_free_client_session(ctx->session);
+        ctx->session = NULL;
+    }
+}
+
+/** Keep the session of the open connection for the next connect */
+static void session_save(tls_resume_t *ctx)
+{
+    esp_tls_client_session_t *session = esp_tls_get_client_session(ctx->tls);
+    if (session) {
+        session_drop(ctx);
+        ctx->session = session;
+    }
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    if (ctx->tls) {
+        // TLS 1.3 sends its tickets after the handshake: fetch it last
+        session_save(ctx);
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+    }
+    return 0;
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    tls_close(t);
+    bool resume = ctx->session != NULL;
+    ctx->tls = esp_tls_init();
+    if (!ctx->tls) {
+        return -1;
+    }
+
+    esp_tls_cfg_t cfg = {
+        .timeout_ms = timeout_ms,
+        .client_session = ctx->session,
+    };
+    if (ctx->ca_cert) {
+        cfg.cacert_buf = (const unsigned char *)ctx->ca_cert;
+        cfg.cacert_bytes = strlen(ctx->ca_cert) + 1;
+    } else {
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        cfg.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (esp_tls_conn_new_sync(host, strlen(host), port, &cfg, ctx->tls) <= 0) {
+        ESP_LOGW(TAG, "Handshake with %s:%d failed%s", host, port,
+                 resume ? ", dropping the cached session" : "");
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+        session_drop(ctx);
+        return -1;
+    }
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    ctx->stats->handshakes++;
+    if (resume) {
+        ctx->stats->resume_attempts++;
+        ctx->stats->resume_ms = ms;
+    } else {
+        ctx->stats->full_ms = ms;
+    }
+    ESP_LOGD(TAG, "Connected to %s:%d in %" PRIu32 " ms (%s)", host, port, ms,
+             resume ? "session offered" : "full handshake");
+
+    // TLS 1.2 tickets are known now; a dropped connection still has one
+    session_save(ctx);
+    return 0;
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    if (!ctx->tls) {
+        return -1;
+    }
+    if (esp_tls_get_bytes_avail(ctx->tls) <= 0) {
+        int poll = tls_poll(ctx, timeout_ms, false);
+        if (poll <= 0) {
+            return poll == 0 ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : -1;
+        }
+    }
+
+    int ret = esp_tls_conn_read(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    if (ret == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    return ret;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    int poll = tls_poll(ctx, timeout_ms, true);
+    if (poll <= 0) {
+        return poll == 0 ? ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT : -1;
+    }
+
+    int ret = esp_tls_conn_write(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_WRITE || ret == ESP_TLS_ERR_SSL_WANT_READ) {
+        return 0;
+    }
+    return ret;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    if (ctx->tls && esp_tls_get_bytes_avail(ctx->tls) > 0) {
+        return 1;
+    }
+    return tls_poll(ctx, timeout_ms, false);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    return tls_poll(esp_transport_get_context_data(t), timeout_ms, true);
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    tls_resume_t *ctx = esp_transport_get_context_data(t);
+
+    tls_close(t);
+    session_drop(ctx);
+    free(ctx);
+    return 0;
+}
+
+esp_transport_handle_t tls_resume_transport_new(const char *ca_cert, tls_resume_stats_t *stats)
+{
+    tls_resume_t *ctx = calloc(1, sizeof(*ctx));
+    esp_transport_handle_t t = ctx ? esp_transport_init() : NULL;
+    if (!t) {
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->ca_cert = ca_cert;
+    ctx->stats = stats;
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close,
+                           tls_poll_read, tls_poll_write, tls_destroy);
+    esp_transport_set_default_port(t, TLS_DEFAULT_PORT);
+    return t;
+}
+
+#else // !CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+esp_transport_handle_t tls_resume_transport_new(const char *ca_cert, tls_resume_stats_t *stats)
+{
+    return NULL;
+}
+
+#endif // CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
@@ -0,0 +1,59 @@
+/**
+ * ===========================================================================
+ *              WiFi-MQTT COMPONENT - TLS SESSION RESUMPTION (PRIVATE)
+ * ===========================================================================
+ *
+ * An esp_transport for mqtts:// that keeps the TLS session of the last
+ * connection and offers it on the next one (session ticket, RFC 5077, or
+ * the TLS 1.3 PSK ticket). A broker that accepts it skips the certificate
+ * exchange and the key exchange: on a reconnect this is one round trip and
+ * no public key operations instead of an ECDHE + signature check, the
+ * bulk of the connect time on an ESP32.
+ *
+ * A broker that rejects the ticket just does a full handshake; a connect
+ * that fails with a ticket offered drops it so the next attempt is clean.
+ *
+ * The session lives in RAM in the transport, one per client. It does not
+ * survive a reboot: esp-tls gives no way to serialize it, and writing the
+ * session master secret to flash would leave it readable to anyone with
+ * the device.
+ *
+ * Needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS. Without it
+ * tls_resume_available() is false and wifi_mqtt.c uses the esp-mqtt SSL
+ * transport.
+ */
+
+#ifndef TLS_RESUME_H
+#define TLS_RESUME_H
+
+#include "esp_transport.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#define tls_resume_available() true
+#else
+#define tls_resume_available() false
+#endif
+
+/** Handshake counters, updated by the transport (MQTT task) */
+typedef struct {
+    uint32_t handshakes;            // Completed
+    uint32_t resume_attempts;       // ... with a cached session offered
+    uint32_t full_ms;               // Last connect without a cached session (TCP + TLS)
+    uint32_t resume_ms;             // Last connect with one
+} tls_resume_stats_t;
+
+/**
+ * New transport, for esp_mqtt_client_config_t.network.transport
+ * (esp-mqtt destroys it with the client)
+ *
+ * @param ca_cert PEM CA certificate, NULL = certificate bundle
+ *                (CONFIG_MBEDTLS_CERTIFICATE_BUNDLE); kept, not copied
+ * @param stats   Counters to update; must outlive the transport
+ * @return Transport, NULL when out of memory or not available
+ */
+esp_transport_handle_t tls_resume_transport_new(const char *ca_cert, tls_resume_stats_t *stats);
+
+#endif // TLS_RESUME_H
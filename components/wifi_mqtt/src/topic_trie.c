@@ -0,0 +1,261 @@
+/**
+ * ===========================================================================
+ *                 WiFi-MQTT COMPONENT - TOPIC TRIE
+ * ===========================================================================
+ */
+
+#include "topic_trie.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct topic_handler {
+    struct topic_handler *next;
+    wifi_mqtt_topic_cb_t cb;        // cb and stream NULL = removed, entry reusable
+    wifi_mqtt_stream_cb_t stream;
+    void *ctx;
+    int qos;
+} topic_handler_t;
+
+struct topic_node {
+    topic_node_t *next;             // Sibling (literal levels)
+    topic_node_t *children;         // Literal child levels
+    topic_node_t *plus;             // "+" child
+    topic_node_t *hash;             // "#" child
+    topic_handler_t *handlers;      // Filters ending here
+    uint16_t len;
+    char level[];
+};
+
+typedef struct {
+    const topic_msg_t *msg;
+    unsigned flags;
+    int called;
+} dispatch_t;
+
+bool topic_filter_valid(const char *filter)
+{
+    if (!filter || !filter[0]) {
+        return false;
+    }
+    for (const char *p = filter; *p; p++) {
+        bool level_start = p == filter || p[-1] == '/';
+        bool level_end = p[1] == '\0' || p[1] == '/';
+
+        if (*p == '+' && !(level_start && level_end)) {
+            return false;
+        }
+        if (*p == '#' && !(level_start && p[1] == '\0')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static topic_node_t *node_new(const char *level, size_t len)
+{
+    topic_node_t *node = calloc(1, sizeof(*node) + len + 1);
+    if (node) {
+        node->len = (uint16_t)len;
+        memcpy(node->level, level, len);
+    }
+    return node;
+}
+
+/** Child for one filter level; created if missing and create is set */
+static topic_node_t *node_child(topic_node_t *node, const char *level, size_t len, bool create)
+{
+    topic_node_t **slot;
+
+    if (len == 1 && level[0] == '+') {
+        slot = &node->plus;
+    } else if (len == 1 && level[0] == '#') {
+        slot = &node->hash;
+    } else {
+        for (slot = &node->children; *slot; slot = &(*slot)->next) {
+            if ((*slot)->len == len && memcmp((*slot)->level, level, len) == 0) {
+                return *slot;
+            }
+        }
+    }
+
+    if (!*slot && create) {
+        *slot = node_new(level, len);
+    }
+    return *slot;
+}
+
+/** Node where a filter ends */
+static topic_node_t *node_find(topic_node_t *root, const char *filter, bool create)
+{
+    topic_node_t *node = root;
+    const char *p = filter;
+
+    while (node) {
+        const char *slash = strchr(p, '/');
+        size_t len = slash ? (size_t)(slash - p) : strlen(p);
+
+        node = node_child(node, p, len, create);
+        if (!slash) {
+            break;
+        }
+        p = slash + 1;
+    }
+    return node;
+}
+
+/** Highest QoS of the live handlers, -1 if none */
+static int node_qos(const topic_node_t *node)
+{
+    int qos = -1;
+    for (const topic_handler_t *h = node->handlers; h; h = h->next) {
+        if ((h->cb || h->stream) && h->qos > qos) {
+            qos = h->qos;
+        }
+    }
+    return qos;
+}
+
+esp_err_t topic_trie_add(topic_node_t **root, const char *filter, int qos,
+                         wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream,
+                         void *ctx, int *sub_qos)
+{
+    if (!cb == !stream || !topic_filter_valid(filter)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!*root) {
+        *root = node_new("", 0);
+        if (!*root) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    topic_node_t *node = node_find(*root, filter, true);
+    if (!node) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    topic_handler_t *free_entry = NULL;
+    for (topic_handler_t *h = node->handlers; h; h = h->next) {
+        if (h->cb == cb && h->stream == stream && h->ctx == ctx) {
+            h->qos = qos;
+            *sub_qos = node_qos(node);
+            return ESP_OK;
+        }
+        if (!h->cb && !h->stream && !free_entry) {
+            free_entry = h;
+        }
+    }
+
+    if (!free_entry) {
+        free_entry = calloc(1, sizeof(*free_entry));
+        if (!free_entry) {
+            return ESP_ERR_NO_MEM;
+        }
+        free_entry->next = node->handlers;
+        node->handlers = free_entry;    // Published last: dispatch may be walking the list
+    }
+    free_entry->ctx = ctx;
+    free_entry->qos = qos;
+    free_entry->stream = stream;
+    free_entry->cb = cb;
+    *sub_qos = node_qos(node);
+    return ESP_OK;
+}
+
+esp_err_t topic_trie_remove(topic_node_t *root, const char *filter,
+                            wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream,
+                            void *ctx, int *sub_qos)
+{
+    topic_node_t *node = root && filter ? node_find(root, filter, false) : NULL;
+    if (!node) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (topic_handler_t *h = node->handlers; h; h = h->next) {
+        if ((cb || stream) && h->cb == cb && h->stream == stream && h->ctx == ctx) {
+            h->cb = NULL;
+            h->stream = NULL;
+            *sub_qos = node_qos(node);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/*
+ * ===========================================================================
+ *                                MATCHING
+ * ===========================================================================
+ */
+
+static void node_call(const topic_node_t *node, dispatch_t *d)
+{
+    const topic_msg_t *m = d->msg;
+    bool probe = d->flags & TOPIC_DISPATCH_PROBE;
+
+    for (const topic_handler_t *h = node->handlers; h; h = h->next) {
+        // Read once: a handler may remove itself or others meanwhile
+        wifi_mqtt_topic_cb_t cb = d->flags & TOPIC_DISPATCH_WHOLE ? h->cb : NULL;
+        wifi_mqtt_stream_cb_t stream = d->flags & TOPIC_DISPATCH_STREAM ? h->stream : NULL;
+
+        if (cb && !probe) {
+            cb(m->topic, m->topic_len, m->data, m->data_len, h->ctx);
+        } else if (stream && !probe) {
+            stream(m->topic, m->topic_len, m->data, m->data_len, m->offset, m->total_len, h->ctx);
+        }
+        d->called += cb || stream;
+    }
+}
+
+static void match_level(const topic_node_t *node, const char *p, const char *end,
+                        bool first_level, dispatch_t *d);
+
+/** node matched the level ending at slash (NULL = last level) */
+static void match_next(const topic_node_t *node, const char *slash, const char *end, dispatch_t *d)
+{
+    if (!slash) {
+        node_call(node, d);
+        if (node->hash) {
+            node_call(node->hash, d);   // "a/#" also matches "a"
+        }
+    } else {
+        match_level(node, slash + 1, end, false, d);
+    }
+}
+
+/** Match the level starting at p against the children of node */
+static void match_level(const topic_node_t *node, const char *p, const char *end,
+                        bool first_level, dispatch_t *d)
+{
+    const char *slash = memchr(p, '/', (size_t)(end - p));
+    size_t len = (size_t)((slash ? slash : end) - p);
+
+    // Wildcards never match a leading "$" level ($SYS/...)
+    bool wild = !(first_level && len > 0 && p[0] == '$');
+
+    if (wild && node->hash) {
+        node_call(node->hash, d);
+    }
+    for (const topic_node_t *child = node->children; child; child = child->next) {
+        if (child->len == len && memcmp(child->level, p, len) == 0) {
+            match_next(child, slash, end, d);
+            break;
+        }
+    }
+    if (wild && node->plus) {
+        match_next(node->plus, slash, end, d);
+    }
+}
+
+int topic_trie_dispatch(const topic_node_t *root, const topic_msg_t *msg, unsigned flags)
+{
+    dispatch_t d = {
+        .msg = msg,
+        .flags = flags,
+    };
+
+    if (root && msg->topic && msg->topic_len > 0) {
+        match_level(root, msg->topic, msg->topic + msg->topic_len, true, &d);
+    }
+    return d.called;
+}
@@ -0,0 +1,84 @@
+/**
+ * ===========================================================================
+ *                 WiFi-MQTT COMPONENT - TOPIC TRIE (PRIVATE)
+ * ===========================================================================
+ *
+ * Subscription filters split into levels, one trie node per level:
+ *
+ *   root ─ "esp32" ─ "gateway" ─ "cmd"     esp32/gateway/cmd
+ *                  └ "+" ─ "config"        esp32/+/config
+ *                  └ "#"                   esp32/#
+ *
+ * Matching walks the topic in place (pointer + length, no copy) and follows
+ * the literal child, the "+" child and the "#" child of each node.
+ *
+ * A handler takes either whole messages (cb) or the fragments of a message
+ * as they arrive (stream).
+ *
+ * Nodes and handler entries are never freed: a removed handler only clears
+ * its callback and the entry is reused. The set of downlink filters of a
+ * gateway is small and fixed, and this lets a handler (un)register handlers
+ * while it is being dispatched. Callers serialize access (wifi_mqtt.c).
+ */
+
+#ifndef TOPIC_TRIE_H
+#define TOPIC_TRIE_H
+
+#include "wifi_mqtt.h"
+#include <stdbool.h>
+
+typedef struct topic_node topic_node_t;
+
+/** A message or, for stream handlers, one fragment of it */
+typedef struct {
+    const char *topic;
+    int topic_len;
+    const char *data;
+    int data_len;
+    int offset;                 // Position of data in the whole payload
+    int total_len;              // Whole payload length
+} topic_msg_t;
+
+// topic_trie_dispatch() flags
+#define TOPIC_DISPATCH_WHOLE    0x1     // Call whole-message handlers
+#define TOPIC_DISPATCH_STREAM   0x2     // Call stream handlers
+#define TOPIC_DISPATCH_PROBE    0x4     // Only count, call nothing
+
+/**
+ * Is this a valid MQTT subscription filter?
+ * ("+" and "#" only as whole levels, "#" only last)
+ */
+bool topic_filter_valid(const char *filter);
+
+/**
+ * Add a handler for a filter (idempotent for the same handler + ctx)
+ *
+ * @param root    Trie root (allocated on first use)
+ * @param cb      Whole-message handler, or NULL
+ * @param stream  Stream handler, or NULL (exactly one is set)
+ * @param sub_qos Highest QoS of the filter's handlers, to subscribe with
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t topic_trie_add(topic_node_t **root, const char *filter, int qos,
+                         wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream,
+                         void *ctx, int *sub_qos);
+
+/**
+ * Remove a handler
+ *
+ * @param sub_qos Highest QoS of the remaining handlers, -1 if none
+ * @return ESP_OK or ESP_ERR_NOT_FOUND
+ */
+esp_err_t topic_trie_remove(topic_node_t *root, const char *filter,
+                            wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream,
+                            void *ctx, int *sub_qos);
+
+/**
+ * Call the handlers whose filter matches msg->topic
+ *
+ * @param flags TOPIC_DISPATCH_* (which handlers, or only count them)
+ * @return Number of matching handlers of the selected kinds
+ */
+int topic_trie_dispatch(const topic_node_t *root, const topic_msg_t *msg, unsigned flags);
+
+#endif // TOPIC_TRIE_H
@@ -2,34 +2,837 @@
  * ============================================================================
  *                   WiFi-MQTT COMPONENT - IMPLEMENTATION
  * ============================================================================
+ *
+ * On the ESP-IDF Linux target (CONFIG_IDF_TARGET_LINUX) the host network is
+ * used as is: WiFi is skipped, "WiFi connected" is reported at start and
+ * only the MQTT clients run. This is what tools/mqtt_bench builds.
+ *
+ * WiFi is global; everything about a broker connection lives in a
+ * wifi_mqtt_client_t. The wifi_mqtt_* functions without a client argument
+ * use the default client created by wifi_mqtt_init().
  */
 
 #include "wifi_mqtt.h"
+#include "topic_trie.h"
+#include "tls_resume.h"
+#include "publish_tap.h"
 #include "esp_log.h"
-#include "esp_wifi.h"
 #include "esp_event.h"
-#include "esp_netif.h"
-#include "nvs_flash.h"
+#include "esp_transport_ssl.h"
+#include "esp_transport_tcp.h"
 #include "mqtt_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "sdkconfig.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "nvs_flash.h"
+#define WIFI_MQTT_HAS_WIFI 1
+#else
+#define WIFI_MQTT_HAS_WIFI 0
+#define esp_random() ((uint32_t)random())
+#endif
+
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+
+// Expired QoS 1/2 messages must release their outbox count and token
+// (MQTT_EVENT_DELETED), or the outbox limit and token slots fill up for good
+#if !CONFIG_MQTT_REPORT_DELETED_MESSAGES
+#error "wifi_mqtt needs CONFIG_MQTT_REPORT_DELETED_MESSAGES=y (menuconfig: ESP-MQTT Configurations)"
+#endif
+
 #define TAG "WIFI_MQTT"
 
+#define DEFAULT_RECONNECT_MIN_MS    500
+#define DEFAULT_RECONNECT_MAX_MS    10000
+
+#define PUB_TOKEN_SLOTS             16      // Pending QoS 1/2 async publishes with a token, per client
+#define PUB_EARLY_ACKS              4
+
+#define RESUB_BATCH_TOPICS          16      // Filters per SUBSCRIBE packet on reconnect
+#define RESUB_BATCH_BYTES           768     // Filter bytes per packet (esp-mqtt buffer is 1024)
+#define RESUB_RETRY_MS              1000    // After a resubscribe that could not be enqueued
+
+#define DEFAULT_RX_REASSEMBLY_MAX   4096
+
+#define OUTBOX_MSG_OVERHEAD         5       // Fixed header, remaining length, topic length
+
+#define STATE_NET_BITS              (WIFI_MQTT_STATE_WIFI | WIFI_MQTT_STATE_IP)
+#define STATE_CLIENT_BITS           (WIFI_MQTT_STATE_MQTT | WIFI_MQTT_STATE_SUBSCRIBED)
+
+#define DEFAULT_CLIENT_NAME         "MQTT"
+
+#define MQTT_DEFAULT_PORT           1883
+#define MQTTS_DEFAULT_PORT          8883
+
 /*
  * ============================================================================
  *                           INTERNAL STATE
  * ============================================================================
  */
 
+/** One link with its own reconnect backoff (see RECONNECT SCHEDULER) */
+typedef struct {
+    const char *name;
+    void (*connect)(void *ctx);
+    void *ctx;
+    TimerHandle_t timer;
+    uint32_t attempt;               // Failed attempts in the current outage
+    bool down;
+    TickType_t down_since;
+    wifi_mqtt_link_stats_t stats;
+} reconnect_link_t;
+
+/** See SUBSCRIPTION REGISTRY */
+typedef struct subscription {
+    struct subscription *next;
+    int8_t qos_plain;               // wifi_mqtt_subscribe(), -1 = not subscribed
+    int8_t qos_handlers;            // Highest topic handler QoS, -1 = none
+    char filter[];
+} subscription_t;
+
+/** See ASYNC PUBLISH TOKENS */
+typedef struct {
+    wifi_mqtt_pub_token_t *token;   // NULL = free
+    int msg_id;                     // 0 until bound
+} pub_token_slot_t;
+
+typedef struct {
+    int msg_id;
+    bool ok;
+} pub_early_ack_t;
+
+/** See RECEIVE & REASSEMBLY */
+typedef struct {
+    int received;                   // Bytes so far, -1 = no message in progress
+    int total_len;
+    int msg_id;
+    bool buffering;                 // Whole-message consumers get it at the end
+    bool fallback;                  // No handler matched: message_received gets it
+    char *topic;                    // Fragments after the first carry no topic
+    int topic_len;
+    int topic_cap;
+    char *buf;
+    int buf_cap;
+} rx_assembly_t;
+
+struct wifi_mqtt_client {
+    struct wifi_mqtt_client *next;
+    wifi_mqtt_client_config_t config;
+    char client_id[40];             // Generated when config.mqtt_client_id is NULL
+    esp_mqtt_client_handle_t mqtt;
+    EventGroupHandle_t state;       // STATE_CLIENT_BITS (see CONNECTION STATE)
+    atomic_int resub_msg_id;        // Last resubscribe packet awaiting its SUBACK, 0 = none
+    atomic_int last_suback;         // msg_id of the last SUBACK this connection (MQTT task)
+    TimerHandle_t resub_timer;      // Retries a failed resubscribe (timer task)
+    bool started;
+    reconnect_link_t link;
+
+    // Topic handlers (wifi_mqtt_subscribe_handler) and the subscription
+    // registry. Recursive: handlers may register handlers. Never held
+    // across esp-mqtt calls.
+    topic_node_t *topics;
+    subscription_t *subscriptions;
+    SemaphoreHandle_t topic_lock;
+
+    // Async publish tokens
+    SemaphoreHandle_t token_lock;
+    pub_token_slot_t token_slots[PUB_TOKEN_SLOTS];
+    pub_early_ack_t early_acks[PUB_EARLY_ACKS];
+    unsigned early_next;
+    unsigned tokens_binding;        // Reserved slots without a msg_id yet
+
+    // Outbox limits
+    atomic_uint outbox_msgs;        // QoS 1/2 admitted and not acknowledged or expired yet
+    atomic_uint outbox_dropped_qos0;
+    atomic_uint outbox_dropped_qos1;
+
+    // mqtts:// handshakes, with tls_session_resumption
+    tls_resume_stats_t tls;
+
+    // Receive (MQTT task only)
+    rx_assembly_t rx;
+    uint32_t rx_reassembled;
+    uint32_t rx_dropped;
+};
+
 static wifi_mqtt_config_t s_config = {0};
 static wifi_mqtt_callbacks_t s_callbacks = {0};
-static esp_mqtt_client_handle_t s_mqtt_client = NULL;
+#if WIFI_MQTT_HAS_WIFI
 static esp_netif_t *s_netif = NULL;
+#endif
+
+// Clients, default first. Only appended to (fully set up before it is
+// linked in), so the event handlers walk it without a lock.
+static wifi_mqtt_client_t *s_clients = NULL;
+static wifi_mqtt_client_t *s_default = NULL;
+
+// Connection state: STATE_NET_BITS (see CONNECTION STATE)
+static EventGroupHandle_t s_net_state = NULL;
+static bool s_running = false;          // Between wifi_mqtt_start() and wifi_mqtt_stop()
+
+/*
+ * ============================================================================
+ *                           CONNECTION STATE
+ * ============================================================================
+ * WIFI and IP are global (s_net_state, WiFi/IP event handlers), MQTT and
+ * SUBSCRIBED per client (c->state, MQTT task). Readers in other tasks get
+ * a consistent view without locks, and waiters block in the event group
+ * instead of polling.
+ *
+ * The broker handles a connection's packets in order, so SUBSCRIBED is set
+ * by the SUBACK of the last resubscribe packet. A resubscribe, or a new
+ * subscription, that cannot be enqueued clears SUBSCRIBED and is retried
+ * every RESUB_RETRY_MS from the timer task while connected. Publishing
+ * only needs IP and MQTT.
+ */
+
+static bool net_up(void)
+{
+    return s_net_state && (xEventGroupGetBits(s_net_state) & WIFI_MQTT_STATE_IP);
+}
+
+static bool client_connected(wifi_mqtt_client_t *c)
+{
+    return xEventGroupGetBits(c->state) & WIFI_MQTT_STATE_MQTT;
+}
+
+/** Ticks left of a wait that started at start (portMAX_DELAY = no timeout) */
+static TickType_t wait_left(TickType_t start, TickType_t wait)
+{
+    if (wait == portMAX_DELAY) {
+        return wait;
+    }
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    return elapsed < wait ? wait - elapsed : 0;
+}
+
+/*
+ * ============================================================================
+ *                         RECONNECT SCHEDULER
+ * ============================================================================
+ * WiFi and each MQTT client reconnect independently with capped exponential
+ * backoff and "equal jitter": attempt n waits a random time in [d/2, d],
+ * with d = min(reconnect_timeout_ms, reconnect_min_ms * 2^n). Retries never
+ * stop. The jitter keeps a fleet of gateways from hitting a rebooted AP or
+ * broker in lockstep.
+ *
+ * The attempt itself runs in the FreeRTOS timer task.
+ */
+
+static void wifi_connect_attempt(void *ctx);
+
+static reconnect_link_t s_wifi_link = { .name = "WiFi", .connect = wifi_connect_attempt };
+
+static uint32_t backoff_delay_ms(uint32_t attempt)
+{
+    uint32_t base = s_config.reconnect_min_ms;
+    uint32_t cap = s_config.reconnect_timeout_ms;
+    // Saturate before shifting: base << attempt must not wrap below cap
+    uint32_t delay = attempt < 16 && base <= (cap >> attempt) ? base << attempt : cap;
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+static void reconnect_timer_cb(TimerHandle_t timer)
+{
+    reconnect_link_t *link = pvTimerGetTimerID(timer);
+
+    if (!s_running) {
+        return;
+    }
+    link->stats.attempts++;
+    link->connect(link->ctx);
+}
+
+/** The link went (or still is) down: start the outage clock */
+static void link_down(reconnect_link_t *link)
+{
+    if (!link->down) {
+        link->down = true;
+        link->down_since = xTaskGetTickCount();
+        link->stats.disconnects++;
+    }
+}
+
+/** The link is up: close the outage and reset the backoff */
+static void link_up(reconnect_link_t *link)
+{
+    if (link->timer) {
+        xTimerStop(link->timer, 0);
+    }
+    if (link->down) {
+        uint32_t outage_ms = pdTICKS_TO_MS(xTaskGetTickCount() - link->down_since);
+        link->stats.last_outage_ms = outage_ms;
+        if (outage_ms > link->stats.max_outage_ms) {
+            link->stats.max_outage_ms = outage_ms;
+        }
+        ESP_LOGI(TAG, "%s reconnected after %" PRIu32 " ms (%" PRIu32 " attempts)",
+                 link->name, outage_ms, link->attempt);
+    }
+    link->down = false;
+    link->attempt = 0;
+}
+
+/** Schedule the next attempt of a link that is down */
+static void schedule_reconnect(reconnect_link_t *link)
+{
+    if (!s_running || !s_config.auto_reconnect || !link->timer) {
+        return;
+    }
+
+    uint32_t delay_ms = backoff_delay_ms(link->attempt);
+    link->attempt++;
+
+    if (link == &s_wifi_link && link->attempt == s_config.max_wifi_retry) {
+        ESP_LOGE(TAG, "WiFi still down after %" PRIu32 " attempts, retrying at most every %" PRIu32 " ms",
+                 link->attempt, s_config.reconnect_timeout_ms);
+    }
+    ESP_LOGI(TAG, "%s reconnect #%" PRIu32 " in %" PRIu32 " ms", link->name, link->attempt, delay_ms);
+
+    // Also (re)starts the timer
+    xTimerChangePeriod(link->timer, pdMS_TO_TICKS(delay_ms) ? pdMS_TO_TICKS(delay_ms) : 1, 0);
+}
+
+static esp_err_t link_init(reconnect_link_t *link)
+{
+    if (!link->timer) {
+        link->timer = xTimerCreate(link->name, 1, pdFALSE, link, reconnect_timer_cb);
+        if (!link->timer) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static void mqtt_connect_attempt(void *ctx)
+{
+    wifi_mqtt_client_t *c = ctx;
+
+    if (net_up()) {
+        esp_mqtt_client_reconnect(c->mqtt);
+    }
+}
+
+/*
+ * ============================================================================
+ *                         SUBSCRIPTION REGISTRY
+ * ============================================================================
+ * Every filter the application asked for on a client, subscribed or not.
+ * The broker forgets subscriptions with the (clean) session, so all of them
+ * are sent again on each MQTT_EVENT_CONNECTED, batched into few SUBSCRIBE
+ * packets. Subscribing while disconnected only records the filter.
+ *
+ * A filter can come from wifi_mqtt_subscribe() and from topic handlers;
+ * it is subscribed with the higher QoS and unsubscribed once neither wants
+ * it. Like the trie, entries are never freed (an unused entry is reused),
+ * so the list can be walked between lock sections. Guarded by topic_lock.
+ */
+
+static int subscription_qos(const subscription_t *sub)
+{
+    return sub->qos_plain > sub->qos_handlers ? sub->qos_plain : sub->qos_handlers;
+}
+
+/**
+ * Record the QoS one source wants for a filter (-1 = no longer wanted)
+ *
+ * @return QoS to subscribe with (-1 = unsubscribe), or -2 if out of memory
+ */
+static int registry_set(wifi_mqtt_client_t *c, const char *filter, bool handlers, int qos)
+{
+    subscription_t *sub, *unused = NULL;
+    int result;
+
+    xSemaphoreTakeRecursive(c->topic_lock, portMAX_DELAY);
+    for (sub = c->subscriptions; sub; sub = sub->next) {
+        if (strcmp(sub->filter, filter) == 0) {
+            break;
+        }
+    }
+    if (!sub && qos >= 0) {
+        // Reuse an unused entry if the filter fits, else add one
+        size_t len = strlen(filter);
+        for (subscription_t *s = c->subscriptions; s && !unused; s = s->next) {
+            if (subscription_qos(s) < 0 && strlen(s->filter) >= len) {
+                unused = s;
+            }
+        }
+        sub = unused ? unused : calloc(1, sizeof(*sub) + len + 1);
+        if (sub) {
+            sub->qos_plain = -1;
+            sub->qos_handlers = -1;
+            memcpy(sub->filter, filter, len + 1);
+            if (!unused) {
+                sub->next = c->subscriptions;
+                c->subscriptions = sub;
+            }
+        }
+    }
+
+    if (!sub) {
+        result = qos >= 0 ? -2 : -1;
+    } else {
+        if (handlers) {
+            sub->qos_handlers = (int8_t)qos;
+        } else {
+            sub->qos_plain = (int8_t)qos;
+        }
+        result = subscription_qos(sub);
+    }
+    xSemaphoreGiveRecursive(c->topic_lock);
+    return result;
+}
+
+/**
+ * Subscribe every registered filter again (on connect, and on retry)
+ *
+ * @return msg_id of the last SUBSCRIBE packet, 0 if there was nothing to
+ *         subscribe, -1 on failure
+ */
+static int resubscribe_all(wifi_mqtt_client_t *c)
+{
+    esp_mqtt_topic_t batch[RESUB_BATCH_TOPICS];
+    char names[RESUB_BATCH_BYTES];
+    const subscription_t *sub = c->subscriptions;
+    int topics = 0, packets = 0, msg_id = 0;
+
+    while (sub) {
+        int n = 0;
+        size_t used = 0;
+
+        xSemaphoreTakeRecursive(c->topic_lock, portMAX_DELAY);
+        for (; sub && n < RESUB_BATCH_TOPICS; sub = sub->next) {
+            int qos = subscription_qos(sub);
+            size_t len = strlen(sub->filter) + 1;
+
+            if (qos < 0) {
+                continue;
+            }
+            if (used + len > sizeof(names)) {
+                if (n > 0) {
+                    break;          // Goes into the next packet
+                }
+                ESP_LOGE(TAG, "Filter too long to resubscribe: %.32s...", sub->filter);
+                continue;
+            }
+            memcpy(&names[used], sub->filter, len);
+            batch[n].filter = &names[used];
+            batch[n].qos = qos;
+            used += len;
+            n++;
+        }
+        xSemaphoreGiveRecursive(c->topic_lock);
+
+        if (n == 0) {
+            break;
+        }
+        msg_id = esp_mqtt_client_subscribe_multiple(c->mqtt, batch, n);
+        if (msg_id < 0) {
+            ESP_LOGE(TAG, "%s: resubscribe failed, retrying in %d ms", c->config.name, RESUB_RETRY_MS);
+            return -1;
+        }
+        topics += n;
+        packets++;
+    }
+
+    if (topics > 0) {
+        ESP_LOGI(TAG, "%s: resubscribed %d topics in %d packets", c->config.name, topics, packets);
+    }
+    return msg_id;
+}
+
+/**
+ * Resubscribe and track the SUBACK that sets SUBSCRIBED
+ *
+ * Runs in the MQTT task on connect and in the timer task on retry. In the
+ * latter case the SUBACK may be handled before the msg_id is stored, so
+ * this side and the SUBSCRIBED event each check what the other stored.
+ */
+static void resubscribe_start(wifi_mqtt_client_t *c)
+{
+    int msg_id = resubscribe_all(c);
+
+    if (msg_id < 0) {
+        xTimerChangePeriod(c->resub_timer, pdMS_TO_TICKS(RESUB_RETRY_MS), 0);
+        return;
+    }
+    atomic_store(&c->resub_msg_id, msg_id);
+    if (msg_id == 0 || atomic_load(&c->last_suback) == msg_id) {
+        xEventGroupSetBits(c->state, WIFI_MQTT_STATE_SUBSCRIBED);
+    }
+}
+
+/** A SUBSCRIBE could not be sent while connected: resubscribe on the timer */
+static void resubscribe_retry(wifi_mqtt_client_t *c)
+{
+    xEventGroupClearBits(c->state, WIFI_MQTT_STATE_SUBSCRIBED);
+    xTimerChangePeriod(c->resub_timer, pdMS_TO_TICKS(RESUB_RETRY_MS), 0);
+}
+
+static void resub_timer_cb(TimerHandle_t timer)
+{
+    wifi_mqtt_client_t *c = pvTimerGetTimerID(timer);
+
+    if (client_connected(c) && !(xEventGroupGetBits(c->state) & WIFI_MQTT_STATE_SUBSCRIBED)) {
+        resubscribe_start(c);
+    }
+}
+
+/*
+ * ============================================================================
+ *                          ASYNC PUBLISH TOKENS
+ * ============================================================================
+ * Tokens of pending QoS 1/2 wifi_mqtt_publish_async() calls, matched by
+ * msg_id when the MQTT task reports PUBLISHED or DELETED. msg_ids are per
+ * connection, so each client has its own table. The slot is reserved
+ * before the enqueue, so a full table fails the publish instead of losing
+ * its outcome, and bound to the msg_id right after. An outcome that
+ * arrives in between is parked in early_acks.
+ *
+ * The lock is never held across esp-mqtt calls: the MQTT task holds the
+ * client lock while it dispatches events.
+ */
+
+static void token_finish(wifi_mqtt_pub_token_t *token, bool ok)
+{
+    token->state = ok ? WIFI_MQTT_PUB_DONE : WIFI_MQTT_PUB_FAILED;
+    if (token->done) {
+        token->done(token);
+    }
+}
+
+static pub_token_slot_t *token_reserve(wifi_mqtt_client_t *c, wifi_mqtt_pub_token_t *token)
+{
+    pub_token_slot_t *slot = NULL;
+
+    xSemaphoreTake(c->token_lock, portMAX_DELAY);
+    for (int i = 0; i < PUB_TOKEN_SLOTS; i++) {
+        if (!c->token_slots[i].token) {
+            slot = &c->token_slots[i];
+            slot->token = token;
+            slot->msg_id = 0;
+            c->tokens_binding++;
+            break;
+        }
+    }
+    xSemaphoreGive(c->token_lock);
+    return slot;
+}
+
+/** Bind a reserved slot to the enqueued msg_id (msg_id < 0 releases it) */
+static void token_bind(wifi_mqtt_client_t *c, pub_token_slot_t *slot, int msg_id)
+{
+    wifi_mqtt_pub_token_t *token = slot->token;
+    int early = -1;
+
+    xSemaphoreTake(c->token_lock, portMAX_DELAY);
+    c->tokens_binding--;
+    for (int i = 0; msg_id > 0 && i < PUB_EARLY_ACKS; i++) {
+        if (c->early_acks[i].msg_id == msg_id) {
+            early = c->early_acks[i].ok;
+            c->early_acks[i].msg_id = 0;
+            break;
+        }
+    }
+    if (msg_id > 0 && early < 0) {
+        slot->msg_id = msg_id;
+    } else {
+        slot->token = NULL;
+    }
+    xSemaphoreGive(c->token_lock);
+
+    token->msg_id = msg_id;
+    if (early >= 0) {
+        token_finish(token, early);
+    }
+}
+
+/** MQTT task: msg_id was acknowledged (ok) or dropped from the outbox */
+static void token_complete(wifi_mqtt_client_t *c, int msg_id, bool ok)
+{
+    wifi_mqtt_pub_token_t *token = NULL;
 
-// Connection state
-static bool s_wifi_connected = false;
-static bool s_mqtt_connected = false;
-static uint8_t s_wifi_retry_count = 0;
+    if (msg_id <= 0) {
+        return;
+    }
+
+    xSemaphoreTake(c->token_lock, portMAX_DELAY);
+    for (int i = 0; i < PUB_TOKEN_SLOTS; i++) {
+        if (c->token_slots[i].token && c->token_slots[i].msg_id == msg_id) {
+            token = c->token_slots[i].token;
+            c->token_slots[i].token = NULL;
+            break;
+        }
+    }
+    if (!token && c->tokens_binding > 0) {
+        c->early_acks[c->early_next++ % PUB_EARLY_ACKS] = (pub_early_ack_t){ msg_id, ok };
+    }
+    xSemaphoreGive(c->token_lock);
+
+    if (token) {
+        token_finish(token, ok);
+    }
+}
+
+/*
+ * ============================================================================
+ *                            OUTBOX LIMITS
+ * ============================================================================
+ * esp-mqtt has no API to remove a queued message, so outbox_max_bytes and
+ * outbox_max_msgs are enforced on admission, lowest priority first: QoS 0
+ * is refused once the outbox is 3/4 full, QoS 1/2 only at the limit. The
+ * outbox size comes from esp-mqtt; the number of QoS 1/2 messages waiting
+ * for an ack is counted here, from admission to PUBLISHED or DELETED with
+ * a msg_id. Queued QoS 0 messages expire as DELETED with msg_id 0 and are
+ * not counted.
+ */
+
+/** A QoS 1/2 message left the outbox (or never got in) */
+static void outbox_release(wifi_mqtt_client_t *c)
+{
+    unsigned n = atomic_load(&c->outbox_msgs);
+
+    // Never below 0, whatever esp-mqtt reports
+    while (n > 0 && !atomic_compare_exchange_weak(&c->outbox_msgs, &n, n - 1)) {
+    }
+}
+
+static bool outbox_refuse(wifi_mqtt_client_t *c, int qos)
+{
+    atomic_fetch_add_explicit(qos > 0 ? &c->outbox_dropped_qos1 : &c->outbox_dropped_qos0, 1,
+                              memory_order_relaxed);
+    return false;
+}
+
+/**
+ * May this message go into the outbox? An admitted QoS 1/2 message counts
+ * as waiting for its ack until outbox_release().
+ */
+static bool outbox_admit(wifi_mqtt_client_t *c, const char *topic, int len, int qos)
+{
+    uint32_t max_bytes = c->config.outbox_max_bytes;
+
+    if (max_bytes) {
+        uint32_t limit = qos > 0 ? max_bytes : max_bytes - max_bytes / 4;
+        uint32_t size = (uint32_t)esp_mqtt_client_get_outbox_size(c->mqtt) +
+                        (uint32_t)strlen(topic) + (uint32_t)len + OUTBOX_MSG_OVERHEAD;
+        if (size > limit) {
+            return outbox_refuse(c, qos);
+        }
+    }
+    if (qos > 0) {
+        unsigned waiting = atomic_fetch_add(&c->outbox_msgs, 1);
+        if (c->config.outbox_max_msgs && waiting >= c->config.outbox_max_msgs) {
+            outbox_release(c);
+            return outbox_refuse(c, qos);
+        }
+    }
+    return true;
+}
+
+/*
+ * ============================================================================
+ *                         RECEIVE & REASSEMBLY
+ * ============================================================================
+ * esp-mqtt delivers a payload larger than its receive buffer as several
+ * MQTT_EVENT_DATA events: the first with the topic and offset 0, the rest
+ * with no topic and growing current_data_offset. They come back to back
+ * from the client's MQTT task, so one message per client is assembled at a
+ * time; a new first fragment or a disconnect abandons an incomplete one.
+ *
+ * - Unfragmented messages go to the handlers straight from the receive
+ *   buffer, as before.
+ * - Stream handlers get every fragment as it arrives.
+ * - Whole-message handlers (and message_received if no handler matches)
+ *   get the payload once complete, from one buffer of at most
+ *   rx_reassembly_max bytes that is kept and reused. Larger payloads are
+ *   dropped for them and counted.
+ *
+ * All of this runs in the client's MQTT task only.
+ */
+
+/** Complete message (or fragment, for stream handlers) to the handlers */
+static int rx_dispatch(wifi_mqtt_client_t *c, const topic_msg_t *msg, unsigned flags)
+{
+    int handled = 0;
+
+    if (c->topics) {
+        xSemaphoreTakeRecursive(c->topic_lock, portMAX_DELAY);
+        handled = topic_trie_dispatch(c->topics, msg, flags);
+        xSemaphoreGiveRecursive(c->topic_lock);
+    }
+    return handled;
+}
+
+static void rx_fallback(wifi_mqtt_client_t *c, const topic_msg_t *msg)
+{
+    if (!c->config.callbacks.message_received) {
+        return;
+    }
+
+    // Create null-terminated topic string
+    char topic[128];
+    int topic_len = msg->topic_len < (int)sizeof(topic) - 1 ? msg->topic_len : (int)sizeof(topic) - 1;
+    memcpy(topic, msg->topic, topic_len);
+    topic[topic_len] = '\0';
+
+    c->config.callbacks.message_received(topic, msg->data, msg->data_len);
+}
+
+static void rx_abandon(wifi_mqtt_client_t *c, const char *why)
+{
+    rx_assembly_t *rx = &c->rx;
+
+    if (rx->received >= 0) {
+        ESP_LOGW(TAG, "Dropped %.*s after %d of %d bytes: %s",
+                 rx->topic_len, rx->topic, rx->received, rx->total_len, why);
+        c->rx_dropped++;
+        rx->received = -1;
+    }
+}
+
+/** First fragment: remember the topic, decide whether to buffer */
+static bool rx_begin(wifi_mqtt_client_t *c, const topic_msg_t *msg, int msg_id)
+{
+    rx_assembly_t *rx = &c->rx;
+
+    if (msg->topic_len > rx->topic_cap) {
+        char *topic = realloc(rx->topic, msg->topic_len);
+        if (!topic) {
+            c->rx_dropped++;
+            return false;
+        }
+        rx->topic = topic;
+        rx->topic_cap = msg->topic_len;
+    }
+    memcpy(rx->topic, msg->topic, msg->topic_len);
+    rx->topic_len = msg->topic_len;
+    rx->total_len = msg->total_len;
+    rx->msg_id = msg_id;
+    rx->received = 0;
+
+    bool whole = rx_dispatch(c, msg, TOPIC_DISPATCH_WHOLE | TOPIC_DISPATCH_PROBE) > 0;
+    rx->fallback = !whole && rx_dispatch(c, msg, TOPIC_DISPATCH_STREAM | TOPIC_DISPATCH_PROBE) == 0 &&
+                   c->config.callbacks.message_received;
+    rx->buffering = whole || rx->fallback;
+
+    if (rx->buffering && msg->total_len > (int)c->config.rx_reassembly_max) {
+        ESP_LOGW(TAG, "%d byte payload on %.*s exceeds rx_reassembly_max (%" PRIu32 "), "
+                 "only stream handlers get it", msg->total_len, msg->topic_len, msg->topic,
+                 c->config.rx_reassembly_max);
+        c->rx_dropped++;
+        rx->buffering = false;
+        rx->fallback = false;
+    }
+    if (rx->buffering && msg->total_len > rx->buf_cap) {
+        char *buf = realloc(rx->buf, msg->total_len);
+        if (!buf) {
+            ESP_LOGE(TAG, "No memory to reassemble %d bytes", msg->total_len);
+            c->rx_dropped++;
+            rx->buffering = false;
+            rx->fallback = false;
+        } else {
+            rx->buf = buf;
+            rx->buf_cap = msg->total_len;
+        }
+    }
+    return true;
+}
+
+static void rx_data(wifi_mqtt_client_t *c, esp_mqtt_event_handle_t event)
+{
+    rx_assembly_t *rx = &c->rx;
+    topic_msg_t msg = {
+        .topic = event->topic,
+        .topic_len = event->topic_len,
+        .data = event->data,
+        .data_len = event->data_len,
+        .offset = event->current_data_offset,
+        .total_len = event->total_data_len,
+    };
+
+    // Not fragmented: straight from the receive buffer
+    if (msg.offset == 0 && msg.data_len >= msg.total_len) {
+        rx_abandon(c, "new message");
+        if (rx_dispatch(c, &msg, TOPIC_DISPATCH_WHOLE | TOPIC_DISPATCH_STREAM) == 0) {
+            rx_fallback(c, &msg);
+        }
+        return;
+    }
+
+    if (msg.offset == 0) {
+        rx_abandon(c, "new message");
+        if (!rx_begin(c, &msg, event->msg_id)) {
+            return;
+        }
+    } else if (rx->received != msg.offset || rx->msg_id != event->msg_id) {
+        // Gap, or start missed (e.g. after a failed begin): nothing to attach to
+        rx_abandon(c, "fragment out of sequence");
+        return;
+    }
+
+    msg.topic = rx->topic;
+    msg.topic_len = rx->topic_len;
+    rx_dispatch(c, &msg, TOPIC_DISPATCH_STREAM);
+
+    if (rx->buffering) {
+        memcpy(&rx->buf[msg.offset], msg.data, msg.data_len);
+    }
+    rx->received += msg.data_len;
+    if (rx->received < rx->total_len) {
+        return;
+    }
+
+    rx->received = -1;
+    if (!rx->buffering) {
+        return;
+    }
+
+    topic_msg_t whole = {
+        .topic = rx->topic,
+        .topic_len = rx->topic_len,
+        .data = rx->buf,
+        .data_len = rx->total_len,
+        .total_len = rx->total_len,
+    };
+    c->rx_reassembled++;
+    if (rx->fallback) {
+        rx_fallback(c, &whole);
+    } else {
+        rx_dispatch(c, &whole, TOPIC_DISPATCH_WHOLE);
+    }
+}
+
+/** Start a client's MQTT task (WiFi is up) */
+static void client_start(wifi_mqtt_client_t *c)
+{
+    if (!c->started) {
+        if (esp_mqtt_client_start(c->mqtt) == ESP_OK) {
+            c->started = true;
+        } else {
+            ESP_LOGE(TAG, "Failed to start %s client", c->config.name);
+        }
+    }
+}
+
+#if WIFI_MQTT_HAS_WIFI
+
+static void wifi_connect_attempt(void *ctx)
+{
+    esp_wifi_connect();
+}
 
 /*
  * ============================================================================
@@ -50,25 +853,22 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
             esp_wifi_connect();
             break;
 
+        case WIFI_EVENT_STA_CONNECTED:
+            xEventGroupSetBits(s_net_state, WIFI_MQTT_STATE_WIFI);
+            break;
+
         case WIFI_EVENT_STA_DISCONNECTED:
-            s_wifi_connected = false;
+            xEventGroupClearBits(s_net_state, STATE_NET_BITS);
+            link_down(&s_wifi_link);
 
             // Call user callback
             if (s_callbacks.wifi_disconnected) {
                 s_callbacks.wifi_disconnected();
             }
 
-            // Auto-reconnect logic
+            // Auto-reconnect with backoff (also after failed attempts)
             if (s_config.auto_reconnect) {
-                if (s_config.max_wifi_retry == 0 ||
-                    s_wifi_retry_count < s_config.max_wifi_retry) {
-
-                    s_wifi_retry_count++;
-                    ESP_LOGI(TAG, "WiFi disconnected, retrying... (%d)", s_wifi_retry_count);
-                    esp_wifi_connect();
-                } else {
-                    ESP_LOGE(TAG, "WiFi connection failed after %d retries", s_wifi_retry_count);
-                }
+                schedule_reconnect(&s_wifi_link);
             } else {
                 ESP_LOGI(TAG, "WiFi disconnected (auto-reconnect disabled)");
             }
@@ -82,22 +882,36 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
             ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
             ESP_LOGI(TAG, "WiFi connected! IP: " IPSTR, IP2STR(&event->ip_info.ip));
 
-            s_wifi_connected = true;
-            s_wifi_retry_count = 0;  // Reset retry counter
+            xEventGroupSetBits(s_net_state, STATE_NET_BITS);
+            link_up(&s_wifi_link);
 
             // Call user callback
             if (s_callbacks.wifi_connected) {
                 s_callbacks.wifi_connected();
             }
 
-            // Start MQTT connection
-            if (s_mqtt_client) {
-                esp_mqtt_client_start(s_mqtt_client);
+            // Start MQTT connections, or retry them now instead of waiting out their backoff
+            for (wifi_mqtt_client_t *c = s_clients; c; c = c->next) {
+                if (!c->started) {
+                    client_start(c);
+                } else if (!client_connected(c)) {
+                    xTimerStop(c->link.timer, 0);
+                    c->link.attempt = 0;
+                    esp_mqtt_client_reconnect(c->mqtt);
+                }
             }
         }
     }
 }
 
+#else
+
+static void wifi_connect_attempt(void *ctx)
+{
+}
+
+#endif // WIFI_MQTT_HAS_WIFI
+
 /*
  * ============================================================================
  *                         MQTT EVENT HANDLERS
@@ -105,76 +919,107 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
  */
 
 /**
- * MQTT event handler
+ * MQTT event handler (handler_args: the client)
  */
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                                 int32_t event_id, void *event_data)
 {
+    wifi_mqtt_client_t *c = handler_args;
+    const wifi_mqtt_callbacks_t *cb = &c->config.callbacks;
     esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
 
     switch ((esp_mqtt_event_id_t)event_id) {
     case MQTT_EVENT_CONNECTED:
-        ESP_LOGI(TAG, "MQTT connected to broker");
-        s_mqtt_connected = true;
+        ESP_LOGI(TAG, "%s connected to broker", c->config.name);
+        xEventGroupSetBits(c->state, WIFI_MQTT_STATE_MQTT);
+        link_up(&c->link);
+
+        // Before the user callback, so it sees the subscriptions in place
+        atomic_store(&c->last_suback, 0);
+        resubscribe_start(c);
 
         // Call user callback
-        if (s_callbacks.mqtt_connected) {
-            s_callbacks.mqtt_connected();
+        if (cb->mqtt_connected) {
+            cb->mqtt_connected();
         }
         break;
 
     case MQTT_EVENT_DISCONNECTED:
-        ESP_LOGI(TAG, "MQTT disconnected from broker");
-        s_mqtt_connected = false;
+        // Also posted for every failed connection attempt
+        ESP_LOGI(TAG, "%s disconnected from broker", c->config.name);
+        xEventGroupClearBits(c->state, STATE_CLIENT_BITS);
+        xTimerStop(c->resub_timer, 0);
+        atomic_store(&c->resub_msg_id, 0);
+        link_down(&c->link);
+        rx_abandon(c, "disconnected");
 
         // Call user callback
-        if (s_callbacks.mqtt_disconnected) {
-            s_callbacks.mqtt_disconnected();
+        if (cb->mqtt_disconnected) {
+            cb->mqtt_disconnected();
+        }
+
+        // Without WiFi, wait for GOT_IP instead of burning attempts
+        if (net_up()) {
+            schedule_reconnect(&c->link);
         }
         break;
 
     case MQTT_EVENT_SUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT subscribed, msg_id=%d", event->msg_id);
+        ESP_LOGI(TAG, "%s subscribed, msg_id=%d", c->config.name, event->msg_id);
+        atomic_store(&c->last_suback, event->msg_id);
+        if (event->msg_id > 0 && event->msg_id == atomic_load(&c->resub_msg_id)) {
+            xEventGroupSetBits(c->state, WIFI_MQTT_STATE_SUBSCRIBED);
+        }
         break;
 
     case MQTT_EVENT_UNSUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT unsubscribed, msg_id=%d", event->msg_id);
+        ESP_LOGI(TAG, "%s unsubscribed, msg_id=%d", c->config.name, event->msg_id);
         break;
 
     case MQTT_EVENT_PUBLISHED:
-        ESP_LOGD(TAG, "MQTT published, msg_id=%d", event->msg_id);
+        ESP_LOGD(TAG, "%s published, msg_id=%d", c->config.name, event->msg_id);
+
+        token_complete(c, event->msg_id, true);
+        if (event->msg_id > 0) {
+            outbox_release(c);
+        }
 
         // Call user callback
-        if (s_callbacks.message_published) {
-            s_callbacks.message_published(event->msg_id);
+        if (cb->message_published) {
+            cb->message_published(event->msg_id);
         }
         break;
 
-    case MQTT_EVENT_DATA:
-        ESP_LOGD(TAG, "MQTT data received: topic=%.*s", event->topic_len, event->topic);
-
-        // Call user callback
-        if (s_callbacks.message_received) {
-            // Create null-terminated topic string
-            char topic[128];
-            int topic_len = event->topic_len < sizeof(topic) - 1 ?
-                           event->topic_len : sizeof(topic) - 1;
-            memcpy(topic, event->topic, topic_len);
-            topic[topic_len] = '\0';
+    case MQTT_EVENT_DELETED:
+        // Expired from the outbox (OUTBOX_EXPIRED_TIMEOUT_MS) without an ack
+        ESP_LOGW(TAG, "%s message dropped from outbox, msg_id=%d", c->config.name, event->msg_id);
+        token_complete(c, event->msg_id, false);
+        if (event->msg_id > 0) {        // QoS 0 (msg_id 0) was never counted
+            outbox_release(c);
+        }
 
-            s_callbacks.message_received(topic, event->data, event->data_len);
+        if (cb->message_dropped) {
+            cb->message_dropped(event->msg_id);
         }
         break;
 
+    case MQTT_EVENT_DATA:
+        ESP_LOGD(TAG, "%s data received: topic=%.*s offset=%d/%d", c->config.name,
+                 event->topic_len, event->topic, event->current_data_offset, event->total_data_len);
+
+        // Topic handlers, else message_received (see RECEIVE & REASSEMBLY)
+        rx_data(c, event);
+        break;
+
     case MQTT_EVENT_ERROR:
-        ESP_LOGE(TAG, "MQTT error");
+        ESP_LOGE(TAG, "%s error", c->config.name);
         if (event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT) {
             ESP_LOGE(TAG, "  TCP error: 0x%x", event->error_handle->esp_transport_sock_errno);
         }
         break;
 
     default:
-        ESP_LOGD(TAG, "MQTT event: %d", event_id);
+        ESP_LOGD(TAG, "%s event: %d", c->config.name, event_id);
         break;
     }
 }
@@ -185,6 +1030,8 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
  * ============================================================================
  */
 
+#if WIFI_MQTT_HAS_WIFI
+
 /**
  * Initialize WiFi in station mode
  */
@@ -276,61 +1123,183 @@ static esp_err_t wifi_init(void)
     return ESP_OK;
 }
 
+#else
+
+/**
+ * Linux target: the host network is already up, only the event loop is needed
+ */
+static esp_err_t wifi_init(void)
+{
+    esp_err_t ret = esp_event_loop_create_default();
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to create event loop");
+        return ret;
+    }
+    return ESP_OK;
+}
+
+#endif // WIFI_MQTT_HAS_WIFI
+
+/**
+ * Set up a client: locks, reconnect timer and esp-mqtt client
+ */
+static void publish_tap_cb(int msg_id, void *ctx)
+{
+    wifi_mqtt_client_t *c = ctx;
+    c->config.callbacks.message_sent(msg_id);
+}
+
 /**
- * Initialize MQTT client
+ * Transport for message_sent: inner (tls_resume, or NULL for the esp-mqtt
+ * TCP / SSL one) wrapped in a publish tap. ws:// and wss:// keep inner and
+ * get no message_sent.
  */
-static esp_err_t mqtt_init(void)
+static esp_transport_handle_t publish_tap_new(wifi_mqtt_client_t *c, bool tls,
+                                              esp_transport_handle_t inner)
+{
+    if (!tls && strncmp(c->config.mqtt_broker_uri, "mqtt://", 7) != 0) {
+        ESP_LOGW(TAG, "%s: message_sent needs mqtt:// or mqtts://", c->config.name);
+        return inner;
+    }
+
+    if (!inner && tls) {
+        inner = esp_transport_ssl_init();
+        if (inner && c->config.mqtt_ca_cert) {
+            esp_transport_ssl_set_cert_data(inner, c->config.mqtt_ca_cert, strlen(c->config.mqtt_ca_cert));
+        } else if (inner) {
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+            esp_transport_ssl_crt_bundle_attach(inner, esp_crt_bundle_attach);
+#endif
+        }
+    } else if (!inner) {
+        inner = esp_transport_tcp_init();
+    }
+
+    esp_transport_handle_t t = publish_tap_transport_new(inner, tls ? MQTTS_DEFAULT_PORT : MQTT_DEFAULT_PORT,
+                                                         publish_tap_cb, c);
+    if (!t) {
+        ESP_LOGW(TAG, "%s: no memory for the message_sent tap", c->config.name);
+    }
+    return t;
+}
+
+static esp_err_t client_init(wifi_mqtt_client_t *c, const wifi_mqtt_client_config_t *config)
 {
+    c->config = *config;
+    c->rx.received = -1;
+
+    if (c->config.rx_reassembly_max == 0) {
+        c->config.rx_reassembly_max = DEFAULT_RX_REASSEMBLY_MAX;
+    }
+
+    c->link.name = c->config.name;
+    c->link.connect = mqtt_connect_attempt;
+    c->link.ctx = c;
+    if (link_init(&c->link) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create reconnect timer");
+        return ESP_ERR_NO_MEM;
+    }
+
+    c->state = xEventGroupCreate();
+    c->token_lock = xSemaphoreCreateMutex();
+    c->topic_lock = xSemaphoreCreateRecursiveMutex();
+    c->resub_timer = xTimerCreate("mqtt_resub", 1, pdFALSE, c, resub_timer_cb);
+    if (!c->state || !c->token_lock || !c->topic_lock || !c->resub_timer) {
+        return ESP_ERR_NO_MEM;
+    }
+
     esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = s_config.mqtt_broker_uri,
+        .broker.address.uri = c->config.mqtt_broker_uri,
     };
 
     // Optional: Set username/password
-    if (s_config.mqtt_username) {
-        mqtt_cfg.credentials.username = s_config.mqtt_username;
+    if (c->config.mqtt_username) {
+        mqtt_cfg.credentials.username = c->config.mqtt_username;
     }
-    if (s_config.mqtt_password) {
-        mqtt_cfg.credentials.authentication.password = s_config.mqtt_password;
+    if (c->config.mqtt_password) {
+        mqtt_cfg.credentials.authentication.password = c->config.mqtt_password;
     }
 
-    // Optional: Set client ID
-    if (s_config.mqtt_client_id) {
-        mqtt_cfg.credentials.client_id = s_config.mqtt_client_id;
+    // Optional: Set client ID. Extra clients need one of their own: the
+    // esp-mqtt default (from the MAC) is the same for all of them
+    if (c->config.mqtt_client_id) {
+        mqtt_cfg.credentials.client_id = c->config.mqtt_client_id;
+    } else if (c != s_default) {
+        snprintf(c->client_id, sizeof(c->client_id), "%.24s_%08" PRIx32, c->config.name, esp_random());
+        mqtt_cfg.credentials.client_id = c->client_id;
     }
 
     // Optional: Set port
-    if (s_config.mqtt_port > 0) {
-        mqtt_cfg.broker.address.port = s_config.mqtt_port;
+    if (c->config.mqtt_port > 0) {
+        mqtt_cfg.broker.address.port = c->config.mqtt_port;
     }
 
     // Optional: Set keepalive
-    if (s_config.mqtt_keepalive > 0) {
-        mqtt_cfg.session.keepalive = s_config.mqtt_keepalive;
+    if (c->config.mqtt_keepalive > 0) {
+        mqtt_cfg.session.keepalive = c->config.mqtt_keepalive;
     } else {
         mqtt_cfg.session.keepalive = 120;  // Default 120 seconds
     }
 
+    // Reconnects are scheduled here with backoff (see RECONNECT SCHEDULER)
+    mqtt_cfg.network.disable_auto_reconnect = true;
+
+    // mqtts://: our own transport when the TLS session is to be resumed on
+    // reconnect (tls_resume.h), else the esp-mqtt one
+    bool tls = strncmp(c->config.mqtt_broker_uri, "mqtts://", 8) == 0;
+    if (tls && c->config.tls_session_resumption) {
+        mqtt_cfg.network.transport = tls_resume_transport_new(c->config.mqtt_ca_cert, &c->tls);
+        if (!mqtt_cfg.network.transport) {
+            ESP_LOGW(TAG, "%s: TLS session resumption unavailable%s", c->config.name,
+                     tls_resume_available() ? "" : " (CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)");
+        }
+    }
+    if (c->config.callbacks.message_sent) {
+        mqtt_cfg.network.transport = publish_tap_new(c, tls, mqtt_cfg.network.transport);
+    }
+    if (!mqtt_cfg.network.transport && c->config.mqtt_ca_cert) {
+        mqtt_cfg.broker.verification.certificate = c->config.mqtt_ca_cert;
+    } else if (!mqtt_cfg.network.transport && tls) {
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        mqtt_cfg.broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+#endif
+    }
+
     // Create MQTT client
-    s_mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
-    if (!s_mqtt_client) {
+    c->mqtt = esp_mqtt_client_init(&mqtt_cfg);
+    if (!c->mqtt) {
         ESP_LOGE(TAG, "Failed to init MQTT client");
+        if (mqtt_cfg.network.transport) {
+            esp_transport_destroy(mqtt_cfg.network.transport);
+        }
         return ESP_FAIL;
     }
 
     // Register MQTT event handler
-    esp_err_t ret = esp_mqtt_client_register_event(s_mqtt_client,
+    esp_err_t ret = esp_mqtt_client_register_event(c->mqtt,
                                                     ESP_EVENT_ANY_ID,
                                                     mqtt_event_handler,
-                                                    NULL);
+                                                    c);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register MQTT event handler");
         return ret;
     }
 
-    ESP_LOGI(TAG, "MQTT client initialized");
+    ESP_LOGI(TAG, "%s client initialized", c->config.name);
     return ESP_OK;
 }
 
+/** Append a set up client to s_clients */
+static void client_link(wifi_mqtt_client_t *c)
+{
+    wifi_mqtt_client_t **tail = &s_clients;
+
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = c;
+}
+
 /*
  * ============================================================================
  *                          PUBLIC API FUNCTIONS
@@ -346,11 +1315,16 @@ esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (!config->wifi_ssid || !config->mqtt_broker_uri) {
+    if ((WIFI_MQTT_HAS_WIFI && !config->wifi_ssid) || !config->mqtt_broker_uri) {
         ESP_LOGE(TAG, "Missing required config (SSID or broker URI)");
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (s_default) {
+        ESP_LOGE(TAG, "Already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
     // Store configuration
     memcpy(&s_config, config, sizeof(wifi_mqtt_config_t));
     memcpy(&s_callbacks, &config->callbacks, sizeof(wifi_mqtt_callbacks_t));
@@ -360,7 +1334,29 @@ esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
         s_config.max_wifi_retry = 5;  // Default: 5 retries
     }
     s_config.auto_reconnect = true;  // Always enable auto-reconnect
+    if (s_config.reconnect_min_ms == 0) {
+        s_config.reconnect_min_ms = DEFAULT_RECONNECT_MIN_MS;
+    }
+    if (s_config.reconnect_timeout_ms == 0) {
+        s_config.reconnect_timeout_ms = DEFAULT_RECONNECT_MAX_MS;
+    }
+    if (s_config.reconnect_timeout_ms < s_config.reconnect_min_ms) {
+        s_config.reconnect_timeout_ms = s_config.reconnect_min_ms;
+    }
+
+    ret = link_init(&s_wifi_link);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create reconnect timers");
+        return ret;
+    }
+    if (!s_net_state) {
+        s_net_state = xEventGroupCreate();
+        if (!s_net_state) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
+#if WIFI_MQTT_HAS_WIFI
     // Initialize NVS (required for WiFi)
     ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -371,6 +1367,7 @@ esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
         ESP_LOGE(TAG, "Failed to init NVS");
         return ret;
     }
+#endif
 
     // Initialize WiFi
     ret = wifi_init();
@@ -378,26 +1375,101 @@ esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
         return ret;
     }
 
-    // Initialize MQTT
-    ret = mqtt_init();
+    // Initialize the default MQTT client
+    wifi_mqtt_client_config_t client_config = {
+        .name = DEFAULT_CLIENT_NAME,
+        .mqtt_broker_uri = config->mqtt_broker_uri,
+        .mqtt_username = config->mqtt_username,
+        .mqtt_password = config->mqtt_password,
+        .mqtt_client_id = config->mqtt_client_id,
+        .mqtt_port = config->mqtt_port,
+        .mqtt_keepalive = config->mqtt_keepalive,
+        .rx_reassembly_max = config->rx_reassembly_max,
+        .outbox_max_bytes = config->outbox_max_bytes,
+        .outbox_max_msgs = config->outbox_max_msgs,
+        .mqtt_ca_cert = config->mqtt_ca_cert,
+        .tls_session_resumption = config->tls_session_resumption,
+        .callbacks = config->callbacks,
+    };
+    wifi_mqtt_client_t *c = calloc(1, sizeof(*c));
+    if (!c) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_default = c;
+    ret = client_init(c, &client_config);
     if (ret != ESP_OK) {
+        s_default = NULL;
         return ret;
     }
+    client_link(c);
 
     ESP_LOGI(TAG, "WiFi-MQTT component initialized");
     return ESP_OK;
 }
 
+esp_err_t wifi_mqtt_client_create(const wifi_mqtt_client_config_t *config, wifi_mqtt_client_t **out)
+{
+    if (!config || !config->name || !config->mqtt_broker_uri || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_default) {
+        ESP_LOGE(TAG, "Call wifi_mqtt_init() first");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    wifi_mqtt_client_t *c = calloc(1, sizeof(*c));
+    if (!c) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = client_init(c, config);
+    if (ret != ESP_OK) {
+        // Its timer and locks, if created, are kept: clients are not destroyed
+        return ret;
+    }
+    client_link(c);
+
+    if (s_running && net_up()) {
+        client_start(c);
+    }
+    *out = c;
+    return ESP_OK;
+}
+
+wifi_mqtt_client_t *wifi_mqtt_default_client(void)
+{
+    return s_default;
+}
+
 esp_err_t wifi_mqtt_start(void)
 {
     esp_err_t ret;
 
+    if (!s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_running = true;
+
+#if WIFI_MQTT_HAS_WIFI
     // Start WiFi
     ret = esp_wifi_start();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start WiFi");
         return ret;
     }
+#else
+    // Host network: go straight to MQTT
+    xEventGroupSetBits(s_net_state, STATE_NET_BITS);
+    if (s_callbacks.wifi_connected) {
+        s_callbacks.wifi_connected();
+    }
+    for (wifi_mqtt_client_t *c = s_clients; c; c = c->next) {
+        client_start(c);
+    }
+    ret = s_default->started ? ESP_OK : ESP_FAIL;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+#endif
 
     ESP_LOGI(TAG, "WiFi-MQTT started");
     return ESP_OK;
@@ -405,16 +1477,24 @@ esp_err_t wifi_mqtt_start(void)
 
 esp_err_t wifi_mqtt_stop(void)
 {
+    // No reconnects from the disconnect events that follow
+    s_running = false;
+    xTimerStop(s_wifi_link.timer, 0);
+
     // Stop MQTT
-    if (s_mqtt_client) {
-        esp_mqtt_client_stop(s_mqtt_client);
+    for (wifi_mqtt_client_t *c = s_clients; c; c = c->next) {
+        xTimerStop(c->link.timer, 0);
+        esp_mqtt_client_stop(c->mqtt);
+        c->started = false;
+        xEventGroupClearBits(c->state, STATE_CLIENT_BITS);
     }
 
+#if WIFI_MQTT_HAS_WIFI
     // Stop WiFi
     esp_wifi_stop();
+#endif
 
-    s_wifi_connected = false;
-    s_mqtt_connected = false;
+    xEventGroupClearBits(s_net_state, STATE_NET_BITS);
 
     ESP_LOGI(TAG, "WiFi-MQTT stopped");
     return ESP_OK;
@@ -422,17 +1502,73 @@ esp_err_t wifi_mqtt_stop(void)
 
 bool wifi_mqtt_is_wifi_connected(void)
 {
-    return s_wifi_connected;
+    return net_up();
+}
+
+bool wifi_mqtt_client_is_connected(wifi_mqtt_client_t *client)
+{
+    return client && client_connected(client);
 }
 
 bool wifi_mqtt_is_mqtt_connected(void)
 {
-    return s_mqtt_connected;
+    return wifi_mqtt_client_is_connected(s_default);
 }
 
-int wifi_mqtt_publish(const char *topic, const char *data, int qos)
+uint32_t wifi_mqtt_client_get_state(wifi_mqtt_client_t *client)
+{
+    if (!client) {
+        return 0;
+    }
+    return (xEventGroupGetBits(s_net_state) & STATE_NET_BITS) |
+           (xEventGroupGetBits(client->state) & STATE_CLIENT_BITS);
+}
+
+uint32_t wifi_mqtt_get_state(void)
+{
+    return wifi_mqtt_client_get_state(s_default);
+}
+
+esp_err_t wifi_mqtt_client_wait_ready(wifi_mqtt_client_t *client, uint32_t timeout_ms)
+{
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t wait = timeout_ms == WIFI_MQTT_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+
+    // Network first: the client bits only come after it. MQTT can still
+    // look connected for a moment after WiFi dropped, so check it again.
+    for (;;) {
+        EventBits_t bits = xEventGroupWaitBits(s_net_state, STATE_NET_BITS, pdFALSE, pdTRUE,
+                                               wait_left(start, wait));
+        if ((bits & STATE_NET_BITS) != STATE_NET_BITS) {
+            return ESP_ERR_TIMEOUT;
+        }
+        bits = xEventGroupWaitBits(client->state, STATE_CLIENT_BITS, pdFALSE, pdTRUE,
+                                   wait_left(start, wait));
+        if ((bits & STATE_CLIENT_BITS) != STATE_CLIENT_BITS) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (net_up()) {
+            return ESP_OK;
+        }
+    }
+}
+
+esp_err_t wifi_mqtt_wait_ready(uint32_t timeout_ms)
+{
+    if (!s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return wifi_mqtt_client_wait_ready(s_default, timeout_ms);
+}
+
+int wifi_mqtt_client_publish(wifi_mqtt_client_t *client, const char *topic,
+                             const void *data, int len, int qos)
 {
-    if (!s_mqtt_connected) {
+    if (!client || !client_connected(client)) {
         ESP_LOGW(TAG, "MQTT not connected, cannot publish");
         return -1;
     }
@@ -442,29 +1578,108 @@ int wifi_mqtt_publish(const char *topic, const char *data, int qos)
         return -1;
     }
 
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, data, 0, qos, 0);
+    // QoS 0 is written out directly and never enters the outbox
+    if (qos > 0 && !outbox_admit(client, topic, len ? len : (int)strlen(data), qos)) {
+        ESP_LOGW(TAG, "Outbox full, QoS %d message to %s refused", qos, topic);
+        return -1;
+    }
+
+    int msg_id = esp_mqtt_client_publish(client->mqtt, topic, data, len, qos, 0);
     if (msg_id < 0) {
         ESP_LOGE(TAG, "Failed to publish message");
+        if (qos > 0) {
+            outbox_release(client);
+        }
     }
 
     return msg_id;
 }
 
+int wifi_mqtt_publish(const char *topic, const char *data, int qos)
+{
+    return wifi_mqtt_client_publish(s_default, topic, data, 0, qos);
+}
+
 int wifi_mqtt_publish_binary(const char *topic, const void *data, int len, int qos)
 {
-    if (!s_mqtt_connected) {
-        ESP_LOGW(TAG, "MQTT not connected, cannot publish");
+    return wifi_mqtt_client_publish(s_default, topic, data, len, qos);
+}
+
+int wifi_mqtt_client_publish_async(wifi_mqtt_client_t *client, const char *topic,
+                                   const void *data, int len, int qos,
+                                   wifi_mqtt_pub_token_t *token)
+{
+    // No logging on failure: this runs in time critical tasks
+    if (!topic || len < 0 || (len > 0 && !data)) {
+        return -1;
+    }
+    if (!client || !client_connected(client)) {
+        return -1;
+    }
+    if (!outbox_admit(client, topic, len, qos)) {
         return -1;
     }
 
-    if (!topic || !data) {
-        ESP_LOGE(TAG, "Invalid topic or data");
+    pub_token_slot_t *slot = NULL;
+    if (token) {
+        token->state = WIFI_MQTT_PUB_PENDING;
+        token->msg_id = 0;
+        if (qos > 0) {
+            slot = token_reserve(client, token);
+            if (!slot) {
+                outbox_release(client);
+                return -1;
+            }
+        }
+    }
+
+    // esp-mqtt treats len 0 as "use strlen(data)"
+    int msg_id = esp_mqtt_client_enqueue(client->mqtt, topic, len ? data : "", len, qos, 0, true);
+    if (msg_id < 0 && qos > 0) {
+        outbox_release(client);
+    }
+
+    if (slot) {
+        token_bind(client, slot, msg_id);
+    } else if (token && msg_id >= 0) {
+        token_finish(token, true);      // QoS 0: queued is all there is
+    }
+    return msg_id < 0 ? -1 : msg_id;
+}
+
+int wifi_mqtt_publish_async(const char *topic, const void *data, int len, int qos,
+                            wifi_mqtt_pub_token_t *token)
+{
+    return wifi_mqtt_client_publish_async(s_default, topic, data, len, qos, token);
+}
+
+int wifi_mqtt_client_subscribe(wifi_mqtt_client_t *client, const char *topic, int qos)
+{
+    if (!topic_filter_valid(topic) || qos < 0 || qos > 2) {
+        ESP_LOGE(TAG, "Invalid topic");
+        return -1;
+    }
+    if (!client) {
+        ESP_LOGE(TAG, "Not initialized");
         return -1;
     }
 
-    int msg_id = esp_mqtt_client_publish(s_mqtt_client, topic, data, len, qos, 0);
+    int sub_qos = registry_set(client, topic, false, qos);
+    if (sub_qos < 0) {
+        ESP_LOGE(TAG, "Out of memory for subscription %s", topic);
+        return -1;
+    }
+    if (!client_connected(client)) {
+        ESP_LOGI(TAG, "Subscription to %s recorded, sent on connect", topic);
+        return 0;
+    }
+
+    int msg_id = esp_mqtt_client_subscribe(client->mqtt, topic, sub_qos);
     if (msg_id < 0) {
-        ESP_LOGE(TAG, "Failed to publish binary message");
+        ESP_LOGE(TAG, "Failed to subscribe to topic: %s, retrying in %d ms", topic, RESUB_RETRY_MS);
+        resubscribe_retry(client);
+    } else {
+        ESP_LOGI(TAG, "Subscribed to: %s (QoS %d)", topic, qos);
     }
 
     return msg_id;
@@ -472,21 +1687,26 @@ int wifi_mqtt_publish_binary(const char *topic, const void *data, int len, int q
 
 int wifi_mqtt_subscribe(const char *topic, int qos)
 {
-    if (!s_mqtt_connected) {
-        ESP_LOGW(TAG, "MQTT not connected, cannot subscribe");
-        return -1;
-    }
+    return wifi_mqtt_client_subscribe(s_default, topic, qos);
+}
 
-    if (!topic) {
+int wifi_mqtt_client_unsubscribe(wifi_mqtt_client_t *client, const char *topic)
+{
+    if (!topic || !client) {
         ESP_LOGE(TAG, "Invalid topic");
         return -1;
     }
 
-    int msg_id = esp_mqtt_client_subscribe(s_mqtt_client, topic, qos);
+    // Still wanted by a topic handler, or nothing to tell the broker
+    if (registry_set(client, topic, false, -1) >= 0 || !client_connected(client)) {
+        return 0;
+    }
+
+    int msg_id = esp_mqtt_client_unsubscribe(client->mqtt, topic);
     if (msg_id < 0) {
-        ESP_LOGE(TAG, "Failed to subscribe to topic: %s", topic);
+        ESP_LOGE(TAG, "Failed to unsubscribe from topic: %s", topic);
     } else {
-        ESP_LOGI(TAG, "Subscribed to: %s (QoS %d)", topic, qos);
+        ESP_LOGI(TAG, "Unsubscribed from: %s", topic);
     }
 
     return msg_id;
@@ -494,29 +1714,135 @@ int wifi_mqtt_subscribe(const char *topic, int qos)
 
 int wifi_mqtt_unsubscribe(const char *topic)
 {
-    if (!s_mqtt_connected) {
-        ESP_LOGW(TAG, "MQTT not connected, cannot unsubscribe");
+    return wifi_mqtt_client_unsubscribe(s_default, topic);
+}
+
+static int add_handler(wifi_mqtt_client_t *c, const char *filter, int qos,
+                       wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream, void *ctx)
+{
+    int sub_qos;
+
+    if (!c) {
+        ESP_LOGE(TAG, "Not initialized");
+        return -1;
+    }
+    if (qos < 0 || qos > 2) {
+        ESP_LOGE(TAG, "Cannot add handler for %s: %s", filter ? filter : "(null)",
+                 esp_err_to_name(ESP_ERR_INVALID_ARG));
         return -1;
     }
 
-    if (!topic) {
-        ESP_LOGE(TAG, "Invalid topic");
+    xSemaphoreTakeRecursive(c->topic_lock, portMAX_DELAY);
+    esp_err_t err = topic_trie_add(&c->topics, filter, qos, cb, stream, ctx, &sub_qos);
+    if (err == ESP_OK) {
+        sub_qos = registry_set(c, filter, true, sub_qos);
+        if (sub_qos < 0) {
+            topic_trie_remove(c->topics, filter, cb, stream, ctx, &sub_qos);
+            err = ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreGiveRecursive(c->topic_lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot add handler for %s: %s", filter ? filter : "(null)", esp_err_to_name(err));
         return -1;
     }
+    if (!client_connected(c)) {
+        return 0;       // Subscribed on connect
+    }
 
-    int msg_id = esp_mqtt_client_unsubscribe(s_mqtt_client, topic);
+    int msg_id = esp_mqtt_client_subscribe(c->mqtt, filter, sub_qos);
     if (msg_id < 0) {
-        ESP_LOGE(TAG, "Failed to unsubscribe from topic: %s", topic);
-    } else {
-        ESP_LOGI(TAG, "Unsubscribed from: %s", topic);
+        // The handler stays registered and the timer retries the SUBSCRIBE
+        ESP_LOGE(TAG, "Failed to subscribe to topic: %s, retrying in %d ms", filter, RESUB_RETRY_MS);
+        resubscribe_retry(c);
+        return -1;
+    }
+    ESP_LOGI(TAG, "Subscribed to: %s (QoS %d, %s)", filter, sub_qos, cb ? "handler" : "stream");
+    return msg_id;
+}
+
+static int remove_handler(wifi_mqtt_client_t *c, const char *filter,
+                          wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream, void *ctx)
+{
+    int sub_qos = -1;
+
+    if (!c) {
+        return -1;
+    }
+
+    xSemaphoreTakeRecursive(c->topic_lock, portMAX_DELAY);
+    esp_err_t err = topic_trie_remove(c->topics, filter, cb, stream, ctx, &sub_qos);
+    // Still subscribed while other handlers or wifi_mqtt_subscribe() want it
+    bool unsubscribe = err == ESP_OK && registry_set(c, filter, true, sub_qos) < 0;
+    xSemaphoreGiveRecursive(c->topic_lock);
+
+    if (err != ESP_OK) {
+        return -1;
+    }
+    if (!unsubscribe || !client_connected(c)) {
+        return 0;
     }
 
+    int msg_id = esp_mqtt_client_unsubscribe(c->mqtt, filter);
+    if (msg_id < 0) {
+        ESP_LOGE(TAG, "Failed to unsubscribe from topic: %s", filter);
+        return 0;
+    }
+    ESP_LOGI(TAG, "Unsubscribed from: %s", filter);
     return msg_id;
 }
 
+int wifi_mqtt_client_subscribe_handler(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                       wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return cb ? add_handler(client, filter, qos, cb, NULL, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_handler(wifi_mqtt_client_t *client, const char *filter,
+                                         wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return cb ? remove_handler(client, filter, cb, NULL, ctx) : -1;
+}
+
+int wifi_mqtt_client_subscribe_stream(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                      wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return cb ? add_handler(client, filter, qos, NULL, cb, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_stream(wifi_mqtt_client_t *client, const char *filter,
+                                        wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return cb ? remove_handler(client, filter, NULL, cb, ctx) : -1;
+}
+
+int wifi_mqtt_subscribe_handler(const char *filter, int qos, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_subscribe_handler(s_default, filter, qos, cb, ctx);
+}
+
+int wifi_mqtt_unsubscribe_handler(const char *filter, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_unsubscribe_handler(s_default, filter, cb, ctx);
+}
+
+int wifi_mqtt_subscribe_stream(const char *filter, int qos, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_subscribe_stream(s_default, filter, qos, cb, ctx);
+}
+
+int wifi_mqtt_unsubscribe_stream(const char *filter, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_unsubscribe_stream(s_default, filter, cb, ctx);
+}
+
 esp_err_t wifi_mqtt_get_ip_address(char *ip_str, size_t len)
 {
-    if (!s_wifi_connected || !s_netif) {
+#if !WIFI_MQTT_HAS_WIFI
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (!net_up() || !s_netif) {
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -528,11 +1854,15 @@ esp_err_t wifi_mqtt_get_ip_address(char *ip_str, size_t len)
 
     snprintf(ip_str, len, IPSTR, IP2STR(&ip_info.ip));
     return ESP_OK;
+#endif
 }
 
 int8_t wifi_mqtt_get_rssi(void)
 {
-    if (!s_wifi_connected) {
+#if !WIFI_MQTT_HAS_WIFI
+    return 0;
+#else
+    if (!net_up()) {
         return 0;
     }
 
@@ -543,4 +1873,53 @@ int8_t wifi_mqtt_get_rssi(void)
     }
 
     return ap_info.rssi;
+#endif
+}
+
+int wifi_mqtt_client_get_outbox_size(wifi_mqtt_client_t *client)
+{
+    if (!client) {
+        return 0;
+    }
+
+    return esp_mqtt_client_get_outbox_size(client->mqtt);
+}
+
+int wifi_mqtt_get_outbox_size(void)
+{
+    return wifi_mqtt_client_get_outbox_size(s_default);
+}
+
+static void link_stats(const reconnect_link_t *link, wifi_mqtt_link_stats_t *out)
+{
+    *out = link->stats;
+    out->down = link->down;
+    out->down_for_ms = link->down ? pdTICKS_TO_MS(xTaskGetTickCount() - link->down_since) : 0;
+}
+
+void wifi_mqtt_client_get_stats(wifi_mqtt_client_t *client, wifi_mqtt_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    link_stats(&s_wifi_link, &stats->wifi);
+    if (client) {
+        link_stats(&client->link, &stats->mqtt);
+        stats->rx_reassembled = client->rx_reassembled;
+        stats->rx_dropped = client->rx_dropped;
+        stats->outbox_bytes = (uint32_t)wifi_mqtt_client_get_outbox_size(client);
+        stats->outbox_msgs = atomic_load(&client->outbox_msgs);
+        stats->outbox_dropped_qos0 = atomic_load(&client->outbox_dropped_qos0);
+        stats->outbox_dropped_qos1 = atomic_load(&client->outbox_dropped_qos1);
+        stats->tls_handshakes = client->tls.handshakes;
+        stats->tls_resume_attempts = client->tls.resume_attempts;
+        stats->tls_full_handshake_ms = client->tls.full_ms;
+        stats->tls_resume_handshake_ms = client->tls.resume_ms;
+    }
+}
+
+void wifi_mqtt_get_stats(wifi_mqtt_stats_t *stats)
+{
+    wifi_mqtt_client_get_stats(s_default, stats);
 }
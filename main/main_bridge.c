@@ -22,11 +22,17 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "ble_mesh_provisioner.h"
 #include "wifi_mqtt.h"
 #include "mesh_mqtt_bridge.h"
+#include "gateway_metrics.h"
+#include "gateway_prof.h"
+#include "gateway_trace.h"
+#include "mesh_traffic_injector.h"
+#include "mesh_capture.h"
 
 #define TAG "MAIN"
 
@@ -36,6 +42,11 @@
 #define MQTT_BROKER_URI CONFIG_MQTT_BROKER_URI
 #define MQTT_TOPIC_PREFIX CONFIG_MQTT_TOPIC_PREFIX
 
+// Gateway commands (payload is the command name)
+#define GATEWAY_CMD_TOPIC   MQTT_TOPIC_PREFIX "/gateway/cmd"
+#define GATEWAY_TRACE_TOPIC MQTT_TOPIC_PREFIX "/gateway/trace"
+#define GATEWAY_CAPTURE_TOPIC MQTT_TOPIC_PREFIX "/gateway/capture"
+
 /**
  * ===========================================================================
  *                              MQTT CALLBACKS
@@ -52,11 +63,102 @@ static void on_mqtt_disconnected(void)
     ESP_LOGW(TAG, "✗ MQTT disconnected - messages will be queued");
 }
 
+/**
+ * Gateway commands on <prefix>/gateway/cmd:
+ *   trace_dump       Publish the trace ring to <prefix>/gateway/trace
+ *   trace_dump_uart  Print the trace ring as GWTRACE: lines on the console
+ *   capture_start    Start recording mesh traffic (truncates the capture)
+ *   capture_stop     Stop recording
+ *   capture_upload   Publish the SPIFFS capture to <prefix>/gateway/capture
+ */
+static void on_gateway_command(const char *topic, int topic_len,
+                               const char *cmd, int len, void *ctx)
+{
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    if (len == 10 && strncmp(cmd, "trace_dump", 10) == 0) {
+        err = gateway_trace_dump(wifi_mqtt_publish_binary, GATEWAY_TRACE_TOPIC);
+    } else if (len == 15 && strncmp(cmd, "trace_dump_uart", 15) == 0) {
+        err = gateway_trace_dump_uart();
+    } else if (len == 13 && strncmp(cmd, "capture_start", 13) == 0) {
+        err = mesh_capture_start();
+    } else if (len == 12 && strncmp(cmd, "capture_stop", 12) == 0) {
+        mesh_capture_stop();
+        err = ESP_OK;
+    } else if (len == 14 && strncmp(cmd, "capture_upload", 14) == 0) {
+        err = mesh_capture_upload(GATEWAY_CAPTURE_TOPIC);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Command '%.*s' failed: %s", len, cmd, esp_err_to_name(err));
+    }
+}
+
+/** Messages no topic handler matched */
 static void on_mqtt_message(const char *topic, const char *data, int data_len)
 {
     ESP_LOGI(TAG, "MQTT message: %s = %.*s", topic, data_len, data);
 }
 
+/**
+ * ===========================================================================
+ *                              METRICS SAMPLER
+ * ===========================================================================
+ * Runs in the metrics publisher task right before each snapshot.
+ */
+
+typedef struct {
+    gateway_metric_t *disconnects;      // Counter, fed with deltas
+    gateway_metric_t *outage_ms;        // Gauge: current or last outage
+    gateway_metric_t *max_outage_ms;    // Gauge: longest completed outage
+    uint32_t prev_disconnects;
+} link_metrics_t;
+
+static struct {
+    gateway_metric_t *outbox;
+    gateway_metric_t *outbox_msgs;
+    gateway_metric_t *outbox_dropped_qos0;  // Counters, fed with deltas
+    gateway_metric_t *outbox_dropped_qos1;
+    uint32_t prev_dropped_qos0;
+    uint32_t prev_dropped_qos1;
+    gateway_metric_t *tls_full_ms;          // Gauges: last handshake of each kind
+    gateway_metric_t *tls_resume_ms;
+    link_metrics_t wifi;
+    link_metrics_t mqtt;
+} s_net_metrics;
+
+static void sample_link(link_metrics_t *m, const wifi_mqtt_link_stats_t *st)
+{
+    gateway_metrics_counter_add(m->disconnects, st->disconnects - m->prev_disconnects);
+    m->prev_disconnects = st->disconnects;
+
+    gateway_metrics_gauge_set(m->outage_ms, (int32_t)(st->down ? st->down_for_ms : st->last_outage_ms));
+    gateway_metrics_gauge_set(m->max_outage_ms, (int32_t)st->max_outage_ms);
+}
+
+static void sample_mqtt_metrics(void *ctx)
+{
+    wifi_mqtt_stats_t stats;
+
+    wifi_mqtt_get_stats(&stats);
+    gateway_metrics_gauge_set(s_net_metrics.outbox, (int32_t)stats.outbox_bytes);
+    gateway_metrics_gauge_set(s_net_metrics.outbox_msgs, (int32_t)stats.outbox_msgs);
+    gateway_metrics_counter_add(s_net_metrics.outbox_dropped_qos0,
+                                stats.outbox_dropped_qos0 - s_net_metrics.prev_dropped_qos0);
+    gateway_metrics_counter_add(s_net_metrics.outbox_dropped_qos1,
+                                stats.outbox_dropped_qos1 - s_net_metrics.prev_dropped_qos1);
+    s_net_metrics.prev_dropped_qos0 = stats.outbox_dropped_qos0;
+    s_net_metrics.prev_dropped_qos1 = stats.outbox_dropped_qos1;
+
+    if (stats.tls_handshakes) {
+        gateway_metrics_gauge_set(s_net_metrics.tls_full_ms, (int32_t)stats.tls_full_handshake_ms);
+        gateway_metrics_gauge_set(s_net_metrics.tls_resume_ms, (int32_t)stats.tls_resume_handshake_ms);
+    }
+
+    sample_link(&s_net_metrics.wifi, &stats.wifi);
+    sample_link(&s_net_metrics.mqtt, &stats.mqtt);
+}
+
 /**
  * ===========================================================================
  *                         PROVISIONER CALLBACKS
@@ -104,6 +206,7 @@ void app_main(void)
         .match_prefix = {CONFIG_MESH_UUID_PREFIX_0, CONFIG_MESH_UUID_PREFIX_1},  // From menuconfig
         .net_idx = 0,
         .app_idx = 0,
+        .pool_monitor_period_ms = CONFIG_MESH_POOL_MONITOR_PERIOD_MS,
     };
 
     provisioner_callbacks_t prov_callbacks = {
@@ -127,16 +230,47 @@ void app_main(void)
         .wifi_ssid = WIFI_SSID,
         .wifi_password = WIFI_PASSWORD,
         .mqtt_broker_uri = MQTT_BROKER_URI,
+        .max_wifi_retry = CONFIG_WIFI_MAXIMUM_RETRY,
+        .reconnect_min_ms = CONFIG_WIFI_MQTT_RECONNECT_MIN_MS,
+        .reconnect_timeout_ms = CONFIG_WIFI_MQTT_RECONNECT_MAX_MS,
+        .outbox_max_bytes = CONFIG_MQTT_OUTBOX_MAX_BYTES,
+        .outbox_max_msgs = CONFIG_MQTT_OUTBOX_MAX_MSGS,
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+        .tls_session_resumption = true,     // mqtts:// only
+#endif
         .callbacks = {
             .mqtt_connected = on_mqtt_connected,
             .mqtt_disconnected = on_mqtt_disconnected,
             .message_received = on_mqtt_message,
+            .message_sent = mesh_mqtt_bridge_on_sent,            // Latency tracing
+            .message_published = mesh_mqtt_bridge_on_published,
         },
     };
 
     err = wifi_mqtt_init(&mqtt_config);
     ESP_ERROR_CHECK(err);
 
+#if CONFIG_MQTT_CONTROL_CONNECTION
+    // Commands on their own connection: not queued behind telemetry
+    wifi_mqtt_client_config_t ctl_config = {
+        .name = "MQTT-ctl",
+        .mqtt_broker_uri = MQTT_BROKER_URI,
+#if CONFIG_MQTT_TLS_SESSION_RESUMPTION
+        .tls_session_resumption = true,
+#endif
+    };
+    wifi_mqtt_client_t *ctl;
+    err = wifi_mqtt_client_create(&ctl_config, &ctl);
+    ESP_ERROR_CHECK(err);
+#else
+    wifi_mqtt_client_t *ctl = wifi_mqtt_default_client();
+#endif
+
+    // Recorded now, (re)subscribed by wifi_mqtt on every connect
+    if (wifi_mqtt_client_subscribe_handler(ctl, GATEWAY_CMD_TOPIC, 1, on_gateway_command, NULL) < 0) {
+        ESP_LOGE(TAG, "Cannot register %s - gateway commands unavailable", GATEWAY_CMD_TOPIC);
+    }
+
     err = wifi_mqtt_start();
     ESP_ERROR_CHECK(err);
 
@@ -151,11 +285,117 @@ void app_main(void)
         .mqtt_topic_prefix = MQTT_TOPIC_PREFIX,  // From menuconfig
         .mesh_net_idx = 0,
         .mesh_app_idx = 0,
+        .latency_sample_interval = CONFIG_BRIDGE_LATENCY_SAMPLE_INTERVAL,
+#if CONFIG_BRIDGE_LINK_ADAPT
+        .link_policy = {
+            .rssi_fair_dbm = CONFIG_BRIDGE_LINK_RSSI_FAIR_DBM,
+            .rssi_poor_dbm = CONFIG_BRIDGE_LINK_RSSI_POOR_DBM,
+            .rtt_fair_ms = CONFIG_BRIDGE_LINK_RTT_FAIR_MS,
+            .rtt_poor_ms = CONFIG_BRIDGE_LINK_RTT_POOR_MS,
+            .fail_fair_pct = CONFIG_BRIDGE_LINK_FAIL_FAIR_PCT,
+            .fail_poor_pct = CONFIG_BRIDGE_LINK_FAIL_POOR_PCT,
+            .batch_fair = CONFIG_BRIDGE_LINK_BATCH_FAIR,
+            .batch_poor = CONFIG_BRIDGE_LINK_BATCH_POOR,
+            .batch_delay_ms = CONFIG_BRIDGE_LINK_BATCH_DELAY_MS,
+        },
+#else
+        .link_policy.disabled = true,
+#endif
     };
 
     err = mesh_mqtt_bridge_init(&bridge_config);
     ESP_ERROR_CHECK(err);
 
+    // ┌──────────────────────────────────────────────────────────────────┐
+    // │ STEP 5: Publish gateway metrics                                 │
+    // └──────────────────────────────────────────────────────────────────┘
+    s_net_metrics.outbox = gateway_metrics_gauge("mqtt.outbox_bytes");
+    s_net_metrics.outbox_msgs = gateway_metrics_gauge("mqtt.outbox_msgs");
+    s_net_metrics.outbox_dropped_qos0 = gateway_metrics_counter("mqtt.outbox_dropped_qos0");
+    s_net_metrics.outbox_dropped_qos1 = gateway_metrics_counter("mqtt.outbox_dropped_qos1");
+    s_net_metrics.tls_full_ms = gateway_metrics_gauge("mqtt.tls_full_ms");
+    s_net_metrics.tls_resume_ms = gateway_metrics_gauge("mqtt.tls_resume_ms");
+    s_net_metrics.wifi.disconnects = gateway_metrics_counter("wifi.disconnects");
+    s_net_metrics.wifi.outage_ms = gateway_metrics_gauge("wifi.outage_ms");
+    s_net_metrics.wifi.max_outage_ms = gateway_metrics_gauge("wifi.max_outage_ms");
+    s_net_metrics.mqtt.disconnects = gateway_metrics_counter("mqtt.disconnects");
+    s_net_metrics.mqtt.outage_ms = gateway_metrics_gauge("mqtt.outage_ms");
+    s_net_metrics.mqtt.max_outage_ms = gateway_metrics_gauge("mqtt.max_outage_ms");
+    gateway_metrics_register_sampler(sample_mqtt_metrics, NULL);
+
+#if CONFIG_GATEWAY_SYSMON_ENABLE
+    err = gateway_metrics_sysmon_enable();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Task/heap telemetry not enabled: %s", esp_err_to_name(err));
+    }
+#endif
+
+#if CONFIG_GATEWAY_PROF_ENABLE
+    err = gateway_prof_enable();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Profiling report not enabled: %s", esp_err_to_name(err));
+    }
+#endif
+
+#if CONFIG_GATEWAY_METRICS_INTERVAL_MS > 0
+    gateway_metrics_publisher_config_t metrics_config = {
+        .topic_prefix = MQTT_TOPIC_PREFIX,
+        .interval_ms = CONFIG_GATEWAY_METRICS_INTERVAL_MS,
+        .publish = wifi_mqtt_publish,
+    };
+    err = gateway_metrics_publisher_start(&metrics_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics publisher not started: %s", esp_err_to_name(err));
+    }
+#endif
+
+#if !CONFIG_MESH_CAPTURE_SINK_NONE
+    // ┌──────────────────────────────────────────────────────────────────┐
+    // │ OPTIONAL: Record mesh traffic for offline replay                │
+    // └──────────────────────────────────────────────────────────────────┘
+    mesh_capture_config_t capture_config = {
+#if CONFIG_MESH_CAPTURE_SINK_SPIFFS
+        .sink = MESH_CAPTURE_SINK_SPIFFS,
+#else
+        .sink = MESH_CAPTURE_SINK_MQTT,
+#endif
+        .publish = wifi_mqtt_publish_binary,
+        .pending = wifi_mqtt_get_outbox_size,
+        .topic = GATEWAY_CAPTURE_TOPIC,
+        .ring_size = CONFIG_MESH_CAPTURE_RING_SIZE,
+    };
+    err = mesh_capture_init(&capture_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Mesh capture not available: %s", esp_err_to_name(err));
+    }
+#if CONFIG_MESH_CAPTURE_AUTOSTART
+    else {
+        mesh_capture_start();
+    }
+#endif
+#endif
+
+#if CONFIG_MESH_INJECTOR_ENABLE
+    // ┌──────────────────────────────────────────────────────────────────┐
+    // │ SOAK TEST: Synthetic mesh traffic instead of real nodes         │
+    // └──────────────────────────────────────────────────────────────────┘
+    mesh_traffic_injector_config_t inject_config = {
+        .traffic = {
+            .node_count = CONFIG_MESH_INJECTOR_NODES,
+            .rate_hz = CONFIG_MESH_INJECTOR_RATE_HZ,
+            .jitter_pct = CONFIG_MESH_INJECTOR_JITTER_PCT,
+            .hr_every = CONFIG_MESH_INJECTOR_HR_EVERY,
+            .pattern = CONFIG_MESH_INJECTOR_PATTERN,
+        },
+        .duration_s = CONFIG_MESH_INJECTOR_DURATION_S,
+        .start_delay_ms = 10000,    // Give WiFi/MQTT time to connect
+    };
+    err = mesh_traffic_injector_start(&inject_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Traffic injector not started: %s", esp_err_to_name(err));
+    }
+#endif
+
     // ┌──────────────────────────────────────────────────────────────────┐
     // │ ALL DONE! The bridge is now running                             │
     // └──────────────────────────────────────────────────────────────────┘
@@ -169,5 +409,6 @@ void app_main(void)
     ESP_LOGI(TAG, "IMU data will be published to:");
     ESP_LOGI(TAG, "  Topic: mesh/imu/0x<node_addr>");
     ESP_LOGI(TAG, "  Format: JSON with accel & gyro data");
+    ESP_LOGI(TAG, "Gateway metrics: %s/gateway/metrics", MQTT_TOPIC_PREFIX);
     ESP_LOGI(TAG, "========================================");
 }
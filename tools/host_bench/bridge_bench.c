@@ -0,0 +1,350 @@
+/*
+ * ============================================================================
+ *              HOST BENCHMARK - MESH → MQTT HOT PATH
+ * ============================================================================
+ *
+ * Compiles mesh_mqtt_bridge.c unmodified against a stub wifi_mqtt sink and
+ * feeds provisioner_vendor_msg_handler() / provisioner_sensor_msg_handler()
+ * with recorded frames (frames.h).
+ *
+ * For every mode it reports:
+ *   - ns/msg      wall time per handler call (after warm-up)
+ *   - bytes/msg   topic + payload bytes handed to wifi_mqtt
+ *   - stack       peak stack used by one handler call (painted stack)
+ *   - allocs/msg  heap allocations per handler call (malloc/calloc/realloc)
+ *
+ * The -batchN modes degrade the stub RSSI until the bridge batches N
+ * records per publish (default link policy: 4 on a fair link, 16 on a
+ * poor one), and flush the open batches at the end of the timed loop.
+ * vendor_imu32 replays the IMU frames from BENCH_MANY_NODES nodes, more
+ * than the bridge has batch slots.
+ *
+ * The gateway_metrics snapshot is printed at the end so routing counters
+ * can be checked against the number of messages fed.
+ *
+ * USAGE:
+ *   cmake -S tools/host_bench -B tools/host_bench/build
+ *   cmake --build tools/host_bench/build
+ *   ./tools/host_bench/build/bridge_bench [iterations]
+ */
+
+#include "mesh_mqtt_bridge.h"
+#include "gateway_metrics.h"
+#include "stub_wifi_mqtt.h"
+#include "frames.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Handlers under test (defined in mesh_mqtt_bridge.c)
+void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
+                                    uint8_t *data, uint16_t length);
+void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int32_t value);
+
+// Defined in bridge_batch.c: sends the given topic's batch and every batch past its deadline
+void bridge_batch_flush(const char *topic);
+
+FILE *host_log_stream = NULL;
+
+// Provisioner stub: frames are "received" right when they are fed
+int64_t provisioner_get_rx_time_us(void)
+{
+    return esp_timer_get_time();
+}
+
+#define BENCH_DEFAULT_ITERATIONS  200000
+#define BENCH_WARMUP_ITERATIONS   1000
+#define BENCH_STACK_SIZE          (64 * 1024)
+#define BENCH_STACK_PATTERN       0xA5
+#define BENCH_LINK_EVAL_US        1100000     // Past bridge_link.c LINK_EVAL_MS
+#define BENCH_LINK_SETTLE_EVALS   32
+#define BENCH_MANY_NODES          32
+
+/*
+ * ============================================================================
+ *                         ALLOCATION COUNTING
+ * ============================================================================
+ * Linked with -Wl,--wrap=malloc,... so every heap allocation made while a
+ * mode is running goes through these wrappers.
+ */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static volatile bool s_count_allocs = false;
+static uint64_t s_alloc_count = 0;
+static uint64_t s_alloc_bytes = 0;
+
+void *__wrap_malloc(size_t size)
+{
+    if (s_count_allocs) {
+        s_alloc_count++;
+        s_alloc_bytes += size;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    if (s_count_allocs) {
+        s_alloc_count++;
+        s_alloc_bytes += nmemb * size;
+    }
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (s_count_allocs) {
+        s_alloc_count++;
+        s_alloc_bytes += size;
+    }
+    return __real_realloc(ptr, size);
+}
+
+/*
+ * ============================================================================
+ *                              MODES
+ * ============================================================================
+ * One row per (workload, variant). New encodings or batching modes of the
+ * bridge get a new row here. The link only gets worse at once, so the
+ * batched rows come last, fair before poor.
+ */
+
+typedef enum {
+    WORKLOAD_VENDOR_IMU,
+    WORKLOAD_VENDOR_IMU_MANY,   // Same frames, BENCH_MANY_NODES source addresses
+    WORKLOAD_SENSOR_HR,
+} bench_workload_t;
+
+typedef struct {
+    const char *name;
+    bench_workload_t workload;
+    bool log_enabled;       // Format ESP_LOGx output (to /dev/null)
+    bridge_link_quality_t link;     // Good = one record per publish
+} bench_mode_t;
+
+static const bench_mode_t bench_modes[] = {
+    { "vendor_imu/json",         WORKLOAD_VENDOR_IMU, false, BRIDGE_LINK_GOOD },
+    { "vendor_imu/json+log",     WORKLOAD_VENDOR_IMU, true,  BRIDGE_LINK_GOOD },
+    { "sensor_hr/json",          WORKLOAD_SENSOR_HR,  false, BRIDGE_LINK_GOOD },
+    { "sensor_hr/json+log",      WORKLOAD_SENSOR_HR,  true,  BRIDGE_LINK_GOOD },
+    { "vendor_imu/json-batch4",  WORKLOAD_VENDOR_IMU, false, BRIDGE_LINK_FAIR },
+    { "vendor_imu/json-batch16", WORKLOAD_VENDOR_IMU, false, BRIDGE_LINK_POOR },
+    { "vendor_imu32/json-batch16", WORKLOAD_VENDOR_IMU_MANY, false, BRIDGE_LINK_POOR },
+};
+
+// Stub RSSI per link quality, clear of the default -67/-75 dBm thresholds
+static const int8_t bench_link_rssi[] = {
+    [BRIDGE_LINK_GOOD] = -50,
+    [BRIDGE_LINK_FAIR] = -72,
+    [BRIDGE_LINK_POOR] = -85,
+};
+
+#define BENCH_MODE_COUNT (sizeof(bench_modes) / sizeof(bench_modes[0]))
+
+typedef struct {
+    const bench_mode_t *mode;
+    uint32_t iterations;
+    uint64_t elapsed_ns;
+} bench_run_t;
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void feed_one(bench_workload_t workload, uint32_t i)
+{
+    if (workload == WORKLOAD_VENDOR_IMU || workload == WORKLOAD_VENDOR_IMU_MANY) {
+        const bench_vendor_frame_t *f = &bench_vendor_frames[i % BENCH_VENDOR_FRAME_COUNT];
+        uint16_t src = workload == WORKLOAD_VENDOR_IMU ? f->src_addr : 0x0100 + i % BENCH_MANY_NODES;
+        uint8_t data[sizeof(f->data)];
+        memcpy(data, f->data, sizeof(data));   // Handler takes a mutable buffer
+        provisioner_vendor_msg_handler(src, f->opcode, data, f->length);
+    } else {
+        const bench_sensor_frame_t *f = &bench_sensor_frames[i % BENCH_SENSOR_FRAME_COUNT];
+        provisioner_sensor_msg_handler(f->src_addr, f->property_id, f->value);
+    }
+}
+
+/**
+ * Send every open batch: the stub timers never fire, so move the clock
+ * past all deadlines for one flush
+ */
+static void flush_batches(void)
+{
+    int64_t now = esp_timer_get_time();
+
+    host_fake_time_us = now + 60 * 1000000LL;
+    bridge_batch_flush("");
+    host_fake_time_us = 0;
+}
+
+/**
+ * Bring the link to the mode's quality. It is re-evaluated at most once
+ * per second and the RSSI is smoothed, so step a pinned clock from one
+ * evaluation to the next instead of waiting.
+ */
+static int settle_link(const bench_mode_t *mode)
+{
+    int64_t t = esp_timer_get_time();
+
+    stub_mqtt_set_rssi(bench_link_rssi[mode->link]);
+    for (uint32_t i = 0; i < BENCH_LINK_SETTLE_EVALS; i++) {
+        if (mesh_mqtt_bridge_link_quality() == mode->link) {
+            break;
+        }
+        t += BENCH_LINK_EVAL_US;
+        host_fake_time_us = t;
+        feed_one(mode->workload, i);
+    }
+    host_fake_time_us = 0;
+    flush_batches();
+
+    return mesh_mqtt_bridge_link_quality() == mode->link ? 0 : -1;
+}
+
+static void *bench_thread(void *arg)
+{
+    bench_run_t *run = (bench_run_t *)arg;
+
+    for (uint32_t i = 0; i < BENCH_WARMUP_ITERATIONS; i++) {
+        feed_one(run->mode->workload, i);
+    }
+
+    stub_mqtt_reset();
+    s_alloc_count = 0;
+    s_alloc_bytes = 0;
+    s_count_allocs = true;
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < run->iterations; i++) {
+        feed_one(run->mode->workload, i);
+    }
+    if (run->mode->link != BRIDGE_LINK_GOOD) {
+        flush_batches();
+    }
+    run->elapsed_ns = now_ns() - start;
+
+    s_count_allocs = false;
+    return NULL;
+}
+
+/**
+ * Run one mode on a thread whose stack is painted with a known pattern,
+ * then scan for the deepest byte that was overwritten.
+ */
+static int run_mode(const bench_mode_t *mode, uint32_t iterations, size_t *stack_used)
+{
+    bench_run_t run = { .mode = mode, .iterations = iterations };
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (settle_link(mode) != 0) {
+        return -1;
+    }
+
+    uint8_t *stack = __real_malloc(BENCH_STACK_SIZE);
+    if (!stack) {
+        return -1;
+    }
+    memset(stack, BENCH_STACK_PATTERN, BENCH_STACK_SIZE);
+
+    host_log_stream = mode->log_enabled ? fopen("/dev/null", "w") : NULL;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, BENCH_STACK_SIZE);
+    if (pthread_create(&thread, &attr, bench_thread, &run) != 0) {
+        pthread_attr_destroy(&attr);
+        free(stack);
+        return -1;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (host_log_stream) {
+        fclose(host_log_stream);
+        host_log_stream = NULL;
+    }
+
+    // Stack grows down: the first modified byte from the bottom is the peak
+    size_t untouched = 0;
+    while (untouched < BENCH_STACK_SIZE && stack[untouched] == BENCH_STACK_PATTERN) {
+        untouched++;
+    }
+    *stack_used = BENCH_STACK_SIZE - untouched;
+    free(stack);
+
+    const stub_mqtt_stats_t *st = stub_mqtt_stats();
+    double n = (double)iterations;
+
+    printf("%-26s %10.1f %10.1f %10.1f %10zu %10.2f %10.1f\n",
+           mode->name,
+           run.elapsed_ns / n,
+           (st->topic_bytes + st->payload_bytes) / n,
+           st->payload_bytes / n,
+           *stack_used,
+           s_alloc_count / n,
+           s_alloc_bytes / n);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+
+    if (argc > 1) {
+        iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+        if (iterations == 0) {
+            fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bridge_config_t cfg = {
+        .mqtt_topic_prefix = "esp32",
+        .mesh_net_idx = 0,
+        .mesh_app_idx = 0,
+        .latency_sample_interval = 10,     // Same as CONFIG_BRIDGE_LATENCY_SAMPLE_INTERVAL
+    };
+    if (mesh_mqtt_bridge_init(&cfg) != ESP_OK) {
+        fprintf(stderr, "mesh_mqtt_bridge_init failed\n");
+        return 1;
+    }
+
+    printf("mesh_mqtt_bridge host benchmark: %u messages per mode\n", iterations);
+    printf("%-26s %10s %10s %10s %10s %10s %10s\n",
+           "mode", "ns/msg", "bytes/msg", "payload", "stack", "allocs/msg", "heap B/msg");
+
+    for (size_t i = 0; i < BENCH_MODE_COUNT; i++) {
+        size_t stack_used = 0;
+        if (run_mode(&bench_modes[i], iterations, &stack_used) != 0) {
+            fprintf(stderr, "mode %s failed\n", bench_modes[i].name);
+            return 1;
+        }
+    }
+
+    // Bridge counters accumulated over all modes (sanity check for routing)
+    char snapshot[1024];
+    if (gateway_metrics_snapshot_json(snapshot, sizeof(snapshot)) > 0) {
+        printf("\nmetrics: %s\n", snapshot);
+    }
+    for (unsigned i = 0; i < gateway_metrics_report_count(); i++) {
+        const char *name = NULL;
+        if (gateway_metrics_report_json(i, &name, snapshot, sizeof(snapshot)) > 0) {
+            printf("%s: %s\n", name, snapshot);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Recorded mesh frames used by the host benchmark
+ *
+ * Captured from M5Stick nodes running the IMU/heart-rate firmware
+ * (vendor opcode 0xC00001 with the 8-byte compact IMU layout, sensor
+ * property 0x2A37 for heart rate).
+ */
+
+#ifndef BENCH_FRAMES_H
+#define BENCH_FRAMES_H
+
+#include <stdint.h>
+
+#define BENCH_VENDOR_OP_IMU_DATA        0xC00001
+#define BENCH_SENSOR_PROP_HEART_RATE    0x2A37
+
+typedef struct {
+    uint16_t src_addr;
+    uint32_t opcode;
+    uint8_t  data[8];
+    uint16_t length;
+} bench_vendor_frame_t;
+
+typedef struct {
+    uint16_t src_addr;
+    uint16_t property_id;
+    int32_t  value;
+} bench_sensor_frame_t;
+
+// timestamp_ms (LE16), accel x/y/z (0.1 g), gyro x/y/z (10 dps)
+static const bench_vendor_frame_t bench_vendor_frames[] = {
+    { 0x0010, BENCH_VENDOR_OP_IMU_DATA, { 0x10, 0x27,  1,   0,  10,   0,  0,  0 }, 8 },
+    { 0x0011, BENCH_VENDOR_OP_IMU_DATA, { 0x7a, 0x27,  3,  -2,   9,   4, -1,  0 }, 8 },
+    { 0x0012, BENCH_VENDOR_OP_IMU_DATA, { 0xe4, 0x27, -5,  12,   7, -30, 25, 12 }, 8 },
+    { 0x0010, BENCH_VENDOR_OP_IMU_DATA, { 0x4e, 0x28,  0,   1,  10,   1,  0, -1 }, 8 },
+    { 0x0013, BENCH_VENDOR_OP_IMU_DATA, { 0xb8, 0x28, 20, -18,   2, 100, -90, 45 }, 8 },
+    { 0x0011, BENCH_VENDOR_OP_IMU_DATA, { 0x22, 0x29,  2,  -1,  10,   3,  -2,  1 }, 8 },
+};
+
+static const bench_sensor_frame_t bench_sensor_frames[] = {
+    { 0x0010, BENCH_SENSOR_PROP_HEART_RATE, 72 },
+    { 0x0011, BENCH_SENSOR_PROP_HEART_RATE, 88 },
+    { 0x0012, BENCH_SENSOR_PROP_HEART_RATE, 121 },
+    { 0x0013, BENCH_SENSOR_PROP_HEART_RATE, 64 },
+};
+
+#define BENCH_VENDOR_FRAME_COUNT (sizeof(bench_vendor_frames) / sizeof(bench_vendor_frames[0]))
+#define BENCH_SENSOR_FRAME_COUNT (sizeof(bench_sensor_frames) / sizeof(bench_sensor_frames[0]))
+
+#endif // BENCH_FRAMES_H
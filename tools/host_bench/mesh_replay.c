@@ -0,0 +1,196 @@
+/*
+ * ============================================================================
+ *              HOST REPLAY - RECORDED MESH TRAFFIC → BRIDGE
+ * ============================================================================
+ *
+ * Feeds a mesh_capture recording (components/mesh_capture) to the
+ * unmodified bridge, publishing into the stub wifi_mqtt sink. The clock is
+ * pinned to each record's receive time, so the same capture always produces
+ * the same MQTT output: the printed hash can be compared across bridge
+ * versions, and -o writes every publish for diffing.
+ *
+ * Records are replayed with their original spacing (-s 1), compressed
+ * (-s 10) or back to back (-s max, the default), which also gives a
+ * throughput figure for real traffic mixes.
+ *
+ * USAGE:
+ *   mesh_replay [-s 1|10|max] [-t esp32] [-o publishes.txt] capture.cap
+ */
+
+#include "mesh_mqtt_bridge.h"
+#include "mesh_capture_format.h"
+#include "gateway_metrics.h"
+#include "stub_wifi_mqtt.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Handlers under test (defined in mesh_mqtt_bridge.c)
+void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
+                                    uint8_t *data, uint16_t length);
+void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int32_t value);
+
+FILE *host_log_stream = NULL;
+
+// Provisioner stub: the receive time is the recorded one
+int64_t provisioner_get_rx_time_us(void)
+{
+    return host_fake_time_us;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until_ns(int64_t t)
+{
+    struct timespec ts = { .tv_sec = t / 1000000000LL, .tv_nsec = t % 1000000000LL };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-s 1|10|max] [-t prefix] [-o publishes.txt] capture.cap\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned speed = 0;             // 0 = as fast as possible
+    const char *prefix = "esp32";
+    const char *out_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:t:o:")) != -1) {
+        switch (opt) {
+        case 's':
+            speed = strcmp(optarg, "max") == 0 ? 0 : (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            prefix = optarg;
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[optind], "rb");
+    if (!in) {
+        perror(argv[optind]);
+        return 1;
+    }
+    FILE *out = NULL;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    // The file header is optional (MQTT recordings may start mid-stream)
+    mesh_capture_file_hdr_t fhdr;
+    if (fread(&fhdr, sizeof(fhdr), 1, in) != 1 || fhdr.magic != MESH_CAPTURE_MAGIC) {
+        rewind(in);
+    } else if (fhdr.version != MESH_CAPTURE_VERSION ||
+               fhdr.rec_hdr_size != sizeof(mesh_capture_rec_hdr_t)) {
+        fprintf(stderr, "unsupported capture version %u (record header %u bytes)\n",
+                fhdr.version, fhdr.rec_hdr_size);
+        return 1;
+    }
+
+    bridge_config_t bridge_config = {
+        .mqtt_topic_prefix = prefix,
+        .mesh_net_idx = 0,
+        .mesh_app_idx = 0,
+        .latency_sample_interval = 0,
+    };
+    mesh_mqtt_bridge_init(&bridge_config);
+    stub_mqtt_set_capture(true, out);
+
+    uint64_t records = 0, vendor = 0, sensor = 0, skipped = 0;
+    uint64_t handler_ns = 0;
+    int64_t first_rx_us = 0, last_rx_us = 0;
+    int64_t wall_start = now_ns();
+
+    mesh_capture_rec_hdr_t rec;
+    static uint8_t payload[UINT16_MAX];
+
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        if (fread(payload, 1, rec.len, in) != rec.len) {
+            fprintf(stderr, "truncated record at #%llu\n", (unsigned long long)records);
+            break;
+        }
+
+        if (records == 0) {
+            first_rx_us = rec.rx_us;
+        }
+        last_rx_us = rec.rx_us;
+        records++;
+
+        if (speed) {
+            sleep_until_ns(wall_start + (rec.rx_us - first_rx_us) * 1000 / speed);
+        }
+
+        // Never 0: that would fall back to the real clock
+        host_fake_time_us = rec.rx_us ? rec.rx_us : 1;
+
+        int64_t t0 = now_ns();
+        if (rec.kind == MESH_CAPTURE_VENDOR) {
+            provisioner_vendor_msg_handler(rec.src, rec.opcode, payload, rec.len);
+            vendor++;
+        } else if (rec.kind == MESH_CAPTURE_SENSOR && rec.len == sizeof(int32_t)) {
+            int32_t value;
+            memcpy(&value, payload, sizeof(value));
+            provisioner_sensor_msg_handler(rec.src, (uint16_t)rec.opcode, value);
+            sensor++;
+        } else {
+            skipped++;
+        }
+        handler_ns += (uint64_t)(now_ns() - t0);
+    }
+
+    int64_t wall_ns = now_ns() - wall_start;
+    fclose(in);
+    if (out) {
+        fclose(out);
+    }
+
+    const stub_mqtt_stats_t *st = stub_mqtt_stats();
+    uint64_t fed = vendor + sensor;
+
+    printf("records:    %llu (vendor %llu, sensor %llu, skipped %llu)\n",
+           (unsigned long long)records, (unsigned long long)vendor,
+           (unsigned long long)sensor, (unsigned long long)skipped);
+    printf("span:       %.3f s recorded, %.3f s replayed\n",
+           (last_rx_us - first_rx_us) / 1e6, wall_ns / 1e9);
+    if (fed) {
+        printf("throughput: %.0f msgs/s, %.1f ns/msg in handlers\n",
+               fed / (wall_ns / 1e9), (double)handler_ns / fed);
+    }
+    printf("published:  %llu messages, %llu topic + %llu payload bytes\n",
+           (unsigned long long)st->messages, (unsigned long long)st->topic_bytes,
+           (unsigned long long)st->payload_bytes);
+    printf("output:     fnv1a64 %016llx\n", (unsigned long long)st->hash);
+
+    char snapshot[1024];
+    if (gateway_metrics_snapshot_json(snapshot, sizeof(snapshot)) > 0) {
+        printf("metrics:    %s\n", snapshot);
+    }
+
+    return 0;
+}
@@ -0,0 +1,569 @@
+/*
+ * ============================================================================
+ *              HOST BACKEND - wifi_mqtt OVER LIBMOSQUITTO
+ * ============================================================================
+ *
+ * Implements the wifi_mqtt.h API on the host with a real broker connection,
+ * so the bridge can be soak-tested against a local mosquitto. "WiFi" is
+ * always connected; the broker URI is mqtt://host:port. Nothing is
+ * resubscribed on reconnect, so SUBSCRIBED comes with MQTT.
+ *
+ * Callbacks run on libmosquitto's network thread, like the esp-mqtt task
+ * on the device.
+ */
+
+#include "wifi_mqtt.h"
+#include "topic_trie.h"
+#include <mosquitto.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PUB_TOKEN_SLOTS 16
+
+// One per broker connection; the default one comes from wifi_mqtt_init()
+struct wifi_mqtt_client {
+    struct wifi_mqtt_client *next;
+    wifi_mqtt_client_config_t config;
+    struct mosquitto *mosq;
+    volatile bool connected;
+    pthread_mutex_t state_lock;         // With state_cond: wifi_mqtt_client_wait_ready()
+    pthread_cond_t state_cond;
+
+    // Pending wifi_mqtt_publish_async() tokens. The lock is held across
+    // mosquitto_publish(), so on_publish cannot run before the mid is stored.
+    pthread_mutex_t token_lock;
+    wifi_mqtt_pub_token_t *tokens[PUB_TOKEN_SLOTS];
+
+    // Topic handlers, same trie as the device (handlers may register handlers)
+    pthread_mutex_t topic_lock;         // Recursive
+    topic_node_t *topics;
+};
+
+static wifi_mqtt_config_t s_config;
+static wifi_mqtt_client_t *s_clients = NULL;
+static wifi_mqtt_client_t *s_default = NULL;
+static bool s_running = false;
+
+static void token_finish(wifi_mqtt_pub_token_t *token)
+{
+    token->state = WIFI_MQTT_PUB_DONE;
+    if (token->done) {
+        token->done(token);
+    }
+}
+
+static void on_connect(struct mosquitto *mosq, void *obj, int rc)
+{
+    wifi_mqtt_client_t *c = obj;
+
+    if (rc != 0) {
+        fprintf(stderr, "%s: broker refused connection: %s\n", c->config.name, mosquitto_connack_string(rc));
+        return;
+    }
+    pthread_mutex_lock(&c->state_lock);
+    c->connected = true;
+    pthread_cond_broadcast(&c->state_cond);
+    pthread_mutex_unlock(&c->state_lock);
+    if (c->config.callbacks.mqtt_connected) {
+        c->config.callbacks.mqtt_connected();
+    }
+}
+
+static void on_disconnect(struct mosquitto *mosq, void *obj, int rc)
+{
+    wifi_mqtt_client_t *c = obj;
+
+    c->connected = false;
+    if (c->config.callbacks.mqtt_disconnected) {
+        c->config.callbacks.mqtt_disconnected();
+    }
+}
+
+static void on_publish(struct mosquitto *mosq, void *obj, int mid)
+{
+    wifi_mqtt_client_t *c = obj;
+    wifi_mqtt_pub_token_t *token = NULL;
+
+    pthread_mutex_lock(&c->token_lock);
+    for (int i = 0; i < PUB_TOKEN_SLOTS; i++) {
+        if (c->tokens[i] && c->tokens[i]->msg_id == mid) {
+            token = c->tokens[i];
+            c->tokens[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->token_lock);
+    if (token) {
+        token_finish(token);
+    }
+
+    if (c->config.callbacks.message_published) {
+        c->config.callbacks.message_published(mid);
+    }
+}
+
+static void on_message(struct mosquitto *mosq, void *obj, const struct mosquitto_message *msg)
+{
+    wifi_mqtt_client_t *c = obj;
+
+    // libmosquitto hands over whole messages: one "fragment" for stream handlers
+    topic_msg_t m = {
+        .topic = msg->topic,
+        .topic_len = (int)strlen(msg->topic),
+        .data = msg->payload,
+        .data_len = msg->payloadlen,
+        .total_len = msg->payloadlen,
+    };
+
+    pthread_mutex_lock(&c->topic_lock);
+    int handled = topic_trie_dispatch(c->topics, &m, TOPIC_DISPATCH_WHOLE | TOPIC_DISPATCH_STREAM);
+    pthread_mutex_unlock(&c->topic_lock);
+
+    if (!handled && c->config.callbacks.message_received) {
+        c->config.callbacks.message_received(msg->topic, msg->payload, msg->payloadlen);
+    }
+}
+
+/**
+ * Split "mqtt://host:port" (scheme and port optional)
+ */
+static void parse_uri(const char *uri, char *host, size_t host_len, int *port)
+{
+    const char *p = strstr(uri, "://");
+    p = p ? p + 3 : uri;
+
+    const char *colon = strrchr(p, ':');
+    size_t n = colon ? (size_t)(colon - p) : strlen(p);
+    if (n >= host_len) {
+        n = host_len - 1;
+    }
+    memcpy(host, p, n);
+    host[n] = '\0';
+    *port = colon ? atoi(colon + 1) : 1883;
+}
+
+static esp_err_t client_init(wifi_mqtt_client_t *c, const wifi_mqtt_client_config_t *config)
+{
+    c->config = *config;
+    pthread_mutex_init(&c->token_lock, NULL);
+    pthread_mutex_init(&c->state_lock, NULL);
+    pthread_cond_init(&c->state_cond, NULL);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&c->topic_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    c->mosq = mosquitto_new(config->mqtt_client_id, true, c);
+    if (!c->mosq) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // No in-flight limit, like esp-mqtt's unbounded outbox
+    mosquitto_max_inflight_messages_set(c->mosq, 0);
+    mosquitto_connect_callback_set(c->mosq, on_connect);
+    mosquitto_disconnect_callback_set(c->mosq, on_disconnect);
+    mosquitto_publish_callback_set(c->mosq, on_publish);
+    mosquitto_message_callback_set(c->mosq, on_message);
+
+    wifi_mqtt_client_t **tail = &s_clients;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = c;
+    return ESP_OK;
+}
+
+static esp_err_t client_start(wifi_mqtt_client_t *c)
+{
+    char host[128];
+    int port;
+
+    parse_uri(c->config.mqtt_broker_uri, host, sizeof(host), &port);
+    if (c->config.mqtt_port) {
+        port = c->config.mqtt_port;
+    }
+    if (mosquitto_connect_async(c->mosq, host, port, 60) != MOSQ_ERR_SUCCESS) {
+        return ESP_FAIL;
+    }
+    return mosquitto_loop_start(c->mosq) == MOSQ_ERR_SUCCESS ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
+{
+    if (!config || !config->mqtt_broker_uri) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+
+    wifi_mqtt_client_config_t client_config = {
+        .name = "MQTT",
+        .mqtt_broker_uri = config->mqtt_broker_uri,
+        .mqtt_client_id = config->mqtt_client_id,
+        .mqtt_port = config->mqtt_port,
+        .callbacks = config->callbacks,
+    };
+
+    mosquitto_lib_init();
+    s_default = calloc(1, sizeof(*s_default));
+    if (!s_default) {
+        return ESP_ERR_NO_MEM;
+    }
+    return client_init(s_default, &client_config);
+}
+
+esp_err_t wifi_mqtt_client_create(const wifi_mqtt_client_config_t *config, wifi_mqtt_client_t **out)
+{
+    if (!config || !config->name || !config->mqtt_broker_uri || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    wifi_mqtt_client_t *c = calloc(1, sizeof(*c));
+    if (!c) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = client_init(c, config);   // NULL client ID: libmosquitto picks a random one
+    if (err == ESP_OK && s_running) {
+        err = client_start(c);
+    }
+    if (err == ESP_OK) {
+        *out = c;
+    }
+    return err;
+}
+
+wifi_mqtt_client_t *wifi_mqtt_default_client(void)
+{
+    return s_default;
+}
+
+esp_err_t wifi_mqtt_start(void)
+{
+    if (!s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (wifi_mqtt_client_t *c = s_clients; c; c = c->next) {
+        if (client_start(c) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    s_running = true;
+    return ESP_OK;
+}
+
+esp_err_t wifi_mqtt_stop(void)
+{
+    if (!s_default || !s_default->mosq) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_running = false;
+    for (wifi_mqtt_client_t *c = s_clients; c; c = c->next) {
+        mosquitto_disconnect(c->mosq);
+        mosquitto_loop_stop(c->mosq, false);
+        mosquitto_destroy(c->mosq);
+        c->mosq = NULL;
+        c->connected = false;
+    }
+    mosquitto_lib_cleanup();
+    return ESP_OK;
+}
+
+bool wifi_mqtt_is_wifi_connected(void)
+{
+    return true;
+}
+
+bool wifi_mqtt_client_is_connected(wifi_mqtt_client_t *client)
+{
+    return client && client->connected;
+}
+
+bool wifi_mqtt_is_mqtt_connected(void)
+{
+    return wifi_mqtt_client_is_connected(s_default);
+}
+
+uint32_t wifi_mqtt_client_get_state(wifi_mqtt_client_t *client)
+{
+    if (!client) {
+        return 0;
+    }
+    return WIFI_MQTT_STATE_WIFI | WIFI_MQTT_STATE_IP |
+           (client->connected ? WIFI_MQTT_STATE_MQTT | WIFI_MQTT_STATE_SUBSCRIBED : 0);
+}
+
+uint32_t wifi_mqtt_get_state(void)
+{
+    return wifi_mqtt_client_get_state(s_default);
+}
+
+esp_err_t wifi_mqtt_client_wait_ready(wifi_mqtt_client_t *client, uint32_t timeout_ms)
+{
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&client->state_lock);
+    int rc = 0;
+    while (!client->connected && rc == 0 && timeout_ms > 0) {
+        rc = timeout_ms == WIFI_MQTT_WAIT_FOREVER
+             ? pthread_cond_wait(&client->state_cond, &client->state_lock)
+             : pthread_cond_timedwait(&client->state_cond, &client->state_lock, &deadline);
+    }
+    bool ready = client->connected;
+    pthread_mutex_unlock(&client->state_lock);
+    return ready ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t wifi_mqtt_wait_ready(uint32_t timeout_ms)
+{
+    if (!s_default) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return wifi_mqtt_client_wait_ready(s_default, timeout_ms);
+}
+
+int wifi_mqtt_client_publish(wifi_mqtt_client_t *client, const char *topic,
+                             const void *data, int len, int qos)
+{
+    int mid = 0;
+
+    if (!client || !client->mosq || !client->connected) {
+        return -1;
+    }
+    if (len == 0 && data) {
+        len = (int)strlen(data);    // As esp-mqtt
+    }
+    if (mosquitto_publish(client->mosq, &mid, topic, len, data, qos, false) != MOSQ_ERR_SUCCESS) {
+        return -1;
+    }
+    // libmosquitto has no write callback; its network thread is woken now
+    // and has no outbox to drain first, so this is close to the write
+    if (qos > 0 && client->config.callbacks.message_sent) {
+        client->config.callbacks.message_sent(mid);
+    }
+    return qos == 0 ? 0 : mid;     // esp-mqtt returns 0 for QoS 0
+}
+
+int wifi_mqtt_publish_binary(const char *topic, const void *data, int len, int qos)
+{
+    return wifi_mqtt_client_publish(s_default, topic, data, len, qos);
+}
+
+int wifi_mqtt_publish(const char *topic, const char *data, int qos)
+{
+    return wifi_mqtt_client_publish(s_default, topic, data, (int)strlen(data), qos);
+}
+
+/** mosquitto_publish() already only queues for the network thread */
+int wifi_mqtt_client_publish_async(wifi_mqtt_client_t *client, const char *topic,
+                                   const void *data, int len, int qos,
+                                   wifi_mqtt_pub_token_t *token)
+{
+    int slot = -1;
+    int msg_id;
+
+    if (!client || len < 0) {
+        return -1;
+    }
+    if (!token || qos == 0) {
+        msg_id = wifi_mqtt_client_publish(client, topic, len ? data : "", len, qos);
+        if (token && msg_id >= 0) {
+            token->msg_id = msg_id;
+            token_finish(token);
+        }
+        return msg_id;
+    }
+
+    token->state = WIFI_MQTT_PUB_PENDING;
+    pthread_mutex_lock(&client->token_lock);
+    for (int i = 0; i < PUB_TOKEN_SLOTS && slot < 0; i++) {
+        if (!client->tokens[i]) {
+            slot = i;
+        }
+    }
+    msg_id = slot < 0 ? -1 : wifi_mqtt_client_publish(client, topic, len ? data : "", len, qos);
+    if (msg_id > 0) {
+        token->msg_id = msg_id;
+        client->tokens[slot] = token;
+    }
+    pthread_mutex_unlock(&client->token_lock);
+    return msg_id;
+}
+
+int wifi_mqtt_publish_async(const char *topic, const void *data, int len, int qos,
+                            wifi_mqtt_pub_token_t *token)
+{
+    return wifi_mqtt_client_publish_async(s_default, topic, data, len, qos, token);
+}
+
+int wifi_mqtt_client_subscribe(wifi_mqtt_client_t *client, const char *topic, int qos)
+{
+    int mid = 0;
+    if (!client || !client->mosq || mosquitto_subscribe(client->mosq, &mid, topic, qos) != MOSQ_ERR_SUCCESS) {
+        return -1;
+    }
+    return mid;
+}
+
+int wifi_mqtt_subscribe(const char *topic, int qos)
+{
+    return wifi_mqtt_client_subscribe(s_default, topic, qos);
+}
+
+int wifi_mqtt_client_unsubscribe(wifi_mqtt_client_t *client, const char *topic)
+{
+    int mid = 0;
+    if (!client || !client->mosq || mosquitto_unsubscribe(client->mosq, &mid, topic) != MOSQ_ERR_SUCCESS) {
+        return -1;
+    }
+    return mid;
+}
+
+int wifi_mqtt_unsubscribe(const char *topic)
+{
+    return wifi_mqtt_client_unsubscribe(s_default, topic);
+}
+
+static int add_handler(wifi_mqtt_client_t *c, const char *filter, int qos,
+                       wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream, void *ctx)
+{
+    int sub_qos;
+
+    if (!c) {
+        return -1;
+    }
+    pthread_mutex_lock(&c->topic_lock);
+    esp_err_t err = topic_trie_add(&c->topics, filter, qos, cb, stream, ctx, &sub_qos);
+    pthread_mutex_unlock(&c->topic_lock);
+
+    if (err != ESP_OK) {
+        return -1;
+    }
+    if (!c->connected) {
+        return 0;
+    }
+    int msg_id = wifi_mqtt_client_subscribe(c, filter, sub_qos);
+    return msg_id < 0 ? 0 : msg_id;
+}
+
+static int remove_handler(wifi_mqtt_client_t *c, const char *filter,
+                          wifi_mqtt_topic_cb_t cb, wifi_mqtt_stream_cb_t stream, void *ctx)
+{
+    int sub_qos = -1;
+
+    if (!c) {
+        return -1;
+    }
+    pthread_mutex_lock(&c->topic_lock);
+    esp_err_t err = topic_trie_remove(c->topics, filter, cb, stream, ctx, &sub_qos);
+    pthread_mutex_unlock(&c->topic_lock);
+
+    if (err != ESP_OK) {
+        return -1;
+    }
+    if (sub_qos >= 0 || !c->connected) {
+        return 0;
+    }
+    int msg_id = wifi_mqtt_client_unsubscribe(c, filter);
+    return msg_id < 0 ? 0 : msg_id;
+}
+
+int wifi_mqtt_client_subscribe_handler(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                       wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return cb ? add_handler(client, filter, qos, cb, NULL, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_handler(wifi_mqtt_client_t *client, const char *filter,
+                                         wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return cb ? remove_handler(client, filter, cb, NULL, ctx) : -1;
+}
+
+int wifi_mqtt_client_subscribe_stream(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                      wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return cb ? add_handler(client, filter, qos, NULL, cb, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_stream(wifi_mqtt_client_t *client, const char *filter,
+                                        wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return cb ? remove_handler(client, filter, NULL, cb, ctx) : -1;
+}
+
+int wifi_mqtt_subscribe_handler(const char *filter, int qos, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_subscribe_handler(s_default, filter, qos, cb, ctx);
+}
+
+int wifi_mqtt_unsubscribe_handler(const char *filter, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_unsubscribe_handler(s_default, filter, cb, ctx);
+}
+
+int wifi_mqtt_subscribe_stream(const char *filter, int qos, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_subscribe_stream(s_default, filter, qos, cb, ctx);
+}
+
+int wifi_mqtt_unsubscribe_stream(const char *filter, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return wifi_mqtt_client_unsubscribe_stream(s_default, filter, cb, ctx);
+}
+
+esp_err_t wifi_mqtt_get_ip_address(char *ip_str, size_t len)
+{
+    if (!ip_str || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(ip_str, len, "127.0.0.1");
+    return ESP_OK;
+}
+
+int8_t wifi_mqtt_get_rssi(void)
+{
+    return 0;
+}
+
+int wifi_mqtt_client_get_outbox_size(wifi_mqtt_client_t *client)
+{
+    return 0;      // libmosquitto does not expose its queue size
+}
+
+int wifi_mqtt_get_outbox_size(void)
+{
+    return 0;
+}
+
+void wifi_mqtt_client_get_stats(wifi_mqtt_client_t *client, wifi_mqtt_stats_t *stats)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void wifi_mqtt_get_stats(wifi_mqtt_stats_t *stats)
+{
+    wifi_mqtt_client_get_stats(s_default, stats);
+}
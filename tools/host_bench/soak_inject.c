@@ -0,0 +1,186 @@
+/*
+ * ============================================================================
+ *              HOST SOAK TEST - SYNTHETIC MESH TRAFFIC → BROKER
+ * ============================================================================
+ *
+ * Host equivalent of the mesh_traffic_injector component: the same
+ * traffic_gen frames are fed to the unmodified bridge, which publishes to a
+ * real broker through mosquitto_wifi_mqtt.c. Run soak_monitor.py against
+ * the same broker to measure received rate and loss.
+ *
+ * USAGE:
+ *   soak_inject [-b mqtt://localhost:1883] [-t esp32] [-n nodes] [-r hz]
+ *               [-j jitter%] [-H hr_every] [-P still|wave|random] [-d seconds]
+ */
+
+#include "mesh_mqtt_bridge.h"
+#include "gateway_metrics.h"
+#include "traffic_gen.h"
+#include "wifi_mqtt.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+// Handlers under test (defined in mesh_mqtt_bridge.c)
+void provisioner_vendor_msg_handler(uint16_t src_addr, uint32_t opcode,
+                                    uint8_t *data, uint16_t length);
+void provisioner_sensor_msg_handler(uint16_t src_addr, uint16_t property_id, int32_t value);
+
+FILE *host_log_stream = NULL;
+
+// Provisioner stubs: the receive timestamp is set per injected frame
+static int64_t s_rx_time_us;
+
+int64_t provisioner_get_rx_time_us(void)
+{
+    return s_rx_time_us;
+}
+
+void provisioner_set_rx_time_us(int64_t rx_time_us)
+{
+    s_rx_time_us = rx_time_us;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until_ns(int64_t t)
+{
+    struct timespec ts = { .tv_sec = t / 1000000000LL, .tv_nsec = t % 1000000000LL };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static traffic_pattern_t parse_pattern(const char *s)
+{
+    if (strcasecmp(s, "still") == 0) {
+        return TRAFFIC_PATTERN_STILL;
+    }
+    if (strcasecmp(s, "random") == 0) {
+        return TRAFFIC_PATTERN_RANDOM;
+    }
+    return TRAFFIC_PATTERN_WAVE;
+}
+
+int main(int argc, char **argv)
+{
+    const char *broker = "mqtt://localhost:1883";
+    const char *prefix = "esp32";
+    uint32_t duration_s = 60;
+    traffic_gen_config_t traffic = {
+        .node_count = 100,
+        .rate_hz = 10,
+        .jitter_pct = 20,
+        .hr_every = 10,
+        .pattern = TRAFFIC_PATTERN_WAVE,
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:t:n:r:j:H:P:d:")) != -1) {
+        switch (opt) {
+        case 'b': broker = optarg; break;
+        case 't': prefix = optarg; break;
+        case 'n': traffic.node_count = (uint16_t)atoi(optarg); break;
+        case 'r': traffic.rate_hz = (uint16_t)atoi(optarg); break;
+        case 'j': traffic.jitter_pct = (uint8_t)atoi(optarg); break;
+        case 'H': traffic.hr_every = (uint8_t)atoi(optarg); break;
+        case 'P': traffic.pattern = parse_pattern(optarg); break;
+        case 'd': duration_s = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-b uri] [-t prefix] [-n nodes] [-r hz] [-j jitter%%] "
+                            "[-H hr_every] [-P still|wave|random] [-d seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    wifi_mqtt_config_t mqtt_config = {
+        .mqtt_broker_uri = broker,
+        .mqtt_client_id = "soak_inject",
+        .callbacks.message_sent = mesh_mqtt_bridge_on_sent,
+        .callbacks.message_published = mesh_mqtt_bridge_on_published,
+    };
+    if (wifi_mqtt_init(&mqtt_config) != ESP_OK || wifi_mqtt_start() != ESP_OK) {
+        fprintf(stderr, "cannot connect to %s\n", broker);
+        return 1;
+    }
+    if (wifi_mqtt_wait_ready(5000) != ESP_OK) {
+        fprintf(stderr, "no CONNACK from %s\n", broker);
+        return 1;
+    }
+
+    bridge_config_t bridge_config = {
+        .mqtt_topic_prefix = prefix,
+        .latency_sample_interval = 10,
+    };
+    mesh_mqtt_bridge_init(&bridge_config);
+
+    gateway_metric_t *pub_fail = gateway_metrics_counter("bridge.pub_fail");
+
+    traffic_gen_t gen;
+    traffic_frame_t frame;
+    traffic_gen_init(&gen, &traffic);
+
+    printf("soak_inject: %u nodes x %u Hz = %u frames/s for %u s -> %s (%s/#)\n",
+           gen.config.node_count, gen.config.rate_hz, traffic_gen_total_rate(&gen),
+           duration_s, broker, prefix);
+    printf("%6s %10s %10s %10s\n", "t [s]", "frames/s", "pub_fail", "lag [ms]");
+
+    int64_t start = now_ns();
+    int64_t end = start + (int64_t)duration_s * 1000000000LL;
+    int64_t due = start;
+    int64_t next_report = start + 1000000000LL;
+    uint64_t sent = 0;
+    uint64_t sent_at_report = 0;
+
+    while (due < end) {
+        int64_t now = now_ns();
+        if (due > now) {
+            sleep_until_ns(due);
+            now = due;
+        }
+
+        due += traffic_gen_next(&gen, &frame);
+        provisioner_set_rx_time_us(esp_timer_get_time());
+        if (frame.kind == TRAFFIC_FRAME_VENDOR) {
+            provisioner_vendor_msg_handler(frame.src_addr, frame.opcode, frame.data, frame.length);
+        } else {
+            provisioner_sensor_msg_handler(frame.src_addr, frame.property_id, frame.value);
+        }
+        sent++;
+
+        if (now >= next_report) {
+            printf("%6lld %10llu %10u %10lld\n",
+                   (long long)((now - start) / 1000000000LL),
+                   (unsigned long long)(sent - sent_at_report),
+                   gateway_metrics_counter_get(pub_fail),
+                   (long long)(now > due ? (now - due) / 1000000 : 0));
+            sent_at_report = sent;
+            next_report += 1000000000LL;
+        }
+    }
+
+    double elapsed_s = (now_ns() - start) / 1e9;
+    printf("\nsent %llu frames in %.1f s: %.0f frames/s sustained, %u publish failures\n",
+           (unsigned long long)sent, elapsed_s, sent / elapsed_s,
+           gateway_metrics_counter_get(pub_fail));
+
+    sleep(2);   // Let the network thread flush and collect sampled PUBACKs
+
+    char report[8192];
+    const char *name = NULL;
+    for (unsigned i = 0; i < gateway_metrics_report_count(); i++) {
+        if (gateway_metrics_report_json(i, &name, report, sizeof(report)) > 0) {
+            printf("%s: %s\n", name, report);
+        }
+    }
+
+    wifi_mqtt_stop();
+    return 0;
+}
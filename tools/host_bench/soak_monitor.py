@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Soak-test monitor: measures received rate and loss of injected mesh traffic.
+
+Subscribes to <prefix>/imu/+ and <prefix>/heartrate/+ and checks the
+per-node IMU sequence numbers that traffic_gen puts in the "time" field
+(16-bit, consecutive per node). On a fair or poor link the bridge sends
+batches, JSON arrays of records, on <prefix>/<type>/batch; every element
+is counted like a record on its own. Works for both the on-device injector
+(CONFIG_MESH_INJECTOR_ENABLE) and the host soak_inject tool.
+
+    pip install paho-mqtt
+    ./soak_monitor.py --broker localhost --prefix esp32 --duration 60
+"""
+
+import argparse
+import json
+import sys
+import time
+
+import paho.mqtt.client as mqtt
+
+SEQ_MOD = 1 << 16
+
+
+class NodeStats:
+    __slots__ = ("last_seq", "received", "lost", "reordered")
+
+    def __init__(self):
+        self.last_seq = None
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+
+    def update(self, seq):
+        self.received += 1
+        if self.last_seq is not None:
+            gap = (seq - self.last_seq) % SEQ_MOD
+            if gap == 0 or gap > SEQ_MOD // 2:
+                self.reordered += 1     # Duplicate or late (counted as loss before)
+                self.lost = max(0, self.lost - 1)
+                return
+            self.lost += gap - 1
+        self.last_seq = seq
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--broker", default="localhost")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--prefix", default="esp32")
+    parser.add_argument("--duration", type=float, default=0,
+                        help="seconds to run (0 = until Ctrl-C)")
+    args = parser.parse_args()
+
+    nodes = {}
+    counts = {"imu": 0, "hr": 0, "bad": 0}
+
+    def on_connect(client, userdata, flags, rc, *extra):
+        client.subscribe(f"{args.prefix}/imu/+", qos=0)
+        client.subscribe(f"{args.prefix}/heartrate/+", qos=0)
+
+    def on_message(client, userdata, msg):
+        kind = msg.topic.split("/")[-2]
+        try:
+            payload = json.loads(msg.payload)
+        except ValueError:
+            counts["bad"] += 1
+            return
+        records = payload if isinstance(payload, list) else [payload]
+        if kind == "heartrate":
+            counts["hr"] += len(records)
+            return
+        for record in records:
+            try:
+                seq = int(record["time"])
+                node = record["node"]
+            except (ValueError, KeyError, TypeError):
+                counts["bad"] += 1
+                continue
+            counts["imu"] += 1
+            nodes.setdefault(node, NodeStats()).update(seq)
+
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1, client_id="soak_monitor")
+    else:
+        client = mqtt.Client(client_id="soak_monitor")
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port, keepalive=60)
+    client.loop_start()
+
+    print(f"{'t [s]':>6} {'msgs/s':>10} {'nodes':>6} {'lost':>8} {'loss %':>8}")
+    start = time.monotonic()
+    last_total = 0
+    try:
+        while args.duration == 0 or time.monotonic() - start < args.duration:
+            time.sleep(1)
+            total = counts["imu"] + counts["hr"]
+            lost = sum(n.lost for n in nodes.values())
+            expected = counts["imu"] + lost
+            print(f"{time.monotonic() - start:6.0f} {total - last_total:10d} {len(nodes):6d} "
+                  f"{lost:8d} {100.0 * lost / expected if expected else 0:8.3f}")
+            last_total = total
+    except KeyboardInterrupt:
+        pass
+
+    client.loop_stop()
+    elapsed = time.monotonic() - start
+    lost = sum(n.lost for n in nodes.values())
+    expected = counts["imu"] + lost
+    print()
+    print(f"received {counts['imu']} IMU + {counts['hr']} HR in {elapsed:.1f} s "
+          f"({(counts['imu'] + counts['hr']) / elapsed:.0f} msgs/s sustained)")
+    print(f"IMU loss: {lost} / {expected} ({100.0 * lost / expected if expected else 0:.3f} %), "
+          f"reordered {sum(n.reordered for n in nodes.values())}, unparseable {counts['bad']}")
+    worst = sorted(nodes.items(), key=lambda kv: kv[1].lost, reverse=True)[:5]
+    if worst and worst[0][1].lost:
+        print("worst nodes: " + ", ".join(f"{addr}={s.lost}" for addr, s in worst if s.lost))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,299 @@
+/*
+ * ============================================================================
+ *                  HOST STUB - wifi_mqtt PUBLISH SINK
+ * ============================================================================
+ *
+ * Implements the wifi_mqtt.h API on the host without WiFi or a broker.
+ * Publishes are counted (messages, topic bytes, payload bytes), hashed
+ * and dropped, so the benchmark measures only the bridge's own work.
+ */
+
+#include "wifi_mqtt.h"
+#include "stub_wifi_mqtt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET  0xcbf29ce484222325ULL
+#define FNV_PRIME   0x100000001b3ULL
+
+static stub_mqtt_stats_t s_stats = { .hash = FNV_OFFSET };
+static int s_next_msg_id = 1;
+static bool s_hash = false;
+static FILE *s_capture = NULL;
+static int8_t s_rssi = -50;
+
+// All clients publish into the same sink
+struct wifi_mqtt_client {
+    const char *name;
+};
+static wifi_mqtt_client_t s_default = { .name = "MQTT" };
+
+void stub_mqtt_reset(void)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.hash = FNV_OFFSET;
+}
+
+void stub_mqtt_set_capture(bool hash, FILE *out)
+{
+    s_hash = hash;
+    s_capture = out;
+}
+
+void stub_mqtt_set_rssi(int8_t dbm)
+{
+    s_rssi = dbm;
+}
+
+static void hash_bytes(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        s_stats.hash = (s_stats.hash ^ p[i]) * FNV_PRIME;
+    }
+}
+
+const stub_mqtt_stats_t *stub_mqtt_stats(void)
+{
+    return &s_stats;
+}
+
+static int sink_publish(const char *topic, const void *data, int len, int qos)
+{
+    size_t topic_len = strlen(topic);
+
+    s_stats.messages++;
+    s_stats.topic_bytes += topic_len;
+    s_stats.payload_bytes += (uint64_t)len;
+
+    if (s_hash) {
+        hash_bytes(topic, topic_len + 1);       // Include the terminator as separator
+        hash_bytes(data, (size_t)len);
+    }
+    if (s_capture) {
+        fprintf(s_capture, "%s %.*s\n", topic, len, (const char *)data);
+    }
+
+    if (qos == 0) {
+        return 0;
+    }
+    return s_next_msg_id++;
+}
+
+esp_err_t wifi_mqtt_init(const wifi_mqtt_config_t *config)
+{
+    return config ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t wifi_mqtt_client_create(const wifi_mqtt_client_config_t *config, wifi_mqtt_client_t **out)
+{
+    if (!config || !config->name || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = calloc(1, sizeof(**out));
+    if (!*out) {
+        return ESP_ERR_NO_MEM;
+    }
+    (*out)->name = config->name;
+    return ESP_OK;
+}
+
+wifi_mqtt_client_t *wifi_mqtt_default_client(void)
+{
+    return &s_default;
+}
+
+esp_err_t wifi_mqtt_start(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t wifi_mqtt_stop(void)
+{
+    return ESP_OK;
+}
+
+bool wifi_mqtt_is_wifi_connected(void)
+{
+    return true;
+}
+
+bool wifi_mqtt_is_mqtt_connected(void)
+{
+    return true;
+}
+
+bool wifi_mqtt_client_is_connected(wifi_mqtt_client_t *client)
+{
+    return client != NULL;
+}
+
+uint32_t wifi_mqtt_client_get_state(wifi_mqtt_client_t *client)
+{
+    return client ? WIFI_MQTT_STATE_READY : 0;
+}
+
+uint32_t wifi_mqtt_get_state(void)
+{
+    return WIFI_MQTT_STATE_READY;
+}
+
+esp_err_t wifi_mqtt_client_wait_ready(wifi_mqtt_client_t *client, uint32_t timeout_ms)
+{
+    return client ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t wifi_mqtt_wait_ready(uint32_t timeout_ms)
+{
+    return ESP_OK;
+}
+
+int wifi_mqtt_client_publish(wifi_mqtt_client_t *client, const char *topic,
+                             const void *data, int len, int qos)
+{
+    if (!client || !topic || !data) {
+        return -1;
+    }
+    return sink_publish(topic, data, len ? len : (int)strlen(data), qos);
+}
+
+int wifi_mqtt_publish(const char *topic, const char *data, int qos)
+{
+    if (!topic || !data) {
+        return -1;
+    }
+    return sink_publish(topic, data, (int)strlen(data), qos);
+}
+
+int wifi_mqtt_publish_binary(const char *topic, const void *data, int len, int qos)
+{
+    if (!topic || !data) {
+        return -1;
+    }
+    return sink_publish(topic, data, len, qos);
+}
+
+/** Nothing is queued: the outcome is known at once */
+int wifi_mqtt_client_publish_async(wifi_mqtt_client_t *client, const char *topic,
+                                   const void *data, int len, int qos,
+                                   wifi_mqtt_pub_token_t *token)
+{
+    if (!client || !topic || len < 0 || (len > 0 && !data)) {
+        return -1;
+    }
+    int msg_id = sink_publish(topic, data, len, qos);
+    if (token) {
+        token->msg_id = msg_id;
+        token->state = WIFI_MQTT_PUB_DONE;
+        if (token->done) {
+            token->done(token);
+        }
+    }
+    return msg_id;
+}
+
+int wifi_mqtt_publish_async(const char *topic, const void *data, int len, int qos,
+                            wifi_mqtt_pub_token_t *token)
+{
+    return wifi_mqtt_client_publish_async(&s_default, topic, data, len, qos, token);
+}
+
+int wifi_mqtt_subscribe(const char *topic, int qos)
+{
+    return topic ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_unsubscribe(const char *topic)
+{
+    return topic ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_subscribe_handler(const char *filter, int qos, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return filter && cb ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_unsubscribe_handler(const char *filter, wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return filter && cb ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_subscribe_stream(const char *filter, int qos, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return filter && cb ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_unsubscribe_stream(const char *filter, wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return filter && cb ? s_next_msg_id++ : -1;
+}
+
+int wifi_mqtt_client_subscribe(wifi_mqtt_client_t *client, const char *topic, int qos)
+{
+    return client ? wifi_mqtt_subscribe(topic, qos) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe(wifi_mqtt_client_t *client, const char *topic)
+{
+    return client ? wifi_mqtt_unsubscribe(topic) : -1;
+}
+
+int wifi_mqtt_client_subscribe_handler(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                       wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return client ? wifi_mqtt_subscribe_handler(filter, qos, cb, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_handler(wifi_mqtt_client_t *client, const char *filter,
+                                         wifi_mqtt_topic_cb_t cb, void *ctx)
+{
+    return client ? wifi_mqtt_unsubscribe_handler(filter, cb, ctx) : -1;
+}
+
+int wifi_mqtt_client_subscribe_stream(wifi_mqtt_client_t *client, const char *filter, int qos,
+                                      wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return client ? wifi_mqtt_subscribe_stream(filter, qos, cb, ctx) : -1;
+}
+
+int wifi_mqtt_client_unsubscribe_stream(wifi_mqtt_client_t *client, const char *filter,
+                                        wifi_mqtt_stream_cb_t cb, void *ctx)
+{
+    return client ? wifi_mqtt_unsubscribe_stream(filter, cb, ctx) : -1;
+}
+
+esp_err_t wifi_mqtt_get_ip_address(char *ip_str, size_t len)
+{
+    snprintf(ip_str, len, "127.0.0.1");
+    return ESP_OK;
+}
+
+int8_t wifi_mqtt_get_rssi(void)
+{
+    return s_rssi;
+}
+
+int wifi_mqtt_get_outbox_size(void)
+{
+    return 0;
+}
+
+int wifi_mqtt_client_get_outbox_size(wifi_mqtt_client_t *client)
+{
+    return 0;
+}
+
+void wifi_mqtt_client_get_stats(wifi_mqtt_client_t *client, wifi_mqtt_stats_t *stats)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void wifi_mqtt_get_stats(wifi_mqtt_stats_t *stats)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
@@ -0,0 +1,35 @@
+/*
+ * Host stub - wifi_mqtt publish sink statistics
+ */
+
+#ifndef STUB_WIFI_MQTT_H
+#define STUB_WIFI_MQTT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    uint64_t messages;       /*!< Publish calls accepted */
+    uint64_t topic_bytes;    /*!< Sum of topic lengths */
+    uint64_t payload_bytes;  /*!< Sum of payload lengths */
+    uint64_t hash;           /*!< FNV-1a over topics and payloads (if enabled) */
+} stub_mqtt_stats_t;
+
+void stub_mqtt_reset(void);
+const stub_mqtt_stats_t *stub_mqtt_stats(void);
+
+/**
+ * Keep the content of publishes (off by default so benchmarks only count)
+ *
+ * @param hash Fold every topic and payload into stats.hash
+ * @param out  Also write every publish as "<topic> <payload>\n" (NULL = no)
+ */
+void stub_mqtt_set_capture(bool hash, FILE *out);
+
+/**
+ * RSSI reported by wifi_mqtt_get_rssi() (default -50 dBm, a good link)
+ */
+void stub_mqtt_set_rssi(int8_t dbm);
+
+#endif // STUB_WIFI_MQTT_H
@@ -0,0 +1,28 @@
+/*
+ * Host stub for esp_log.h
+ *
+ * Log output goes to host_log_stream (NULL = discarded). The formatting
+ * cost is still paid when a stream is set, so the benchmark can measure
+ * what the ESP_LOGx calls on the hot path actually cost.
+ */
+
+#ifndef HOST_STUB_ESP_LOG_H
+#define HOST_STUB_ESP_LOG_H
+
+#include <stdio.h>
+
+extern FILE *host_log_stream;
+
+#define HOST_LOG(level, tag, format, ...) do {                                  \
+        if (host_log_stream) {                                                  \
+            fprintf(host_log_stream, level " (%s): " format "\n", tag, ##__VA_ARGS__); \
+        }                                                                       \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG("D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG("V", tag, format, ##__VA_ARGS__)
+
+#endif // HOST_STUB_ESP_LOG_H
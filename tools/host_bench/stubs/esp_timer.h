@@ -0,0 +1,26 @@
+/*
+ * Host stub for esp_timer.h (monotonic clock only)
+ *
+ * Replay tools can pin the clock by setting host_fake_time_us (non-zero),
+ * so timestamps in bridge output are reproducible.
+ */
+
+#ifndef HOST_STUB_ESP_TIMER_H
+#define HOST_STUB_ESP_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+__attribute__((weak)) int64_t host_fake_time_us = 0;
+
+static inline int64_t esp_timer_get_time(void)
+{
+    if (host_fake_time_us) {
+        return host_fake_time_us;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif // HOST_STUB_ESP_TIMER_H
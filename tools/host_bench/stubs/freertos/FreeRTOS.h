@@ -0,0 +1,22 @@
+/*
+ * Host stub for freertos/FreeRTOS.h
+ *
+ * Only the types and macros used by the components compiled into the
+ * host harness. One tick is one millisecond.
+ */
+
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+#endif // HOST_STUB_FREERTOS_H
@@ -0,0 +1,33 @@
+/*
+ * Host stub for freertos/semphr.h (mutexes only, on pthreads)
+ */
+
+#ifndef HOST_STUB_SEMPHR_H
+#define HOST_STUB_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = malloc(sizeof(*m));
+    if (m) {
+        pthread_mutex_init(m, NULL);
+    }
+    return m;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t wait)
+{
+    return (wait ? pthread_mutex_lock(m) : pthread_mutex_trylock(m)) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    return pthread_mutex_unlock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+#endif // HOST_STUB_SEMPHR_H
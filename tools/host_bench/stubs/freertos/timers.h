@@ -0,0 +1,52 @@
+/*
+ * Host stub for freertos/timers.h
+ *
+ * Timers are created but never fire: the harness is single threaded and
+ * driven by its own loop. Code under test must not depend on them for
+ * anything but deadlines (the bridge batches also flush on later
+ * publishes).
+ */
+
+#ifndef HOST_STUB_TIMERS_H
+#define HOST_STUB_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_timer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+struct host_timer {
+    TimerCallbackFunction_t cb;
+    void *id;
+};
+
+static inline TimerHandle_t xTimerCreate(const char *name, TickType_t period, BaseType_t reload,
+                                         void *id, TimerCallbackFunction_t cb)
+{
+    static struct host_timer timers[8];
+    static unsigned used;
+
+    if (used >= sizeof(timers) / sizeof(timers[0])) {
+        return NULL;
+    }
+    timers[used].cb = cb;
+    timers[used].id = id;
+    return &timers[used++];
+}
+
+static inline BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t period, TickType_t wait)
+{
+    return pdPASS;
+}
+
+static inline BaseType_t xTimerStop(TimerHandle_t t, TickType_t wait)
+{
+    return pdPASS;
+}
+
+static inline void *pvTimerGetTimerID(TimerHandle_t t)
+{
+    return t->id;
+}
+
+#endif // HOST_STUB_TIMERS_H
@@ -0,0 +1,508 @@
+/*
+ * ============================================================================
+ *              wifi_mqtt THROUGHPUT BENCHMARK (ESP-IDF LINUX TARGET)
+ * ============================================================================
+ *
+ * Runs the real wifi_mqtt component and esp-mqtt on the host against a
+ * local broker. For every (payload size, QoS, rate) combination it
+ * publishes with wifi_mqtt_publish() to a topic it is also subscribed to:
+ *
+ *   bench ──wifi_mqtt_publish()──→ broker ──→ message_received (same client)
+ *     │                              │
+ *     └── call time                  └── PUBACK (QoS 1): ack latency
+ *
+ * and reports:
+ *   pub/s      accepted publish calls per second
+ *   recv/s     messages received back per second
+ *   lost       published but never received
+ *   call       time spent inside wifi_mqtt_publish() (p50/p99)
+ *   e2e        publish → received back through the broker (p50/p99)
+ *   ack        publish → PUBACK, QoS 1 only (p50/p99)
+ *   unmatched  PUBACKs never matched to a publish (not in ack)
+ *   outbox     peak wifi_mqtt_get_outbox_size() in bytes
+ *
+ * Each payload carries its sequence number and send time in ASCII, so the
+ * string API (strlen) is exercised exactly as the bridge uses it.
+ *
+ * CONFIGURATION (environment):
+ *   MQTT_BENCH_BROKER    broker URI          (mqtt://localhost:1883)
+ *   MQTT_BENCH_SIZES     payload bytes       (32,128,512,1024,4096)
+ *   MQTT_BENCH_QOS       QoS levels          (0,1)
+ *   MQTT_BENCH_RATES     msgs/s, 0 = max     (100,1000,0)
+ *   MQTT_BENCH_MESSAGES  messages per run    (2000)
+ *   MQTT_BENCH_ASYNC     1 = publish with wifi_mqtt_publish_async() (0)
+ *   MQTT_BENCH_CA        PEM CA file for an mqtts:// broker
+ *   MQTT_BENCH_TLS_RESUME  0 = no TLS session resumption (1)
+ *   MQTT_BENCH_RECONNECTS  N > 0: time N reconnects instead of the sweep
+ */
+
+#include "wifi_mqtt.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TAG "MQTT_BENCH"
+
+#define MAX_MESSAGES        20000
+#define MAX_SWEEP           8
+#define HEADER_LEN          26          // "%08x %016llx " = seq + send time
+#define MAX_PAYLOAD         (64 * 1024)
+#define DRAIN_TIMEOUT_US    5000000
+#define DRAIN_IDLE_US       500000      // QoS 0: stop waiting after this long without input
+#define OUTBOX_SAMPLE_EVERY 8
+#define MAX_RECONNECTS      1000
+#define CONNECT_TIMEOUT_MS  5000
+#define MAX_CA_CERT         (16 * 1024)
+
+typedef struct {
+    unsigned size;
+    int qos;
+    unsigned rate;
+    unsigned messages;
+} bench_run_t;
+
+// Per-run state; latencies are stored +1 so 0 means "not seen"
+static char s_topic[64];
+static uint32_t s_e2e_us[MAX_MESSAGES];
+static uint32_t s_ack_us[MAX_MESSAGES];
+static uint32_t s_call_us[MAX_MESSAGES];
+static int64_t s_ack_sent_us[65536];        // Indexed by msg_id (16-bit), under s_ack_lock
+static int64_t s_ack_early_us[65536];       // PUBACKs that beat their send time, under s_ack_lock
+static SemaphoreHandle_t s_ack_lock;
+static volatile unsigned s_received;
+static unsigned s_acked;                    // Under s_ack_lock
+static volatile int64_t s_last_rx_us;
+static char s_payload[MAX_PAYLOAD + 1];
+static bool s_async;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * ============================================================================
+ *                               CALLBACKS
+ * ============================================================================
+ * Called from the esp-mqtt task.
+ */
+
+static void on_message(const char *topic, const char *data, int data_len)
+{
+    // wifi_mqtt hands over fragmented payloads reassembled (up to
+    // rx_reassembly_max), so the header is always at the start
+    if (strcmp(topic, s_topic) != 0 || data_len < HEADER_LEN) {
+        return;
+    }
+
+    char header[HEADER_LEN + 1];
+    memcpy(header, data, HEADER_LEN);
+    header[HEADER_LEN] = '\0';
+
+    unsigned seq;
+    unsigned long long sent_us;
+    if (sscanf(header, "%8x %16llx", &seq, &sent_us) != 2 || seq >= MAX_MESSAGES) {
+        return;
+    }
+
+    int64_t now = now_us();
+    if (s_e2e_us[seq] == 0) {      // Ignore QoS 1 duplicates
+        s_e2e_us[seq] = (uint32_t)(now - (int64_t)sent_us) + 1;
+        s_received++;
+    }
+    s_last_rx_us = now;
+}
+
+/** Store an ack latency (s_ack_lock held) */
+static void ack_record(int64_t sent, int64_t acked)
+{
+    if (s_acked < MAX_MESSAGES) {
+        s_ack_us[s_acked++] = (uint32_t)(acked - sent) + 1;
+    }
+}
+
+/*
+ * Against a local broker the PUBACK may be handled before the publishing
+ * task stores the send time of its msg_id. Such an ack is parked in
+ * s_ack_early_us and matched by ack_sent().
+ */
+static void on_published(int msg_id)
+{
+    int64_t now = now_us();
+
+    xSemaphoreTake(s_ack_lock, portMAX_DELAY);
+    int64_t sent = s_ack_sent_us[msg_id & 0xFFFF];
+    if (sent) {
+        ack_record(sent, now);
+        s_ack_sent_us[msg_id & 0xFFFF] = 0;
+    } else {
+        s_ack_early_us[msg_id & 0xFFFF] = now;
+    }
+    xSemaphoreGive(s_ack_lock);
+}
+
+/** Publishing task: msg_id was sent at sent */
+static void ack_sent(int msg_id, int64_t sent)
+{
+    xSemaphoreTake(s_ack_lock, portMAX_DELAY);
+    int64_t acked = s_ack_early_us[msg_id & 0xFFFF];
+    if (acked) {
+        ack_record(sent, acked);
+        s_ack_early_us[msg_id & 0xFFFF] = 0;
+    } else {
+        s_ack_sent_us[msg_id & 0xFFFF] = sent;
+    }
+    xSemaphoreGive(s_ack_lock);
+}
+
+/** PUBACKs still parked at the end of a run */
+static unsigned ack_unmatched(void)
+{
+    unsigned n = 0;
+
+    xSemaphoreTake(s_ack_lock, portMAX_DELAY);
+    for (unsigned i = 0; i < 65536; i++) {
+        n += s_ack_early_us[i] != 0;
+    }
+    xSemaphoreGive(s_ack_lock);
+    return n;
+}
+
+/*
+ * ============================================================================
+ *                               STATISTICS
+ * ============================================================================
+ */
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Sort the non-zero samples in place and return p50/p99 (in us)
+ *
+ * @return Number of samples
+ */
+static unsigned percentiles(uint32_t *v, unsigned n, uint32_t *p50, uint32_t *p99)
+{
+    unsigned k = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (v[i]) {
+            v[k++] = v[i] - 1;
+        }
+    }
+    *p50 = *p99 = 0;
+    if (k == 0) {
+        return 0;
+    }
+    qsort(v, k, sizeof(v[0]), cmp_u32);
+    *p50 = v[k / 2];
+    *p99 = v[(k * 99) / 100 < k ? (k * 99) / 100 : k - 1];
+    return k;
+}
+
+/*
+ * ============================================================================
+ *                                  RUN
+ * ============================================================================
+ */
+
+static void run_one(const bench_run_t *run, unsigned index)
+{
+    unsigned size = run->size < HEADER_LEN ? HEADER_LEN : run->size;
+    unsigned sent = 0, failed = 0;
+    int outbox_peak = 0;
+
+    snprintf(s_topic, sizeof(s_topic), "mqtt_bench/%u", index);
+    memset(s_e2e_us, 0, sizeof(s_e2e_us));
+    memset(s_ack_us, 0, sizeof(s_ack_us));
+    memset(s_call_us, 0, sizeof(s_call_us));
+    xSemaphoreTake(s_ack_lock, portMAX_DELAY);
+    memset(s_ack_sent_us, 0, sizeof(s_ack_sent_us));
+    memset(s_ack_early_us, 0, sizeof(s_ack_early_us));
+    s_acked = 0;
+    xSemaphoreGive(s_ack_lock);
+    s_received = 0;
+
+    wifi_mqtt_subscribe(s_topic, run->qos);
+    vTaskDelay(pdMS_TO_TICKS(200));             // Let SUBACK arrive
+
+    memset(s_payload, 'x', size);
+    s_payload[size] = '\0';
+
+    int64_t interval_us = run->rate ? 1000000 / run->rate : 0;
+    int64_t start = now_us();
+    int64_t next = start;
+
+    for (unsigned seq = 0; seq < run->messages; seq++) {
+        if (interval_us) {
+            int64_t ahead = next - now_us();
+            if (ahead > 0) {
+                usleep((useconds_t)ahead);
+            }
+            next += interval_us;
+        }
+
+        int64_t t0 = now_us();
+        char header[HEADER_LEN + 1];
+        snprintf(header, sizeof(header), "%08x %016llx ", seq, (unsigned long long)t0);
+        memcpy(s_payload, header, HEADER_LEN);
+
+        int msg_id = s_async ? wifi_mqtt_publish_async(s_topic, s_payload, (int)size, run->qos, NULL)
+                             : wifi_mqtt_publish(s_topic, s_payload, run->qos);
+        int64_t t1 = now_us();
+
+        s_call_us[seq] = (uint32_t)(t1 - t0) + 1;
+        if (msg_id < 0) {
+            failed++;
+            continue;
+        }
+        sent++;
+        if (run->qos > 0) {
+            ack_sent(msg_id, t0);
+        }
+
+        if (seq % OUTBOX_SAMPLE_EVERY == 0) {
+            int outbox = wifi_mqtt_get_outbox_size();
+            if (outbox > outbox_peak) {
+                outbox_peak = outbox;
+            }
+        }
+    }
+    int64_t send_us = now_us() - start;
+
+    // Drain: wait for everything to come back (or give up)
+    s_last_rx_us = now_us();
+    int64_t deadline = now_us() + DRAIN_TIMEOUT_US;
+    while (s_received < sent && now_us() < deadline &&
+           now_us() - s_last_rx_us < DRAIN_IDLE_US) {
+        int outbox = wifi_mqtt_get_outbox_size();
+        if (outbox > outbox_peak) {
+            outbox_peak = outbox;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    int64_t recv_us = s_last_rx_us - start;
+
+    wifi_mqtt_unsubscribe(s_topic);
+
+    uint32_t call50, call99, e2e50, e2e99, ack50 = 0, ack99 = 0;
+    unsigned received = s_received;
+    unsigned unmatched = 0;
+    percentiles(s_call_us, run->messages, &call50, &call99);
+    percentiles(s_e2e_us, run->messages, &e2e50, &e2e99);
+    if (run->qos > 0) {
+        unmatched = ack_unmatched();
+        xSemaphoreTake(s_ack_lock, portMAX_DELAY);
+        percentiles(s_ack_us, s_acked, &ack50, &ack99);
+        xSemaphoreGive(s_ack_lock);
+    }
+
+    char rate[12];
+    snprintf(rate, sizeof(rate), run->rate ? "%u" : "max", run->rate);
+
+    printf("%6u %3d %6s %9.0f %9.0f %6u %6u %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32,
+           size, run->qos, rate,
+           sent / (send_us / 1e6),
+           recv_us > 0 ? received / (recv_us / 1e6) : 0.0,
+           sent - received, failed,
+           call50, call99, e2e50, e2e99);
+    if (run->qos > 0) {
+        printf(" %7" PRIu32 " %7" PRIu32 " %9u", ack50, ack99, unmatched);
+    } else {
+        printf(" %7s %7s %9s", "-", "-", "-");
+    }
+    printf(" %8d\n", outbox_peak);
+    fflush(stdout);
+}
+
+/*
+ * ============================================================================
+ *                               RECONNECTS
+ * ============================================================================
+ * wifi_mqtt_stop() / wifi_mqtt_start() cycles: the time until
+ * wifi_mqtt_wait_ready() returns, and for mqtts:// the TCP + TLS part of it
+ * from wifi_mqtt_stats_t.
+ * Compare MQTT_BENCH_TLS_RESUME=0 and 1.
+ */
+
+static void run_reconnects(unsigned count)
+{
+    static uint32_t connect_us[MAX_RECONNECTS];
+    static uint32_t tls_us[MAX_RECONNECTS];
+    wifi_mqtt_stats_t stats;
+    unsigned failed = 0;
+
+    wifi_mqtt_get_stats(&stats);
+    uint32_t first_ms = stats.tls_full_handshake_ms;
+    memset(connect_us, 0, sizeof(connect_us));
+    memset(tls_us, 0, sizeof(tls_us));
+
+    for (unsigned i = 0; i < count; i++) {
+        wifi_mqtt_stop();
+        vTaskDelay(pdMS_TO_TICKS(50));
+
+        uint32_t handshakes = stats.tls_handshakes;
+        uint32_t offers = stats.tls_resume_attempts;
+        int64_t t0 = now_us();
+        wifi_mqtt_start();
+        if (wifi_mqtt_wait_ready(CONNECT_TIMEOUT_MS) != ESP_OK) {
+            failed++;
+            continue;
+        }
+        connect_us[i] = (uint32_t)(now_us() - t0) + 1;
+
+        wifi_mqtt_get_stats(&stats);
+        if (stats.tls_handshakes != handshakes) {
+            bool offered = stats.tls_resume_attempts != offers;
+            tls_us[i] = (offered ? stats.tls_resume_handshake_ms : stats.tls_full_handshake_ms) * 1000 + 1;
+        }
+    }
+
+    uint32_t conn50, conn99, tls50, tls99;
+    unsigned connected = percentiles(connect_us, count, &conn50, &conn99);
+    unsigned handshakes = percentiles(tls_us, count, &tls50, &tls99);
+
+    printf("%8s %6s %9s %9s %9s %9s %9s %9s\n",
+           "connects", "failed", "conn50", "conn99", "tls50", "tls99", "first", "offered");
+    printf("%8u %6u %9" PRIu32 " %9" PRIu32, connected, failed, conn50, conn99);
+    if (handshakes) {
+        printf(" %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 "\n",
+               tls50, tls99, first_ms * 1000, stats.tls_resume_attempts);
+    } else {
+        printf(" %9s %9s %9s %9s\n", "-", "-", "-", "-");
+    }
+    fflush(stdout);
+}
+
+/** Whole file as a string, NULL on error */
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *buf = f ? malloc(MAX_CA_CERT + 1) : NULL;
+    size_t len = buf ? fread(buf, 1, MAX_CA_CERT, f) : 0;
+
+    if (f) {
+        fclose(f);
+    }
+    if (buf && len == 0) {
+        free(buf);
+        return NULL;
+    }
+    if (buf) {
+        buf[len] = '\0';
+    }
+    return buf;
+}
+
+/*
+ * ============================================================================
+ *                                  MAIN
+ * ============================================================================
+ */
+
+static unsigned parse_list(const char *env, const char *def, unsigned *out)
+{
+    const char *s = getenv(env);
+    char buf[128];
+    unsigned n = 0;
+
+    snprintf(buf, sizeof(buf), "%s", s ? s : def);
+    for (char *tok = strtok(buf, ","); tok && n < MAX_SWEEP; tok = strtok(NULL, ",")) {
+        out[n++] = (unsigned)strtoul(tok, NULL, 0);
+    }
+    return n;
+}
+
+void app_main(void)
+{
+    const char *broker = getenv("MQTT_BENCH_BROKER");
+    const char *messages_env = getenv("MQTT_BENCH_MESSAGES");
+    const char *async_env = getenv("MQTT_BENCH_ASYNC");
+    unsigned sizes[MAX_SWEEP], qos[MAX_SWEEP], rates[MAX_SWEEP];
+
+    unsigned n_sizes = parse_list("MQTT_BENCH_SIZES", "32,128,512,1024,4096", sizes);
+    unsigned n_qos = parse_list("MQTT_BENCH_QOS", "0,1", qos);
+    unsigned n_rates = parse_list("MQTT_BENCH_RATES", "100,1000,0", rates);
+    unsigned messages = messages_env ? (unsigned)strtoul(messages_env, NULL, 0) : 2000;
+    if (messages == 0 || messages > MAX_MESSAGES) {
+        messages = MAX_MESSAGES;
+    }
+    s_async = async_env && atoi(async_env) != 0;
+    s_ack_lock = xSemaphoreCreateMutex();
+
+    const char *ca_env = getenv("MQTT_BENCH_CA");
+    const char *resume_env = getenv("MQTT_BENCH_TLS_RESUME");
+    const char *reconnects_env = getenv("MQTT_BENCH_RECONNECTS");
+    unsigned reconnects = reconnects_env ? (unsigned)strtoul(reconnects_env, NULL, 0) : 0;
+    if (reconnects > MAX_RECONNECTS) {
+        reconnects = MAX_RECONNECTS;
+    }
+    char *ca_cert = ca_env ? read_file(ca_env) : NULL;
+    if (ca_env && !ca_cert) {
+        ESP_LOGE(TAG, "Cannot read %s", ca_env);
+        exit(1);
+    }
+
+    wifi_mqtt_config_t config = {
+        .mqtt_broker_uri = broker ? broker : "mqtt://localhost:1883",
+        .mqtt_client_id = "mqtt_bench",
+        .mqtt_ca_cert = ca_cert,
+        .tls_session_resumption = !resume_env || atoi(resume_env) != 0,
+        .rx_reassembly_max = MAX_PAYLOAD + 1,   // Every size the bench sends arrives whole
+        .callbacks = {
+            .message_received = on_message,
+            .message_published = on_published,
+        },
+    };
+    ESP_ERROR_CHECK(wifi_mqtt_init(&config));
+    ESP_ERROR_CHECK(wifi_mqtt_start());
+
+    if (wifi_mqtt_wait_ready(CONNECT_TIMEOUT_MS) != ESP_OK) {
+        ESP_LOGE(TAG, "No connection to %s", config.mqtt_broker_uri);
+        exit(1);
+    }
+
+    if (reconnects) {
+        printf("wifi_mqtt reconnects: %s, TLS session resumption %s, times in us\n",
+               config.mqtt_broker_uri, config.tls_session_resumption ? "on" : "off");
+        run_reconnects(reconnects);
+        wifi_mqtt_stop();
+        exit(0);
+    }
+
+    printf("wifi_mqtt benchmark: %s, %s, %u messages per run, latencies in us\n",
+           config.mqtt_broker_uri, s_async ? "wifi_mqtt_publish_async" : "wifi_mqtt_publish", messages);
+    printf("%6s %3s %6s %9s %9s %6s %6s %7s %7s %7s %7s %7s %7s %9s %8s\n",
+           "size", "qos", "rate", "pub/s", "recv/s", "lost", "failed",
+           "call50", "call99", "e2e50", "e2e99", "ack50", "ack99", "unmatched", "outbox");
+
+    unsigned index = 0;
+    for (unsigned q = 0; q < n_qos; q++) {
+        for (unsigned s = 0; s < n_sizes; s++) {
+            for (unsigned r = 0; r < n_rates; r++) {
+                bench_run_t run = {
+                    .size = sizes[s] > MAX_PAYLOAD ? MAX_PAYLOAD : sizes[s],
+                    .qos = (int)qos[q],
+                    .rate = rates[r],
+                    .messages = messages,
+                };
+                run_one(&run, index++);
+            }
+        }
+    }
+
+    wifi_mqtt_stop();
+    exit(0);
+}
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Convert gateway_trace dumps to Chrome trace-viewer JSON.
+
+Inputs (any mix):
+  - console logs containing "GWTRACE:<hex>" lines (trace_dump_uart)
+  - binary files of concatenated chunks (e.g. mosquitto_sub -N > dump.bin)
+  - --mqtt BROKER: send "trace_dump" to <prefix>/gateway/cmd and collect
+    the chunks from <prefix>/gateway/trace (needs paho-mqtt)
+
+Open the output in chrome://tracing or https://ui.perfetto.dev.
+
+    ./gwtrace2chrome.py monitor.log -o trace.json
+    ./gwtrace2chrome.py --mqtt localhost --prefix esp32 -o trace.json
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+
+# Keep in sync with gateway_trace_event_t (components/gateway_trace/include/gateway_trace.h)
+EVENTS = {
+    1: ("mesh_config_cb", "mesh", ("event", "addr")),
+    2: ("mesh_sensor_cb", "mesh", ("event", "addr")),
+    3: ("mesh_vendor_cb", "mesh", ("event", "addr")),
+    4: ("bridge_vendor", "bridge", ("opcode", "src")),
+    5: ("bridge_sensor", "bridge", ("property", "src")),
+    6: ("mqtt_publish", "mqtt", ("qos", "len")),
+    7: ("mqtt_puback", "mqtt", ("msg_id", "")),
+    8: ("latency_enqueue", "queue", ("msg_id", "slot")),
+    9: ("latency_ack", "queue", ("msg_id", "matched")),
+    10: ("mark", "user", ("a0", "a1")),
+}
+
+MAGIC = 0x52545747
+HDR = struct.Struct("<IBBHHHHH")      # gateway_trace_chunk_hdr_t
+REC = struct.Struct("<IHBBII")        # gateway_trace_record_t
+PHASES = {0x0000: "i", 0x4000: "B", 0x8000: "E"}
+
+
+def parse_chunks(blob):
+    """Yield (header tuple, payload bytes) for every chunk in a byte string."""
+    pos = 0
+    while pos + HDR.size <= len(blob):
+        hdr = HDR.unpack_from(blob, pos)
+        magic, version, rec_size, dump_id, chunk, chunks, cpu_mhz, records = hdr
+        if magic != MAGIC:
+            pos += 1                  # Resync on garbage
+            continue
+        if rec_size != REC.size:
+            sys.exit(f"unsupported record size {rec_size}")
+        end = pos + HDR.size + records * rec_size
+        yield hdr, blob[pos + HDR.size:end]
+        pos = end
+
+
+def read_file(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    lines = re.findall(rb"GWTRACE:([0-9a-fA-F]+)", data)
+    if lines:
+        return [bytes.fromhex(line.decode()) for line in lines]
+    return [data]
+
+
+def read_mqtt(broker, port, prefix, timeout):
+    import paho.mqtt.client as mqtt
+
+    blobs = []
+    expected = {}
+
+    def on_connect(client, userdata, flags, rc, *extra):
+        client.subscribe(f"{prefix}/gateway/trace", qos=0)
+        client.publish(f"{prefix}/gateway/cmd", "trace_dump", qos=1)
+
+    def on_message(client, userdata, msg):
+        blobs.append(msg.payload)
+        for hdr, _ in parse_chunks(msg.payload):
+            expected[hdr[3]] = hdr[5]
+
+    if hasattr(mqtt, "CallbackAPIVersion"):
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    else:
+        client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, port)
+    client.loop_start()
+
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if expected and len(blobs) >= max(expected.values()):
+            break
+        time.sleep(0.1)
+    client.loop_stop()
+
+    if not blobs:
+        sys.exit("no trace chunks received (is CONFIG_GATEWAY_TRACE_ENABLE set?)")
+    return blobs
+
+
+def collect(blobs):
+    """Return (cpu_mhz, records in ring order) of the most recent dump."""
+    dumps = {}
+    for blob in blobs:
+        for hdr, payload in parse_chunks(blob):
+            dumps.setdefault(hdr[3], {})[hdr[4]] = (hdr, payload)
+    if not dumps:
+        sys.exit("no trace chunks found")
+
+    dump_id = max(dumps)
+    chunks = dumps[dump_id]
+    total = next(iter(chunks.values()))[0][5]
+    if len(chunks) != total:
+        print(f"warning: dump {dump_id} has {len(chunks)}/{total} chunks", file=sys.stderr)
+
+    cpu_mhz = next(iter(chunks.values()))[0][6] or 240
+    records = []
+    for index in sorted(chunks):
+        payload = chunks[index][1]
+        records.extend(REC.iter_unpack(payload))
+    return cpu_mhz, records
+
+
+def to_chrome(cpu_mhz, records):
+    """
+    Cycle counters are 32-bit and per core. Records are in ring (global)
+    order, so each core's counter is unwrapped against its previous record,
+    and a core's first record is aligned to the time of the record before it.
+    """
+    events = []
+    last_cycles = {}
+    offset_us = {}
+    prev_ts = 0.0
+
+    for cycles, event, core, _, a0, a1 in records:
+        if core not in last_cycles:
+            offset_us[core] = prev_ts - cycles / cpu_mhz
+        elif cycles < last_cycles[core]:
+            offset_us[core] += (1 << 32) / cpu_mhz
+        last_cycles[core] = cycles
+
+        ts = cycles / cpu_mhz + offset_us[core]
+        prev_ts = ts
+
+        ev_id = event & 0x3FFF
+        phase = PHASES.get(event & 0xC000, "i")
+        name, cat, arg_names = EVENTS.get(ev_id, (f"event_{ev_id}", "unknown", ("a0", "a1")))
+
+        ev = {"name": name, "cat": cat, "ph": phase, "ts": round(ts, 3),
+              "pid": 0, "tid": core}
+        if phase == "i":
+            ev["s"] = "t"
+        if phase != "E" or a0 or a1:
+            ev["args"] = {k: v for k, v in zip(arg_names, (a0, a1)) if k}
+        events.append(ev)
+
+    # Drop END events whose BEGIN was overwritten in the ring
+    depth = {}
+    cleaned = []
+    for ev in events:
+        key = (ev["tid"], ev["name"])
+        if ev["ph"] == "B":
+            depth[key] = depth.get(key, 0) + 1
+        elif ev["ph"] == "E":
+            if not depth.get(key):
+                continue
+            depth[key] -= 1
+        cleaned.append(ev)
+
+    return {
+        "traceEvents": cleaned,
+        "displayTimeUnit": "ns",
+        "metadata": {"source": "gateway_trace", "cpu_mhz": cpu_mhz},
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("inputs", nargs="*", help="log or binary dump files")
+    parser.add_argument("--mqtt", metavar="BROKER", help="request a dump over MQTT")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--prefix", default="esp32")
+    parser.add_argument("--timeout", type=float, default=10)
+    parser.add_argument("-o", "--output", default="-")
+    args = parser.parse_args()
+
+    blobs = []
+    for path in args.inputs:
+        blobs.extend(read_file(path))
+    if args.mqtt:
+        blobs.extend(read_mqtt(args.mqtt, args.port, args.prefix, args.timeout))
+    if not blobs:
+        parser.error("no input: give files or --mqtt")
+
+    cpu_mhz, records = collect(blobs)
+    trace = to_chrome(cpu_mhz, records)
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    json.dump(trace, out)
+    if out is not sys.stdout:
+        out.close()
+        print(f"{len(records)} records -> {args.output}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())